@@ -1,62 +1,195 @@
 #include "app.h"
-#include "args.h"
+#include "batch.h"
 #include "consumption.h"
+#include "distribution.h"
+#include "engine.h"
+#include "output.h"
+#include "peaks.h"
+#include "prefetch.h"
 #include "prices.h"
+#include "pricetable.h"
+#include "profile.h"
+#include "server.h"
+#include "watch.h"
 
 #include <QDateTime>
 #include <QTimer>
+#include <QtConcurrent>
 
 #include <fmt/base.h>
 
+#include <chrono>
+#include <utility>
+
+namespace {
+
+/// Time when the process started; initialized before main()
+auto const process_start = std::chrono::steady_clock::now();
+
+/// Returns milliseconds since the process started
+auto elapsed_ms() -> double
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - process_start).count();
+}
+
+} // namespace
+
 namespace El {
 
 // -----------------------------------------------------------------------------
 
-App::App(int &argc, char **argv)
+App::App(int &argc, char **argv, Options options)
     : QCoreApplication(argc, argv)
-    , _consumption(std::make_unique<Consumption>(*this))
+    , _options(std::move(options))
+    , _consumption(std::make_unique<Consumption>())
 {
+    if (_options.profile) {
+        Profile::enable();
+    }
+
     QTimer::singleShot(0, this, &App::process);
 }
 
-App::~App() = default;
+App::~App()
+{
+    // the worker thread uses consumption records
+    _parsing.waitForFinished();
+}
 
-auto App::wait_for(bool const &flag, int ms) -> bool
+void App::process()
 {
-    auto const start = QTime::currentTime().msecsSinceStartOfDay();
+    _started_ms = elapsed_ms();
 
-    // process events until `flag` becomes true or timeout
-    constexpr int MAX_TIME_MS = 100;
-    while (!flag && ((QTime::currentTime().msecsSinceStartOfDay() - start) < ms)) {
-        processEvents(QEventLoop::AllEvents | QEventLoop::WaitForMoreEvents, MAX_TIME_MS);
+    // run as a daemon that only updates the price cache
+    if (_options.prefetch) {
+        _prefetch = std::make_unique<Prefetch>(_options);
+        _prefetch->start();
+        return;
+    }
+
+    // keep consumption records and prices in memory and answer queries
+    if (_options.serve) {
+        _server = std::make_unique<Server>(_options);
+        if (!_server->start()) {
+            exit(EXIT_FAILURE);
+        }
+        return;
     }
 
-    return flag;
+    // show updated totals whenever the files change
+    if (_options.watch) {
+        _watch = std::make_unique<Watch>(_options);
+        if (!_watch->start()) {
+            exit(EXIT_FAILURE);
+        }
+        return;
+    }
+
+    // process the meters listed in a manifest
+    if (_options.batch) {
+        _batch = std::make_unique<Batch>(_options);
+        connect(_batch.get(), &Batch::finished, this, [this](bool ok) {
+            if (_options.profile) {
+                Profile::print_summary(stderr);
+                Profile::write_trace(_options.trace_file);
+            }
+            exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+        });
+        if (!_batch->start()) {
+            exit(EXIT_FAILURE);
+        }
+        return;
+    }
+
+    // without prices there is nothing to do while the file is parsed, so avoid starting threads
+    if (!_options.prices) {
+        parsed(_consumption->load(_options.file_name, _options.time));
+        return;
+    }
+
+    // parse the CSV file in a worker thread
+    _parsing = QtConcurrent::run([this, filename = _options.file_name, end = _options.time]() {
+        return _consumption->load(filename, end);
+    });
+    _parsing.then(this, [this](bool ok) { parsed(ok); });
+
+    // start loading prices for the period in the CSV file preamble while the file is being parsed
+    _prices = std::make_unique<Prices>(_options);
+    connect(_prices.get(), &Prices::loaded, this, &App::prices_loaded);
+
+    auto const period = Consumption::peek_period(_options.file_name, _options.time);
+    if (period && period->start <= period->end) {
+        _prices->load(_options.region(), period->start, period->end);
+    }
 }
 
-void App::process()
+void App::parsed(bool ok)
 {
-    auto const &args = Args::instance();
+    if (!ok) {
+        exit(EXIT_FAILURE);
+        return;
+    }
+    _parsed    = true;
+    _parsed_ms = elapsed_ms();
 
-    // Load the CSV file
-    if (!_consumption->load(args.fileName())) {
+    if (!_prices) {
+        finish();
+    }
+    else if (!_prices->busy()) {
+        load_final_prices();
+    }
+}
+
+void App::prices_loaded(bool ok)
+{
+    if (!ok) {
         exit(EXIT_FAILURE);
         return;
     }
 
-    // Load or request Nord Pool prices
-    if (args.prices()) {
+    // wait for the CSV file
+    if (!_parsed) {
+        return;
+    }
 
-        _prices = std::make_unique<Prices>(*this);
-        if (!_prices->load(args.region(), _consumption->first_record_time(), _consumption->last_record_time())) {
-            exit(EXIT_FAILURE);
-            return;
-        }
+    if (_prices_final) {
+        _prices_ms = elapsed_ms();
+        finish();
+    }
+    else {
+        load_final_prices();
     }
+}
+
+void App::load_final_prices()
+{
+    // prices loaded for the period from the CSV file preamble are usually enough
+    _prices_final = true;
+    _prices->load(_options.region(), _consumption->first_record_time(), _consumption->last_record_time());
+}
 
+void App::finish()
+{
     // calculate and show results
     if (!calc()) {
         exit(EXIT_FAILURE);
+        return;
+    }
+
+    // cold start timing
+    if (_options.verbose) {
+        fmt::print(stderr,
+                   "Ajakulu: käivitus {:.1f} ms, CSV {:.1f} ms, hinnad {:.1f} ms, kokku {:.1f} ms\n",
+                   _started_ms,
+                   _parsed_ms,
+                   _prices_ms,
+                   elapsed_ms());
+    }
+
+    // phase timings and counters
+    if (_options.profile) {
+        Profile::print_summary(stderr);
+        Profile::write_trace(_options.trace_file);
     }
 
     quit();
@@ -64,90 +197,66 @@ void App::process()
 
 auto App::calc() -> bool
 {
+    Output output{_options, _prices != nullptr};
+
     // Calculate and show totals
-    if (!calc_summary()) {
+    if (!calc_summary(output)) {
         return false;
     }
 
-    if (!show_summary()) {
+    if (!show_summary(output)) {
         return false;
     }
 
     return true;
 }
 
-auto App::calc_summary() -> bool
+auto App::calc_summary(Output &output) -> bool
 {
-    auto const &args = Args::instance();
+    Profile::Scope const profile{"calc_summary"};
 
-    // VAT multiplier
-    auto const vat = 1.0 + args.km();
-
-    for (auto const &rec : _consumption->records()) {
+    if (_options.peaks) {
+        _peaks = std::make_unique<Peaks>(_options.peak_windows, _options.peak_top);
+    }
+    if (_options.distribution) {
+        _distributions = std::make_unique<Distributions>();
+    }
 
-        // Sum kWh
-        if (rec.isNight()) {
-            _night_kwh += rec.kWh();
+    auto const margin = _options.net_margin();
+    auto const visit  = [this, &output, margin](Record const &rec, std::optional<double> const &price) {
+        if (_peaks) {
+            _peaks->add(rec, price, margin);
         }
-        else {
-            _day_kwh += rec.kWh();
+        if (_distributions) {
+            _distributions->add(rec, price);
         }
+        output.record(rec, price);
+    };
 
-        // Sum cost
-        if (_prices) {
-            auto const price = _prices->get_price(rec.startTime());
-            if (!price) {
-                fmt::print("WARNING: puudub hinnainfo ajale {}\n", rec.startTime());
-                continue;
-            }
+    auto const table = _prices ? _prices->snapshot() : nullptr;
+    _summary         = Engine::summarize(_consumption->records(), table.get(), _options, visit);
 
-            auto const cost   = price.value() * rec.kWh();
-            auto const margin = (args.margin() * rec.kWh()) / vat;
-            if (args.verbose()) {
-                fmt::print("\t{}\t{:.3f} kWh\t{:.3f} EUR\t@{:.4f} EUR\n",
-                       rec.startTime(),
-                       rec.kWh(),
-                       (cost + margin) * vat,
-                       price.value() * vat);
-            }
-            if (rec.isNight()) {
-                _night_eur += (cost + margin);
-            }
-            else {
-                _day_eur += (cost + margin);
-            }
-        }
+    if (_peaks) {
+        _peaks->finish();
+    }
+    if (_distributions) {
+        _distributions->compress();
     }
 
     return true;
 }
 
-auto App::show_summary() -> bool
+auto App::show_summary(Output &output) -> bool
 {
-    auto const &args = Args::instance();
-
-    // VAT multipler
-    auto const vat = 1.0 + args.km();
-
-    if (args.startDay() && args.startNight()) {
-        fmt::print("arvesti näit\n\töö: {:10.3f}\tpäev: {:10.3f}\n",
-               args.startNight().value() + _night_kwh,
-               args.startDay().value() + _day_kwh);
-    }
-    fmt::print("kulu kWh\n\töö: {:10.3f} kWh\tpäev: {:10.3f} kWh\tkokku: {:10.3f} kWh\n",
-           _night_kwh,
-           _day_kwh,
-           _night_kwh + _day_kwh);
-    if (_prices) {
-        fmt::print("kulu EUR\n\töö: {:10.2f} EUR\tpäev: {:10.2f} EUR\tkokku: {:10.2f} EUR\n",
-               _night_eur * vat,
-               _day_eur * vat,
-               (_night_eur + _day_eur) * vat);
-        fmt::print("hind EUR/kWh\n\töö: {:6.4f} EUR/kWh\tpäev: {:6.4f} EUR/kWh\tkeskmine: {:6.4f} EUR/kWh\n",
-               (_night_eur / _night_kwh) * vat,
-               (_day_eur / _day_kwh) * vat,
-               ((_night_eur + _day_eur) / (_night_kwh + _day_kwh)) * vat);
+    auto const &start = _consumption->records().first().startTime();
+    auto const &end   = _consumption->records().last().endTime();
+    if (_peaks) {
+        output.peaks(*_peaks, start, end);
+    }
+    if (_distributions) {
+        output.distributions(*_distributions, start, end);
     }
+    output.summary(_summary, start, end);
     return true;
 }
 
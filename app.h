@@ -3,28 +3,37 @@
 #ifndef APP_H
 #  define APP_H
 
+#include "options.h"
+#include "summary.h"
+
 #include <QCoreApplication>
+#include <QFuture>
 
 #include <memory>
 
 namespace El {
 
+class Batch;
 class Consumption;
+class Distributions;
+class Output;
+class Peaks;
+class Prefetch;
 class Prices;
+class Server;
+class Watch;
 
+/// Command line front end to the engine
 class App : public QCoreApplication {
     Q_OBJECT
 
 public:
 
-    /// Wait for the `flag` to become `true`
-    /// @param[in] flag The flag
-    /// @param[in] ms Timeout in milliseconds
-    /// @return The value of the `flag`
-    static auto wait_for(bool const &flag, int ms) -> bool;
-
     /// Ctor
-    App(int &argc, char **argv);
+    /// @param[in] argc Argument count
+    /// @param[in] argv Argument values
+    /// @param[in] options Options from the command line
+    App(int &argc, char **argv, Options options);
 
     /// Dtor
     ~App() override;
@@ -33,29 +42,70 @@ private slots:
 
     void process();
 
+    /// Called when the CSV file is parsed
+    /// @param[in] ok true if succeeded, otherwise false
+    void parsed(bool ok);
+
+    /// Called when prices are loaded
+    /// @param[in] ok true if succeeded, otherwise false
+    void prices_loaded(bool ok);
+
 private: // NOLINT
 
+    /// Options from the command line
+    Options _options;
+
     /// Consumption records
     std::unique_ptr<Consumption> _consumption;
 
     /// Nord Pool prices
     std::unique_ptr<Prices> _prices;
 
-    /// Total day consumption kWh
-    double _day_kwh = 0.0;
+    /// Price prefetch daemon
+    std::unique_ptr<Prefetch> _prefetch;
+
+    /// Query server
+    std::unique_ptr<Server> _server;
+
+    /// File watcher
+    std::unique_ptr<Watch> _watch;
+
+    /// Multi-meter batch
+    std::unique_ptr<Batch> _batch;
+
+    /// Parsing the CSV file in a worker thread
+    QFuture<bool> _parsing;
+
+    /// Flag indicating that the CSV file is parsed
+    bool _parsed = false;
+
+    /// Flag indicating that prices are loaded for the actual period of consumption records
+    bool _prices_final = false;
+
+    /// Consumption and cost totals
+    Summary _summary;
+
+    /// Peak demand analysis if requested
+    std::unique_ptr<Peaks> _peaks;
+
+    /// Distributions of consumption and prices if requested
+    std::unique_ptr<Distributions> _distributions;
 
-    /// Total night consumption kWh
-    double _night_kwh = 0.0;
+    /// Milliseconds from the start of the process until processing started, the CSV file was
+    /// parsed and prices were loaded
+    double _started_ms = 0.0;
+    double _parsed_ms  = 0.0;
+    double _prices_ms  = 0.0;
 
-    /// Total day cost EUR
-    double _day_eur = 0.0;
+    /// Starts loading prices for the actual period of consumption records
+    void load_final_prices();
 
-    /// Total night cost EUR
-    double _night_eur = 0.0;
+    /// Calculates and shows the results and quits the application
+    void finish();
 
     auto calc() -> bool;
-    auto calc_summary() -> bool;
-    auto show_summary() -> bool;
+    auto calc_summary(Output &output) -> bool;
+    auto show_summary(Output &output) -> bool;
 };
 
 } // namespace El
@@ -12,21 +12,54 @@ constexpr double DEFAULT_VAT = 0.24;
 
 constexpr char const *USAGE = R"(
 KASUTAMINE: {0} [args] <CSV faili nimi>
+            {0} -f[<päevad>] [-r <r>[,<r>...]] [-u <url>] [-v]
 
 args:
     -h,--help        Näitab seda abiteksti.
+    -b,--batch       Fail on mitme arvesti manifest, mille igal real on
+                     <CSV fail>[;<juurdehindlus>[;<km%>[;<päev>;<öö>[;<väljundfail>]]]].
+                     Tühjad väljad võetakse käsurealt. Iga arvesti tulemused kirjutatakse
+                     eraldi faili (vaikimisi <CSV fail>.summary.<vorming>) ning kõigi
+                     arvestite koondaruanne väljundisse.
+    -c,--cache <dir> Hindade vahemälu kaust (vaikimisi ~/.local/share/elekter).
     -d,--day <v>     Päevase näidu algväärtus.
+    -D,--distribution Näitab iga kuu ja kogu perioodi tarbimise, hindade ning tarbimisega
+                     kaalutud hindade jaotust (p50, p90, p99) ja tarbimise histogrammi.
+    -f[<päevad>],--prefetch[=<päevad>] Töötab taustaprotsessina, mis hoiab hinnad
+                     vahemälus ajakohasena: küsib järgmise päeva hinnad kohe pärast
+                     nende avaldamist ning puuduvad hinnad viimase <päevad> päeva
+                     kohta (vaikimisi {3}).
+    -i,--import      Salvesta failist loetud hinnad vahemällu.
     -k[<km%>],--km[=<km%>] Näita hindasid koos käibemaksuga (vaikimisi {1:.0f}%).
     -m,--margin <v>  Elektrimüüja juurdehindlus EUR/kWh;
                      juurdehindlus on koos käibemaksuga, kui --km on antud.
     -n,--night <v>   Öise näidu algväärtus.
+    -o,--format <f>  Väljundi vorming: "text" (vaikimisi), "csv", "ndjson" või "json".
+                     Masinloetavad vormingud sisaldavad iga kirje ja kokkuvõtte.
+    -P[<file>],--profile[=<file>] Mõõdab tööetappide kestust ja loendab ridu, vahemälu
+                     tabamusi ning allalaaditud baite. Kokkuvõte kirjutatakse stderr'i
+                     ja Chrome trace vormingus ajajoon faili <file> (vaikimisi {4}).
     -p[<filename>],--prices[=<filename>] Näita hindasid Nord Pool tunnihindadega.
-                     Kasutab JSON faili <filename> tunnihindadega või küsib üle võrgu.
+                     Kasutab JSON või CSV (timestamp;price) faili või nende failidega
+                     kausta <filename> või küsib üle võrgu.
     -r,--region <r>  Hinnapiirkond ("ee", "fi", "lv", "lt")
                      vaikimisi kasutab hinnapiirkonda "ee".
+                     Argumendiga --prefetch võib anda mitu komaga eraldatud piirkonda.
+    -s[<socket>],--serve[=<socket>] Hoiab tarbimisandmed ja hinnad mälus ning vastab
+                     päringutele kohaliku sokli <socket> kaudu (vaikimisi
+                     $XDG_RUNTIME_DIR/elekter.sock). CSV fail loetakse uuesti, kui see muutub.
     -t,--time <dt>   Lõppnäidu kuupäev ja kellaaeg (yyyy-MM-dd hh:mm)
                      Vaikimisi kasutab praegust aega.
+    -T[<n>],--peaks[=<n>] Analüüsib tipukoormust: suurim keskmine võimsus libisevates
+                     akendes, iga kuu <n> suurima tarbimisega intervalli (vaikimisi {5})
+                     ning tipuaja (4-ajatsooni "Tipp") tarbimine ja maksumus.
+    -u,--url <url>   Nord Pool hinnateenuse aadress (vaikimisi {2}).
     -v,--verbose     Teeb programmi jutukamaks.
+    -w,--watch       Jälgib CSV faili või CSV failidega kausta ning näitab uuendatud
+                     kokkuvõtet iga kord, kui faile muudetakse või lisatakse. Loeb ainult
+                     muudetud faile ning küsib hindu ainult uute kirjete jaoks.
+    -W,--windows <min>[,<min>...] Tipukoormuse akende pikkused minutites
+                     (vaikimisi 15,60,1440).
 
 Töötleb elektrilevi.ee lehelt allalaaditud CSV-vormingus tunnitarbimise faile.
 
@@ -51,47 +84,80 @@ Näita summaarset tarbimist kasutades andmeid failist 2020-06.csv ja arvuta
 elektri eest tasutav summa koos käibemaksuga kasutades hindasid failist 2020-06.json:
 
 > {0} -k -p2020-06.json 2020-06.csv
+
+Hoia Eesti ja Soome hinnad vahemälus ajakohasena:
+
+> {0} --prefetch -r ee,fi
+
+Hoia andmed mälus ja vasta päringutele (summary, range <algus> <lõpp>,
+rollup day|month|year [<algus> <lõpp>]), üks päring rea kohta:
+
+> {0} --serve=/tmp/elekter.sock -k -p 2020-06.csv
+> echo "rollup day" | socat - UNIX-CONNECT:/tmp/elekter.sock
+
+Näita uuendatud kokkuvõtet iga kord, kui kausta exports/ lisatakse uus CSV fail:
+
+> {0} --watch -k -p exports/
+
+Arvuta kõigi failis arvestid.txt loetletud arvestite tarbimine ja maksumus:
+
+> {0} --batch -k -p arvestid.txt
+
+Näita iga kuu viit suurimat tipukoormust ning suurimat tunni ja ööpäeva keskmist võimsust:
+
+> {0} --peaks=5 --windows=60,1440 -k -p 2020-06.csv
+
+Näita kõigi arvestite tarbimise ja makstud hindade jaotust:
+
+> {0} --batch --distribution -k -p arvestid.txt
 )";
 
-constexpr char const         *shortOpts  = "hd:k::m:n:p::r:t:v";
+constexpr char const         *shortOpts  = "hbc:d:Df::ik::m:n:o:p::P::r:s::t:T::u:vwW:";
 constexpr struct option const longOpts[] = { // NOLINT(modernize-avoid-c-arrays)
-    {"help",    no_argument,       nullptr, 'h'},
-    {"day",     required_argument, nullptr, 'd'},
-    {"km",      optional_argument, nullptr, 'k'},
-    {"margin",  required_argument, nullptr, 'm'},
-    {"night",   required_argument, nullptr, 'n'},
-    {"prices",  optional_argument, nullptr, 'p'},
-    {"region",  required_argument, nullptr, 'r'},
-    {"time",    required_argument, nullptr, 't'},
-    {"verbose", no_argument,       nullptr, 'v'},
-    {nullptr,   0,                 nullptr, 0  }
+    {"help",         no_argument,       nullptr, 'h'},
+    {"batch",        no_argument,       nullptr, 'b'},
+    {"cache",        required_argument, nullptr, 'c'},
+    {"day",          required_argument, nullptr, 'd'},
+    {"distribution", no_argument,       nullptr, 'D'},
+    {"prefetch",     optional_argument, nullptr, 'f'},
+    {"import",       no_argument,       nullptr, 'i'},
+    {"km",           optional_argument, nullptr, 'k'},
+    {"margin",       required_argument, nullptr, 'm'},
+    {"night",        required_argument, nullptr, 'n'},
+    {"format",       required_argument, nullptr, 'o'},
+    {"prices",       optional_argument, nullptr, 'p'},
+    {"profile",      optional_argument, nullptr, 'P'},
+    {"region",       required_argument, nullptr, 'r'},
+    {"serve",        optional_argument, nullptr, 's'},
+    {"time",         required_argument, nullptr, 't'},
+    {"peaks",        optional_argument, nullptr, 'T'},
+    {"url",          required_argument, nullptr, 'u'},
+    {"verbose",      no_argument,       nullptr, 'v'},
+    {"watch",        no_argument,       nullptr, 'w'},
+    {"windows",      required_argument, nullptr, 'W'},
+    {nullptr,        0,                 nullptr, 0  }
 };
 
 } // namespace
 
 namespace El {
 
-auto Args::instance() -> Args &
-{
-    static Args args{};
-    return args;
-}
-
 void Args::printUsage(bool err, char const *appName)
 {
-    fmt::print(err ? stderr : stdout, USAGE, appName, DEFAULT_VAT * 100.0);
+    fmt::print(err ? stderr : stdout,
+               USAGE,
+               appName,
+               DEFAULT_VAT * 100.0,
+               Options::DEFAULT_URL,
+               Options::DEFAULT_PREFETCH_DAYS,
+               Options::DEFAULT_TRACE_FILE,
+               Options::DEFAULT_PEAK_TOP);
 }
 
-Args::Args()
-    : _time{QDateTime::currentDateTime()}
-{}
-
 auto Args::init(int argc, char *argv[]) -> bool// NOLINT(modernize-avoid-c-arrays)
 {
     using namespace Qt::Literals::StringLiterals;
 
-    _region = u"ee"_s;
-
     char const *appName = argv[0];
     int         c       = 0;
     int         idx     = 0;
@@ -103,9 +169,19 @@ auto Args::init(int argc, char *argv[]) -> bool// NOLINT(modernize-avoid-c-array
                 return false;
             }
 
+            case 'b': {
+                _options.batch = true;
+                break;
+            }
+
+            case 'c': {
+                _options.cache_dir = QString::fromLocal8Bit(optarg);
+                break;
+            }
+
             case 'd': {
-                char *e = nullptr;
-                _day    = strtod(optarg, &e);
+                char *e           = nullptr;
+                _options.start_day = strtod(optarg, &e);
                 if (e == nullptr || *e != '\0') {
                     fmt::print(stderr, "Vigane väärtus \"{}\" argumendile '--day'\n", optarg);
                     return false;
@@ -113,10 +189,33 @@ auto Args::init(int argc, char *argv[]) -> bool// NOLINT(modernize-avoid-c-array
                 break;
             }
 
+            case 'D': {
+                _options.distribution = true;
+                break;
+            }
+
+            case 'f': {
+                _options.prefetch = true;
+                if (optarg != nullptr) {
+                    char *e                = nullptr;
+                    _options.prefetch_days = static_cast<int>(strtol(optarg, &e, 10));
+                    if (e == nullptr || *e != '\0' || _options.prefetch_days < 0) {
+                        fmt::print(stderr, "Vigane väärtus \"{}\" argumendile '--prefetch'\n", optarg);
+                        return false;
+                    }
+                }
+                break;
+            }
+
+            case 'i': {
+                _options.import_prices = true;
+                break;
+            }
+
             case 'k': {
                 if (optarg != nullptr) {
-                    char *e = nullptr;
-                    _km     = strtod(optarg, &e) / 100.0;
+                    char *e     = nullptr;
+                    _options.km = strtod(optarg, &e) / 100.0;
                     if (e == nullptr || (*e != '\0' && *e != '%')) {
                         fmt::print(stderr, "Vigane väärtus \"{}\" argumendile '--km'\n", optarg);
                         return false;
@@ -127,14 +226,14 @@ auto Args::init(int argc, char *argv[]) -> bool// NOLINT(modernize-avoid-c-array
                     }
                 }
                 else {
-                    _km = DEFAULT_VAT;
+                    _options.km = DEFAULT_VAT;
                 }
                 break;
             }
 
             case 'm': {
-                char *e = nullptr;
-                _margin = strtod(optarg, &e);
+                char *e        = nullptr;
+                _options.margin = strtod(optarg, &e);
                 if (e == nullptr || *e != '\0') {
                     fmt::print(stderr, "Vigane väärtus \"{}\" argumendile '--margin'\n", optarg);
                     return false;
@@ -143,8 +242,8 @@ auto Args::init(int argc, char *argv[]) -> bool// NOLINT(modernize-avoid-c-array
             }
 
             case 'n': {
-                char *e = nullptr;
-                _night  = strtod(optarg, &e);
+                char *e             = nullptr;
+                _options.start_night = strtod(optarg, &e);
                 if (e == nullptr || *e != '\0') {
                     fmt::print(stderr, "Vigane väärtus \"{}\" argumendile '--night'\n", optarg);
                     return false;
@@ -152,30 +251,112 @@ auto Args::init(int argc, char *argv[]) -> bool// NOLINT(modernize-avoid-c-array
                 break;
             }
 
+            case 'o': {
+                auto const format = QByteArray{optarg};
+                if (format == "text") {
+                    _options.format = Options::Format::Text;
+                }
+                else if (format == "csv") {
+                    _options.format = Options::Format::Csv;
+                }
+                else if (format == "ndjson") {
+                    _options.format = Options::Format::Ndjson;
+                }
+                else if (format == "json") {
+                    _options.format = Options::Format::Json;
+                }
+                else {
+                    fmt::print(stderr, "Vigane väärtus \"{}\" argumendile '--format'\n", optarg);
+                    return false;
+                }
+                break;
+            }
+
             case 't': {
-                _time = QDateTime::fromString(optarg, u"yyyy-MM-dd hh:mm"_s);
-                if (!_time.isValid()) {
+                _options.time = QDateTime::fromString(optarg, u"yyyy-MM-dd hh:mm"_s);
+                if (!_options.time.isValid()) {
                     fmt::print(stderr, "Vigane väärtus \"{}\" argumendile '--time'\n", optarg);
                     return false;
                 }
+                _options.fixed_time = true;
                 break;
             }
 
             case 'p': {
-                _prices = true;
+                _options.prices = true;
+                if (optarg != nullptr) {
+                    _options.price_file_name = optarg;
+                }
+                break;
+            }
+
+            case 'P': {
+                _options.profile = true;
                 if (optarg != nullptr) {
-                    _priceFileName = optarg;
+                    _options.trace_file = QString::fromLocal8Bit(optarg);
                 }
                 break;
             }
 
             case 'r': {
-                _region = optarg;
+                _options.regions = QString{optarg}.split(u',', Qt::SkipEmptyParts);
+                if (_options.regions.isEmpty()) {
+                    fmt::print(stderr, "Vigane väärtus \"{}\" argumendile '--region'\n", optarg);
+                    return false;
+                }
+                break;
+            }
+
+            case 's': {
+                _options.serve = true;
+                if (optarg != nullptr) {
+                    _options.socket_name = optarg;
+                }
+                break;
+            }
+
+            case 'T': {
+                _options.peaks = true;
+                if (optarg != nullptr) {
+                    char *e           = nullptr;
+                    _options.peak_top = static_cast<int>(strtol(optarg, &e, 10));
+                    if (e == nullptr || *e != '\0' || _options.peak_top < 0) {
+                        fmt::print(stderr, "Vigane väärtus \"{}\" argumendile '--peaks'\n", optarg);
+                        return false;
+                    }
+                }
+                break;
+            }
+
+            case 'u': {
+                _options.url = optarg;
+                while (_options.url.endsWith(u'/')) {
+                    _options.url.chop(1);
+                }
                 break;
             }
 
             case 'v': {
-                _verbose = true;
+                _options.verbose = true;
+                break;
+            }
+
+            case 'w': {
+                _options.watch = true;
+                break;
+            }
+
+            case 'W': {
+                _options.peak_windows.clear();
+                for (auto const &value : QByteArray{optarg}.split(',')) {
+                    bool       ok      = false;
+                    auto const minutes = value.toInt(&ok);
+                    if (!ok || minutes <= 0) {
+                        fmt::print(stderr, "Vigane väärtus \"{}\" argumendile '--windows'\n", optarg);
+                        return false;
+                    }
+                    _options.peak_windows.append(minutes);
+                }
                 break;
             }
 
@@ -192,18 +373,77 @@ auto Args::init(int argc, char *argv[]) -> bool// NOLINT(modernize-avoid-c-array
     }
 
     // Verify that both day and night start values are given
-    if (_day.has_value() != _night.has_value()) {
+    if (_options.start_day.has_value() != _options.start_night.has_value()) {
         fmt::print(stderr, "Nii päeva kui öö väärtused peavad olema antud\n");
         return false;
     }
 
+    // Verify that prices are imported from a file
+    if (_options.import_prices && _options.price_file_name.isEmpty()) {
+        fmt::print(stderr, "Argument '--import' nõuab hinnafaili argumendiga '--prices'\n");
+        return false;
+    }
+
+    // Peaks and distributions are analyzed from all the records at once
+    if (_options.peaks && (_options.prefetch || _options.serve || _options.watch)) {
+        fmt::print(stderr,
+                   "Argumenti '--peaks' ei saa kasutada koos argumentidega '--prefetch', '--serve' ja '--watch'\n");
+        return false;
+    }
+    if (_options.distribution && (_options.prefetch || _options.serve || _options.watch)) {
+        fmt::print(stderr,
+                   "Argumenti '--distribution' ei saa kasutada koos argumentidega '--prefetch', '--serve' ja '--watch'\n");
+        return false;
+    }
+
+    // Daemons do not finish, so there is nothing to report
+    if (_options.profile && (_options.prefetch || _options.serve || _options.watch)) {
+        fmt::print(stderr,
+                   "Argumenti '--profile' ei saa kasutada koos argumentidega '--prefetch', '--serve' ja '--watch'\n");
+        return false;
+    }
+
+    // Only one mode at a time
+    if (_options.watch && (_options.prefetch || _options.serve)) {
+        fmt::print(stderr, "Argumenti '--watch' ei saa kasutada koos argumentidega '--prefetch' ja '--serve'\n");
+        return false;
+    }
+    if (_options.batch && (_options.prefetch || _options.serve || _options.watch)) {
+        fmt::print(stderr,
+                   "Argumenti '--batch' ei saa kasutada koos argumentidega '--prefetch', '--serve' ja '--watch'\n");
+        return false;
+    }
+
+    // The daemon only updates the cache
+    if (_options.prefetch) {
+        if (_options.serve) {
+            fmt::print(stderr, "Argumente '--prefetch' ja '--serve' ei saa koos kasutada\n");
+            return false;
+        }
+        if (!_options.price_file_name.isEmpty()) {
+            fmt::print(stderr, "Argumenti '--prefetch' ei saa kasutada koos hinnafailiga\n");
+            return false;
+        }
+        if (optind != argc) {
+            fmt::print(stderr, "Argumendiga '--prefetch' ei ole failinime vaja\n\n");
+            return false;
+        }
+        return true;
+    }
+
+    // Verify that only one region is given
+    if (_options.regions.size() != 1) {
+        fmt::print(stderr, "Mitu hinnapiirkonda võib anda ainult argumendiga '--prefetch'\n");
+        return false;
+    }
+
     // Verify that the filename is given
     if (optind == argc) {
         fmt::print(stderr, "Faili nimi puudub\n\n");
         printUsage(true, appName);
         return false;
     }
-    _fileName = argv[optind++];
+    _options.file_name = argv[optind++];
 
     // Verify that only one filename is given
     if (optind != argc) {
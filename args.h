@@ -3,86 +3,34 @@
 #ifndef EL_ARGS_H_INCLUDED
 #  define EL_ARGS_H_INCLUDED
 
-#include <QByteArray>
-#include <QDateTime>
-#include <QString>
-
-#include <optional>
+#include "options.h"
 
 namespace El {
 
+/// Command line arguments
+///
+/// Parses the arguments into engine options; the command line tool is a thin front end to the
+/// engine and nothing else reads the arguments.
 class Args {
 public:
 
-    /// Returns the singleton instance of Args
-    static auto instance() -> Args &;
-
-    /// Deleted move and copy operatsions
-    Args(Args const &other)                     = delete;
-    Args(Args &&other)                          = delete;
-    auto operator=(Args const &other) -> Args & = delete;
-    auto operator=(Args &&other) -> Args &      = delete;
+    /// Ctor
+    Args() = default;
 
-    /// Initializes arguments from command line
+    /// Initializes options from command line
     /// @param argc Argument count
     /// @param argv Argument values
     /// @return True if arguments are valid; false otherwise
     auto init(int argc, char *argv[]) -> bool; // NOLINT(modernize-avoid-c-arrays)
 
-    /// Verbose flag
-    auto verbose() const noexcept { return _verbose; }
-
-    /// The name of the CSV file to be processed
-    auto fileName() const noexcept -> auto const & { return _fileName; }
-
-    /// True if prices are requested
-    auto prices() const noexcept { return _prices; }
-
-    /// The name of the JSON file with prices
-    auto priceFileName() const noexcept -> auto const & { return _priceFileName; }
-
-    auto region() const noexcept -> auto const & { return _region; }
-
-    /// Margin EUR/kWh
-    auto margin() const noexcept { return _margin; }
-
-    /// Returns the initial value for day
-    auto startDay() const noexcept { return _day; }
-
-    /// Returns the initial value for night
-    auto startNight() const noexcept { return _night; }
-
-    /// Returns the requested date/time
-    auto time() const noexcept -> auto const & { return _time; }
-
-    /// Returns the VAT value
-    auto km() const noexcept { return _km; }
-
-    /// Returns the Nord Pool price interval in seconds
-    auto interval() const noexcept { return _interval; }
+    /// Returns the options
+    auto options() const noexcept -> auto const & { return _options; }
 
 private:
 
-    static constexpr double DEFAULT_MARGIN   = 0.0;
-    static constexpr int    DEFAULT_INTERVAL = 15 * 60; // 15 minutes
-
     static void printUsage(bool err, char const *appName);
 
-    bool                  _verbose = false;
-    QString               _fileName;
-    bool                  _prices = false;
-    QString               _priceFileName;
-    QString               _region;
-    double                _margin = DEFAULT_MARGIN;
-    std::optional<double> _day;
-    std::optional<double> _night;
-    QDateTime             _time;
-    double                _km       = 0.0;
-    int                   _interval = DEFAULT_INTERVAL;
-
-    /// Private constructor and destructor
-    Args();
-    ~Args() = default;
+    Options _options;
 };
 
 } // namespace El
@@ -0,0 +1,537 @@
+#include "batch.h"
+#include "common.h" // IWYU pragma: keep Needed for formatting Qt types
+#include "engine.h"
+#include "output.h"
+#include "peaks.h"
+#include "prices.h"
+#include "pricetable.h"
+#include "profile.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QtConcurrent>
+
+#include <fmt/base.h>
+#include <fmt/format.h>
+
+#include <cmath>
+#include <cstdio>
+#include <iterator>
+#include <optional>
+
+namespace {
+
+/// Returns the string as a quoted JSON string
+auto json_string(QString const &s) -> std::string
+{
+    std::string r{"\""};
+    for (auto const c : s.toStdString()) {
+        switch (c) {
+            case '"':
+                r += "\\\"";
+                break;
+            case '\\':
+                r += "\\\\";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    r += fmt::format("\\u{:04x}", static_cast<int>(c));
+                }
+                else {
+                    r += c;
+                }
+                break;
+        }
+    }
+    r += '"';
+    return r;
+}
+
+/// Returns the file name extension for the output format
+auto extension(El::Options::Format format) -> char const *
+{
+    switch (format) {
+        case El::Options::Format::Csv:
+            return "csv";
+        case El::Options::Format::Ndjson:
+            return "ndjson";
+        case El::Options::Format::Json:
+            return "json";
+        default:
+            return "txt";
+    }
+}
+
+} // namespace
+
+namespace El {
+
+Batch::Batch(Options const &options, QObject *parent)
+    : QObject(parent)
+    , _options(options)
+{}
+
+Batch::~Batch()
+{
+    // worker threads use the meters
+    _running.waitForFinished();
+}
+
+auto Batch::start() -> bool
+{
+    if (!read_manifest()) {
+        return false;
+    }
+
+    if (_options.verbose) {
+        fmt::print(stderr, "Töötlen {} arvesti andmeid {} lõimes\n", _meters.size(), QThreadPool::globalInstance()->maxThreadCount());
+    }
+
+    // parse all the files in parallel
+    _running = QtConcurrent::map(_meters, [](Meter &meter) {
+        meter.ok = meter.consumption.load(meter.file_name, meter.options.time);
+        if (meter.ok) {
+            meter.start = meter.consumption.records().first().startTime();
+            meter.end   = meter.consumption.records().last().endTime();
+        }
+    });
+    _running.then(this, [this]() { parsed(); });
+
+    return true;
+}
+
+auto Batch::read_manifest() -> bool
+{
+    using namespace Qt::Literals::StringLiterals;
+
+    QFile file{_options.file_name};
+    if (!file.open(QFile::ReadOnly | QFile::Text)) {
+        fmt::print(stderr, "ERROR: manifesti {} avamine ebaõnnestus: {}\n", _options.file_name, file.errorString());
+        return false;
+    }
+
+    auto const dir    = QFileInfo{_options.file_name}.dir();
+    int        lineno = 0;
+
+    // meters are processed in parallel and must not write the same file
+    QSet<QString> outputs{};
+    while (!file.atEnd()) {
+        ++lineno;
+        auto const line = QString::fromUtf8(file.readLine()).trimmed();
+        if (line.isEmpty() || line.startsWith(u'#')) {
+            continue;
+        }
+
+        auto const fields = line.split(u';');
+        auto const field  = [&fields](int i) { return fields.value(i).trimmed(); };
+
+        // empty fields use the values from the command line
+        auto const number = [&](int i, std::optional<double> &value) {
+            if (field(i).isEmpty()) {
+                return true;
+            }
+            bool ok = false;
+            value   = field(i).toDouble(&ok);
+            if (!ok) {
+                fmt::print(stderr, "ERROR: vigane väärtus \"{}\" manifesti {} real {}\n", field(i), _options.file_name, lineno);
+            }
+            return ok;
+        };
+
+        Meter meter{};
+        meter.options   = _options;
+        meter.file_name = QDir::cleanPath(dir.filePath(field(0)));
+        if (field(0).isEmpty() || fields.size() > 6) {
+            fmt::print(stderr, "ERROR: vigane rida manifesti {} real {}\n", _options.file_name, lineno);
+            return false;
+        }
+
+        std::optional<double> margin{};
+        std::optional<double> km{};
+        if (!number(1, margin) || !number(2, km) || !number(3, meter.options.start_day) ||
+            !number(4, meter.options.start_night)) {
+            return false;
+        }
+        if (margin) {
+            meter.options.margin = *margin;
+        }
+        if (km) {
+            meter.options.km = *km / 100.0;
+        }
+        if (meter.options.start_day.has_value() != meter.options.start_night.has_value()) {
+            fmt::print(stderr,
+                       "ERROR: nii päeva kui öö väärtused peavad olema antud manifesti {} real {}\n",
+                       _options.file_name,
+                       lineno);
+            return false;
+        }
+
+        if (!field(5).isEmpty()) {
+            meter.output_name = QDir::cleanPath(dir.filePath(field(5)));
+        }
+        else {
+            QFileInfo const info{meter.file_name};
+            meter.output_name =
+                info.dir().filePath(u"%1.summary.%2"_s.arg(info.completeBaseName(), QLatin1StringView{extension(_options.format)}));
+        }
+        auto const output = QFileInfo{meter.output_name}.absoluteFilePath();
+        if (outputs.contains(output)) {
+            fmt::print(stderr, "ERROR: väljundfail {} on juba kasutusel, manifesti {} rida {}\n", meter.output_name, _options.file_name, lineno);
+            return false;
+        }
+        outputs.insert(output);
+
+        _meters.append(std::move(meter));
+    }
+
+    if (_meters.isEmpty()) {
+        fmt::print(stderr, "ERROR: manifestis {} ei ole ühtegi arvestit\n", _options.file_name);
+        return false;
+    }
+
+    return true;
+}
+
+void Batch::parsed()
+{
+    // time period of all the records
+    QDateTime start{};
+    QDateTime end{};
+    for (auto const &meter : std::as_const(_meters)) {
+        if (!meter.ok) {
+            continue;
+        }
+        auto const &c = meter.consumption;
+        if (start.isNull() || c.first_record_time() < start) {
+            start = c.first_record_time();
+        }
+        if (end.isNull() || c.last_record_time() > end) {
+            end = c.last_record_time();
+        }
+    }
+
+    if (start.isNull()) {
+        fmt::print(stderr, "ERROR: ühegi arvesti andmeid ei õnnestunud laadida\n");
+        emit finished(false);
+        return;
+    }
+
+    if (!_options.prices) {
+        calc();
+        return;
+    }
+
+    // prices for all the meters are loaded once
+    _prices = std::make_unique<Prices>(_options);
+    connect(_prices.get(), &Prices::loaded, this, &Batch::prices_loaded);
+    _prices->load(_options.region(), start, end);
+}
+
+void Batch::prices_loaded(bool ok)
+{
+    if (!ok) {
+        fmt::print(stderr, "WARNING: kõiki hindasid ei õnnestunud laadida\n");
+    }
+
+    _table = _prices->snapshot();
+    _prices.reset();
+
+    calc();
+}
+
+void Batch::calc()
+{
+    // the table is shared by all the worker threads and kept alive until they are done
+    _running = QtConcurrent::map(_meters, [table = _table](Meter &meter) {
+        if (meter.ok) {
+            calc_meter(meter, table.get());
+        }
+    });
+    _running.then(this, [this]() { report(); });
+}
+
+void Batch::calc_meter(Meter &meter, PriceTable const *table)
+{
+    Profile::Scope const profile{"calc_meter"};
+
+    auto *file = std::fopen(QFile::encodeName(meter.output_name).constData(), "w");
+    if (file == nullptr) {
+        fmt::print(stderr, "ERROR: faili {} avamine ebaõnnestus\n", meter.output_name);
+        meter.ok = false;
+        return;
+    }
+
+    {
+        Output output{meter.options, table != nullptr, file};
+        std::optional<Peaks> peaks{};
+        if (meter.options.peaks) {
+            peaks.emplace(meter.options.peak_windows, meter.options.peak_top);
+        }
+        auto const margin = meter.options.net_margin();
+        auto const visit  = [&](Record const &rec, std::optional<double> const &price) {
+            if (peaks) {
+                peaks->add(rec, price, margin);
+            }
+            if (meter.options.distribution) {
+                meter.distributions.add(rec, price);
+            }
+            output.record(rec, price);
+        };
+        meter.summary = Engine::summarize(meter.consumption.records(), table, meter.options, visit);
+        if (peaks) {
+            peaks->finish();
+            output.peaks(*peaks, meter.start, meter.end);
+        }
+        if (meter.options.distribution) {
+            meter.distributions.compress();
+            output.distributions(meter.distributions, meter.start, meter.end);
+        }
+        output.summary(meter.summary, meter.start, meter.end);
+    }
+
+    if (std::fclose(file) != 0) {
+        fmt::print(stderr, "ERROR: faili {} kirjutamine ebaõnnestus\n", meter.output_name);
+        meter.ok = false;
+    }
+
+    // records are no longer needed
+    meter.consumption = {};
+}
+
+void Batch::report()
+{
+    auto const costs = _table != nullptr;
+    auto const dist  = _options.distribution;
+
+    fmt::memory_buffer buf{};
+    auto               it = std::back_inserter(buf);
+
+    switch (_options.format) {
+        case Options::Format::Text: {
+            fmt::format_to(it, "{:<32} {:>12} {:>12} {:>12}", "arvesti", "öö kWh", "päev kWh", "kokku kWh");
+            if (costs) {
+                fmt::format_to(it, " {:>12}", "kokku EUR");
+            }
+            if (dist) {
+                for (auto const *name : Distributions::QUANTILE_NAMES) {
+                    fmt::format_to(it, " {:>9}", fmt::format("{} kWh", name));
+                }
+                if (costs) {
+                    for (auto const *name : Distributions::QUANTILE_NAMES) {
+                        fmt::format_to(it, " {:>9}", fmt::format("{} EUR", name));
+                    }
+                }
+            }
+            buf.push_back('\n');
+            break;
+        }
+        case Options::Format::Csv: {
+            fmt::format_to(it, "row,meter,start,end,night_kwh,day_kwh,total_kwh,cost,records,missing_prices,output");
+            if (dist) {
+                for (auto const *name : Distributions::QUANTILE_NAMES) {
+                    fmt::format_to(it, ",kwh_{}", name);
+                }
+                for (auto const *name : Distributions::QUANTILE_NAMES) {
+                    fmt::format_to(it, ",paid_{}", name);
+                }
+            }
+            buf.push_back('\n');
+            break;
+        }
+        case Options::Format::Json: {
+            fmt::format_to(it, R"({{"meters":[)");
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+
+    // quantiles of interval consumption and of prices weighted by the consumption (with VAT)
+    auto const json_quantiles = [&](char const *key, Digest const &digest, double scale) {
+        fmt::format_to(it, R"("{}":{{)", key);
+        for (size_t i = 0; i < Distributions::QUANTILES.size(); ++i) {
+            auto const v = digest.quantile(Distributions::QUANTILES.at(i)) * scale;
+            if (i > 0) {
+                buf.push_back(',');
+            }
+            if (std::isfinite(v)) {
+                fmt::format_to(it, R"("{}":{})", Distributions::QUANTILE_NAMES.at(i), v);
+            }
+            else {
+                fmt::format_to(it, R"("{}":null)", Distributions::QUANTILE_NAMES.at(i));
+            }
+        }
+        buf.push_back('}');
+    };
+
+    // one row per meter and a row with the totals of all the meters
+    auto const row = [&](QString const *name, Summary const &s, Money cost, QDateTime const &start,
+                         QDateTime const &end, QString const *output, bool first, Distribution const &d,
+                         double km) {
+        auto const start_s = start.toString(Qt::ISODate);
+        auto const end_s   = end.toString(Qt::ISODate);
+
+        switch (_options.format) {
+            case Options::Format::Text: {
+                fmt::format_to(it,
+                               "{:<32} {:12.3f} {:12.3f} {:12.3f}",
+                               name ? QFileInfo{*name}.fileName() : QStringLiteral("kokku"),
+                               s.night_kwh(),
+                               s.day_kwh(),
+                               s.total_kwh());
+                if (costs) {
+                    fmt::format_to(it, " {:12.2f}", to_eur(cost));
+                }
+                if (dist) {
+                    for (auto const q : Distributions::QUANTILES) {
+                        fmt::format_to(it, " {:9.3f}", d.kwh.quantile(q));
+                    }
+                    if (costs) {
+                        for (auto const q : Distributions::QUANTILES) {
+                            fmt::format_to(it, " {:9.4f}", d.paid.quantile(q) * (1.0 + km));
+                        }
+                    }
+                }
+                buf.push_back('\n');
+                break;
+            }
+            case Options::Format::Csv: {
+                fmt::format_to(it,
+                               "{},{},{},{},{},{},{},",
+                               name ? "meter" : "total",
+                               name ? *name : QString{},
+                               start_s,
+                               end_s,
+                               s.night_kwh(),
+                               s.day_kwh(),
+                               s.total_kwh());
+                if (costs) {
+                    fmt::format_to(it, "{}", to_eur(cost));
+                }
+                fmt::format_to(it, ",{},{},{}", s.records, s.missing, output ? *output : QString{});
+                if (dist) {
+                    for (auto const *digest : {&d.kwh, &d.paid}) {
+                        auto const scale = digest == &d.paid ? 1.0 + km : 1.0;
+                        for (auto const q : Distributions::QUANTILES) {
+                            auto const v = digest->quantile(q) * scale;
+                            buf.push_back(',');
+                            if (std::isfinite(v)) {
+                                fmt::format_to(it, "{}", v);
+                            }
+                        }
+                    }
+                }
+                buf.push_back('\n');
+                break;
+            }
+            case Options::Format::Ndjson:
+            case Options::Format::Json: {
+                if (_options.format == Options::Format::Json && !first) {
+                    buf.push_back(',');
+                }
+                buf.push_back('{');
+                if (_options.format == Options::Format::Ndjson) {
+                    fmt::format_to(it, R"("row":"{}",)", name ? "meter" : "total");
+                }
+                if (name) {
+                    fmt::format_to(it, R"("meter":{},)", json_string(*name));
+                }
+                fmt::format_to(it,
+                               R"("start":"{}","end":"{}","night_kwh":{},"day_kwh":{},"total_kwh":{})",
+                               start_s,
+                               end_s,
+                               s.night_kwh(),
+                               s.day_kwh(),
+                               s.total_kwh());
+                if (costs) {
+                    fmt::format_to(it, R"(,"cost":{})", to_eur(cost));
+                }
+                fmt::format_to(it, R"(,"records":{})", s.records);
+                if (costs) {
+                    fmt::format_to(it, R"(,"missing_prices":{})", s.missing);
+                }
+                if (output) {
+                    fmt::format_to(it, R"(,"output":{})", json_string(*output));
+                }
+                if (dist) {
+                    fmt::format_to(it, R"(,"distribution":{{)");
+                    json_quantiles("kwh", d.kwh, 1.0);
+                    if (costs) {
+                        buf.push_back(',');
+                        json_quantiles("paid", d.paid, 1.0 + km);
+                    }
+                    buf.push_back('}');
+                }
+                buf.push_back('}');
+                if (_options.format == Options::Format::Ndjson) {
+                    buf.push_back('\n');
+                }
+                break;
+            }
+        }
+    };
+
+    Summary       total{};
+    Distributions fleet{};
+    Money         total_cost = 0;
+    QDateTime start{};
+    QDateTime end{};
+    bool      ok    = true;
+    bool      first = true;
+    for (auto const &meter : std::as_const(_meters)) {
+        if (!meter.ok) {
+            ok = false;
+            continue;
+        }
+
+        // costs with the VAT of the meter
+        auto const cost = with_vat(meter.summary.total_cost(), meter.options.km);
+        row(&meter.file_name,
+            meter.summary,
+            cost,
+            meter.start,
+            meter.end,
+            &meter.output_name,
+            first,
+            meter.distributions.total(),
+            meter.options.km);
+        first = false;
+
+        total = total + meter.summary;
+        if (dist) {
+            fleet.merge(meter.distributions);
+        }
+        total_cost += cost;
+        if (start.isNull() || meter.start < start) {
+            start = meter.start;
+        }
+        if (end.isNull() || meter.end > end) {
+            end = meter.end;
+        }
+    }
+
+    if (!first) {
+        if (_options.format == Options::Format::Json) {
+            fmt::format_to(it, R"(],"total":)");
+            first = true;
+        }
+        row(nullptr, total, total_cost, start, end, nullptr, first, fleet.total(), _options.km);
+    }
+    else if (_options.format == Options::Format::Json) {
+        fmt::format_to(it, R"(],"total":null)");
+    }
+    if (_options.format == Options::Format::Json) {
+        fmt::format_to(it, "}}\n");
+    }
+
+    std::fwrite(buf.data(), 1, buf.size(), stdout);
+    std::fflush(stdout);
+
+    _table.reset();
+    emit finished(ok);
+}
+
+} // namespace El
@@ -0,0 +1,113 @@
+#pragma once
+
+#ifndef EL_BATCH_H_INCLUDED
+#  define EL_BATCH_H_INCLUDED
+
+#include "consumption.h"
+#include "distribution.h"
+#include "options.h"
+#include "summary.h"
+
+#include <QDateTime>
+#include <QFuture>
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#include <memory>
+
+namespace El {
+
+class PriceTable;
+class Prices;
+
+/// Processes the consumption files of several meters listed in a manifest file
+///
+/// Every line of the manifest is `<file>[;<margin>[;<km%>[;<day>;<night>[;<output>]]]]`. Empty
+/// fields use the values from the command line, relative file names are relative to the
+/// manifest and lines starting with `#` are comments.
+///
+/// The files are parsed in parallel on the global thread pool. Prices are loaded once for the
+/// time period of all the files into a read-only table that the meters share, and the meters are
+/// calculated in parallel again. The results of every meter are written to its own output file
+/// (`<file>.summary.<format>` by default) and a combined report with one row per meter and the
+/// totals is written to stdout.
+class Batch : public QObject {
+    Q_OBJECT
+
+public:
+
+    /// Ctor
+    /// @param[in] options Engine options; `file_name` is the manifest
+    /// @param[in] parent Optional parent
+    Batch(Options const &options, QObject *parent = nullptr);
+
+    /// Dtor
+    ~Batch() override;
+
+    /// Reads the manifest and starts processing the meters
+    /// @return true if succeeded, otherwise false
+    auto start() -> bool;
+
+signals:
+
+    /// Emitted when all the meters are processed
+    /// @param[in] ok true if all the meters succeeded, otherwise false
+    void finished(bool ok);
+
+private:
+
+    /// One meter from the manifest
+    struct Meter {
+        QString       file_name;     ///< CSV file with consumption records
+        QString       output_name;   ///< File for the results of this meter
+        Options       options;       ///< Options with the values from the manifest
+        Consumption   consumption;   ///< Consumption records (released when calculated)
+        Summary       summary;       ///< Consumption and cost totals
+        Distributions distributions; ///< Distributions of consumption and prices (if requested)
+        QDateTime     start;         ///< Start time of the first record
+        QDateTime     end;           ///< End time of the last record
+        bool          ok = false;    ///< true if the file was loaded and results written
+    };
+
+    /// Engine options
+    Options const &_options;
+
+    /// Meters from the manifest
+    QVector<Meter> _meters;
+
+    /// Nord Pool prices (if requested)
+    std::unique_ptr<Prices> _prices;
+
+    /// Read-only prices shared by the worker threads
+    std::shared_ptr<PriceTable const> _table;
+
+    /// Parsing or calculating the meters in worker threads
+    QFuture<void> _running;
+
+    /// Reads the manifest
+    /// @return true if succeeded, otherwise false
+    auto read_manifest() -> bool;
+
+    /// Called when all the files are parsed
+    void parsed();
+
+    /// Called when prices are loaded
+    /// @param[in] ok true if succeeded, otherwise false
+    void prices_loaded(bool ok);
+
+    /// Calculates the meters in parallel
+    void calc();
+
+    /// Writes the combined report and emits `finished()`
+    void report();
+
+    /// Calculates one meter and writes its results; called from worker threads
+    /// @param[in,out] meter The meter
+    /// @param[in] table Prices or NULL if costs are not calculated
+    static void calc_meter(Meter &meter, PriceTable const *table);
+};
+
+} // namespace El
+
+#endif
@@ -0,0 +1,178 @@
+#include "generate.h"
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+#include <QTime>
+
+#include <fmt/format.h>
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+constexpr std::array<char const *, 4> REGIONS = {"ee", "fi", "lt", "lv"};
+
+/// Mixes bits of the value (splitmix64)
+constexpr auto mix(std::uint64_t x) -> std::uint64_t
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30U)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27U)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31U);
+}
+
+} // namespace
+
+namespace El::Bench {
+
+// -----------------------------------------------------------------------------
+
+auto synthetic_price(qint64 time_s, QString const &region) -> double
+{
+    constexpr double SECS_IN_DAY = 86'400.0;
+    constexpr double BASE        = 60.0;
+    constexpr double DAILY       = 40.0;
+    constexpr double NOISE       = 20.0;
+    constexpr int    NOISE_STEPS = 10'000;
+    constexpr double PI          = 3.14159265358979323846;
+
+    // daily cycle with deterministic noise that differs between regions
+    auto const phase = 2.0 * PI * std::fmod(static_cast<double>(time_s), SECS_IN_DAY) / SECS_IN_DAY;
+    auto const noise = static_cast<double>(mix(static_cast<std::uint64_t>(time_s) ^ qHash(region)) % NOISE_STEPS) /
+                       NOISE_STEPS;
+    return BASE - DAILY * std::cos(phase) + NOISE * noise;
+}
+
+auto price_interval(qint64 time_s) -> qint64
+{
+    constexpr qint64 SECS_IN_HOUR = 3'600;
+    constexpr qint64 SECS_IN_15MIN = 900;
+    return time_s < PRICE_15MIN_START_S ? SECS_IN_HOUR : SECS_IN_15MIN;
+}
+
+auto price_document(QDateTime const &start, QDateTime const &end, qint64 &count) -> QByteArray
+{
+    auto const start_s = start.toSecsSinceEpoch();
+    auto const end_s   = end.toSecsSinceEpoch();
+
+    QByteArray doc{};
+    doc.reserve(static_cast<qsizetype>((end_s - start_s) / 900 + 1) * 50 * static_cast<qsizetype>(REGIONS.size()));
+    doc.append(R"({"success":true,"data":{)");
+
+    count = 0;
+    bool first_region = true;
+    for (auto const *region : REGIONS) {
+        if (!first_region) {
+            doc.append(',');
+        }
+        first_region = false;
+
+        doc.append('"').append(region).append(R"(":[)");
+
+        // the first price at or after the start time
+        auto const interval = price_interval(start_s);
+        auto       time     = ((start_s + interval - 1) / interval) * interval;
+        qint64     n        = 0;
+        while (time <= end_s) {
+            if (n > 0) {
+                doc.append(',');
+            }
+            doc.append(R"({"timestamp":)")
+                .append(QByteArray::number(time))
+                .append(R"(,"price":)")
+                .append(QByteArray::number(synthetic_price(time, QString::fromLatin1(region)), 'f', 2))
+                .append('}');
+            ++n;
+            time += price_interval(time);
+        }
+        doc.append(']');
+        count = n;
+    }
+
+    doc.append("}}");
+    return doc;
+}
+
+auto consumption_csv(CsvOptions const &options, qint64 &count) -> QByteArray
+{
+    // preamble and header like in the files exported from elering.ee
+    auto const preamble = fmt::format("\xEF\xBB\xBF"
+                                      "EIC;00ZEE-00000000-C\n"
+                                      "Seerianumber;00000000\n"
+                                      "Periood;{} kuni {}\n"
+                                      "\"\"\n"
+                                      "Algusaeg{}{};Tarbimine{}{}\n",
+                                      options.start.toString(Qt::ISODate).toStdString(),
+                                      options.end.toString(Qt::ISODate).toStdString(),
+                                      options.end_time ? ";Lõppaeg" : "",
+                                      options.type ? ";Päev/öö" : "",
+                                      options.exported ? ";Võrku antud" : "",
+                                      options.quantity_type ? ";Tunnikoguse tüüp" : "");
+
+    QByteArray csv{preamble.data(), static_cast<qsizetype>(preamble.size())};
+    count = 0;
+
+    auto       time = QDateTime{options.start, QTime{0, 0}};
+    auto const end  = QDateTime{options.end.addDays(1), QTime{0, 0}};
+    while (time < end) {
+        constexpr int NIGHT_END   = 7;
+        constexpr int NIGHT_START = 23;
+        constexpr int MAX_WH      = 400;
+
+        auto const hour  = time.time().hour();
+        auto const night = hour < NIGHT_END || hour >= NIGHT_START;
+        auto const wh    = static_cast<int>(mix(static_cast<std::uint64_t>(time.toSecsSinceEpoch())) % MAX_WH);
+        auto const next  = time.addSecs(options.interval_s);
+
+        csv.append(time.toString(QStringLiteral("dd.MM.yyyy hh:mm")).toLatin1());
+        if (options.end_time) {
+            csv.append(';').append(next.toString(QStringLiteral("dd.MM.yyyy hh:mm")).toLatin1());
+        }
+        if (options.type) {
+            csv.append(night ? ";Öö" : ";Päev");
+        }
+        csv.append(';').append(QByteArray::number(wh / 1000)).append(',');
+        csv.append(QByteArray::number(wh % 1000).rightJustified(3, '0'));
+        if (options.exported) {
+            // solar panels export during the day only
+            csv.append(';');
+            if (!night) {
+                auto const export_wh = (wh * 3) % MAX_WH;
+                csv.append(QByteArray::number(export_wh / 1000)).append(',');
+                csv.append(QByteArray::number(export_wh % 1000).rightJustified(3, '0'));
+            }
+        }
+        if (options.quantity_type) {
+            csv.append(";Tegelik");
+        }
+        csv.append('\n');
+        ++count;
+
+        time = next;
+    }
+
+    return csv;
+}
+
+auto write_consumption_csv(QString const &filename, CsvOptions const &options) -> qint64
+{
+    QFile file{filename};
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+        fmt::print(stderr, "Failed to create {}: {}\n", filename.toStdString(), file.errorString().toStdString());
+        return -1;
+    }
+
+    qint64     count = 0;
+    auto const csv   = consumption_csv(options, count);
+    if (file.write(csv) != csv.size()) {
+        fmt::print(stderr, "Failed to write {}: {}\n", filename.toStdString(), file.errorString().toStdString());
+        return -1;
+    }
+
+    return count;
+}
+
+} // namespace El::Bench
@@ -0,0 +1,61 @@
+#pragma once
+
+#ifndef EL_BENCH_GENERATE_H_INCLUDED
+#  define EL_BENCH_GENERATE_H_INCLUDED
+
+#include <QByteArray>
+#include <QDate>
+#include <QDateTime>
+#include <QString>
+#include <QtGlobal>
+
+namespace El::Bench {
+
+/// Time when Nord Pool switched from hourly to 15 minute prices (2025-10-01 00:00 EEST)
+constexpr qint64 PRICE_15MIN_START_S = 1'759'266'000;
+
+/// Returns a deterministic synthetic Nord Pool price
+/// @param[in] time_s Seconds since the EPOCH
+/// @param[in] region Price region
+/// @return Price EUR/MWh without taxes
+auto synthetic_price(qint64 time_s, QString const &region) -> double;
+
+/// Returns the price interval used by Nord Pool at the given time
+/// @param[in] time_s Seconds since the EPOCH
+/// @return Interval in seconds
+auto price_interval(qint64 time_s) -> qint64;
+
+/// Returns a JSON document with prices for all the regions like the one returned by the Elering
+/// service
+/// @param[in] start Start time
+/// @param[in] end End time
+/// @param[out] count Set to the number of prices per region
+/// @return JSON document
+auto price_document(QDateTime const &start, QDateTime const &end, qint64 &count) -> QByteArray;
+
+/// Options for generated consumption CSV files
+struct CsvOptions {
+    QDate start;                   ///< First day
+    QDate end;                     ///< Last day
+    int   interval_s    = 15 * 60; ///< Interval of consumption records in seconds
+    bool  end_time      = false;   ///< Adds the end time column
+    bool  type          = true;    ///< Adds the day/night column
+    bool  quantity_type = false;   ///< Adds the quantity type column (`Tegelik`)
+    bool  exported      = false;   ///< Adds the grid export column; empty at night
+};
+
+/// Returns the contents of a consumption CSV file in the Elering format
+/// @param[in] options Generator options
+/// @param[out] count Set to the number of records
+/// @return The CSV file
+auto consumption_csv(CsvOptions const &options, qint64 &count) -> QByteArray;
+
+/// Writes a consumption CSV file in the Elering format
+/// @param[in] filename Name of the CSV file
+/// @param[in] options Generator options
+/// @return Number of records written or -1 on errors
+auto write_consumption_csv(QString const &filename, CsvOptions const &options) -> qint64;
+
+} // namespace El::Bench
+
+#endif
@@ -0,0 +1,684 @@
+#include "generate.h"
+
+#include "cache.h"
+#include "common.h"
+#include "consumption.h"
+#include "header.h"
+#include "json.h"
+#include "options.h"
+#include "record.h"
+#include "rowparser.h"
+
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QVector>
+
+#include <fmt/base.h>
+#include <fmt/format.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <utility>
+
+#include <getopt.h>
+
+namespace {
+
+/// Number of heap allocations since the start of the process
+std::atomic<std::uint64_t> allocations{0};
+
+} // namespace
+
+#if defined(__GLIBC__)
+
+// Counts malloc, calloc and realloc calls of the whole process. Qt containers allocate with
+// malloc directly, so replacing operator new would miss most of the allocations.
+extern "C" {
+
+auto __libc_malloc(std::size_t size) noexcept -> void *;            // NOLINT(bugprone-reserved-identifier)
+auto __libc_calloc(std::size_t n, std::size_t size) noexcept -> void *; // NOLINT(bugprone-reserved-identifier)
+auto __libc_realloc(void *ptr, std::size_t size) noexcept -> void *; // NOLINT(bugprone-reserved-identifier)
+
+auto malloc(std::size_t size) noexcept -> void *
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+auto calloc(std::size_t n, std::size_t size) noexcept -> void *
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(n, size);
+}
+
+auto realloc(void *ptr, std::size_t size) noexcept -> void *
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+} // extern "C"
+
+constexpr bool COUNTS_ALLOCATIONS = true;
+
+#else
+
+constexpr bool COUNTS_ALLOCATIONS = false;
+
+#endif
+
+namespace {
+
+constexpr char const *USAGE = R"(
+USAGE: {0} [args] [<file>...]
+
+Microbenchmarks for parsing consumption records, looking up and merging prices, parsing Nord Pool
+JSON documents and reading the price cache. Reports records per second and heap allocations per
+record. Data is generated deterministically.
+
+args:
+    -h,--help               Shows this help text.
+    -c,--check              Checks that RowParser and Record parse every generated layout and
+                            the CSV files <file>... the same way and that replacing cached prices
+                            leaves no old prices in the replaced period, and exits; fails on
+                            differences.
+    -d,--days <n>           Length of generated data in days (default {1}).
+    -f,--filter <s>         Runs only benchmarks with <s> in the name.
+    -m,--min-time <s>       Minimum run time of one benchmark in seconds (default {2}).
+    --write-csv <file>      Writes a consumption CSV file and exits.
+    --write-json <file>     Writes a Nord Pool JSON document and exits.
+    --write-cache <dir>     Writes a price cache for region "ee" in <dir> and exits.
+    --end-time              Generated CSV files have the end time column.
+    --no-type               Generated CSV files do not have the day/night column.
+    --quantity-type         Generated CSV files have the quantity type column.
+    --export                Generated CSV files have the grid export column.
+
+EXAMPLE:
+
+> {0} --days=730 --filter=record
+> {0} --check sample/tarbimisandmed.csv
+> {0} --days=1825 --write-cache=/tmp/elekter-cache
+> elekter --cache=/tmp/elekter-cache -p 2025.csv
+)";
+
+constexpr int    DEFAULT_DAYS     = 365;
+constexpr double DEFAULT_MIN_TIME = 0.5;
+
+/// Start date of generated data
+constexpr int START_YEAR = 2025;
+
+/// Number of price lookups in one round; lookups are linear in the number of prices
+constexpr int LOOKUPS = 1'000;
+
+/// Size of parts fed to the streaming JSON parser
+constexpr qsizetype JSON_PART_SIZE = 16 * 1024;
+
+/// Number of differing rows printed per layout by `--check`
+constexpr qsizetype MAX_REPORTED = 10;
+
+enum LongOption : int {
+    WRITE_CSV = 256,
+    WRITE_JSON,
+    WRITE_CACHE,
+    END_TIME,
+    NO_TYPE,
+    QUANTITY_TYPE,
+    EXPORTED,
+};
+
+constexpr char const         *shortOpts  = "hcd:f:m:";
+constexpr struct option const longOpts[] = { // NOLINT(modernize-avoid-c-arrays)
+    {"help",          no_argument,       nullptr, 'h'          },
+    {"check",         no_argument,       nullptr, 'c'          },
+    {"days",          required_argument, nullptr, 'd'          },
+    {"filter",        required_argument, nullptr, 'f'          },
+    {"min-time",      required_argument, nullptr, 'm'          },
+    {"write-csv",     required_argument, nullptr, WRITE_CSV    },
+    {"write-json",    required_argument, nullptr, WRITE_JSON   },
+    {"write-cache",   required_argument, nullptr, WRITE_CACHE  },
+    {"end-time",      no_argument,       nullptr, END_TIME     },
+    {"no-type",       no_argument,       nullptr, NO_TYPE      },
+    {"quantity-type", no_argument,       nullptr, QUANTITY_TYPE},
+    {"export",        no_argument,       nullptr, EXPORTED     },
+    {nullptr,         0,                 nullptr, 0            }
+};
+
+/// Sink for benchmark results, so that the compiler cannot drop the work
+double sink = 0.0;
+
+/// Runs benchmarks and prints results
+class Runner {
+public:
+
+    Runner(QString filter, double min_time)
+        : _filter(std::move(filter))
+        , _min_time(min_time)
+    {
+        fmt::print("{:36} {:>8} {:>14} {:>10} {:>12}\n", "benchmark", "rounds", "records/s", "ns/record", "allocs/rec");
+    }
+
+    /// Runs the benchmark function repeatedly for at least the minimum time
+    /// @param[in] name Name of the benchmark
+    /// @param[in] fn Function that runs one round and returns the number of records processed
+    template <typename Fn>
+    void run(char const *name, Fn &&fn)
+    {
+        if (!_filter.isEmpty() && !QString::fromLatin1(name).contains(_filter)) {
+            return;
+        }
+
+        // warm up caches and lazily initialized data
+        fn();
+
+        qint64     records = 0;
+        int        rounds  = 0;
+        auto const allocs  = allocations.load(std::memory_order_relaxed);
+        auto const start   = std::chrono::steady_clock::now();
+        double     seconds = 0.0;
+        do {
+            records += fn();
+            ++rounds;
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } while (seconds < _min_time);
+        auto const count = allocations.load(std::memory_order_relaxed) - allocs;
+
+        auto const n = static_cast<double>(std::max<qint64>(records, 1));
+        if (COUNTS_ALLOCATIONS) {
+            fmt::print("{:36} {:>8} {:>14.0f} {:>10.1f} {:>12.2f}\n",
+                       name,
+                       rounds,
+                       n / seconds,
+                       seconds * 1e9 / n,
+                       static_cast<double>(count) / n);
+        }
+        else {
+            fmt::print("{:36} {:>8} {:>14.0f} {:>10.1f} {:>12}\n", name, rounds, n / seconds, seconds * 1e9 / n, "n/a");
+        }
+    }
+
+private:
+
+    QString _filter;
+    double  _min_time;
+};
+
+/// Header and record lines of a generated CSV file
+struct CsvLines {
+    El::Header        header;
+    QVector<QByteArray> lines;
+};
+
+/// Splits a CSV file into the header and record lines
+///
+/// The header follows an empty line or a line with two quotes, like in `Consumption::load()`.
+auto split_csv(QByteArray const &csv) -> CsvLines
+{
+    CsvLines result{};
+
+    bool skip   = true;
+    bool header = true;
+    for (auto const &raw : csv.split('\n')) {
+        auto const line = raw.trimmed();
+        if (skip) {
+            skip = !line.isEmpty() && line != "\"\"";
+            continue;
+        }
+        if (header) {
+            result.header = El::Header{line};
+            header        = false;
+            continue;
+        }
+        if (!line.isEmpty()) {
+            result.lines.append(line);
+        }
+    }
+    return result;
+}
+
+/// Generates a CSV file and splits it into lines
+auto csv_lines(El::Bench::CsvOptions const &options) -> CsvLines
+{
+    qint64 count = 0;
+    return split_csv(El::Bench::consumption_csv(options, count));
+}
+
+/// Returns the first difference between two records or an empty string if they are the same
+auto difference(El::Record const &expected, El::Record const &actual) -> std::string
+{
+    if (expected.isValid() != actual.isValid()) {
+        return fmt::format("valid {} != {}", expected.isValid(), actual.isValid());
+    }
+    if (!expected.isValid()) {
+        return {};
+    }
+    if (expected.startTime() != actual.startTime()) {
+        return fmt::format("start {} != {}", expected.startTime(), actual.startTime());
+    }
+    if (expected.endTime() != actual.endTime()) {
+        return fmt::format("end {} != {}", expected.endTime(), actual.endTime());
+    }
+    if (expected.kWh() != actual.kWh()) {
+        return fmt::format("kWh {} != {}", expected.kWh(), actual.kWh());
+    }
+    if (expected.isNight() != actual.isNight()) {
+        return fmt::format("night {} != {}", expected.isNight(), actual.isNight());
+    }
+    if (expected.isPeak() != actual.isPeak()) {
+        return fmt::format("peak {} != {}", expected.isPeak(), actual.isPeak());
+    }
+    if (expected.exportedKWh() != actual.exportedKWh()) {
+        return fmt::format("export {} != {}", expected.exportedKWh(), actual.exportedKWh());
+    }
+    return {};
+}
+
+/// Parses the rows with `Record` and `RowParser` and prints the differences
+/// @param[in] name Name of the layout or the file
+/// @param[in] csv Header and record lines
+/// @return true if both parsers give the same records
+auto check_rows(QString const &name, CsvLines const &csv) -> bool
+{
+    El::RowParser const parser{csv.header};
+    if (!csv.header.isValid() || !parser.isValid()) {
+        fmt::print(stderr, "{}: the layout is not supported\n", name);
+        return false;
+    }
+
+    qsizetype failed = 0;
+    int       lineno = 0;
+    for (auto const &line : csv.lines) {
+        ++lineno;
+        El::Record const expected{lineno, line, csv.header};
+        auto const       diff = difference(expected, parser.parse(lineno, line));
+        if (diff.empty()) {
+            continue;
+        }
+        if (failed < MAX_REPORTED) {
+            fmt::print(stderr, "{}: line #{}: {}\n", name, lineno, diff);
+        }
+        ++failed;
+    }
+
+    fmt::print("{:36} {:>8} rows {:>8} differences\n", name, csv.lines.size(), failed);
+    return failed == 0;
+}
+
+/// Returns synthetic 15 minute prices for region "ee"
+/// @param[in] start First day
+/// @param[in] days Number of days
+/// @param[in] gap_hours Hours without prices at the end of every day
+auto price_blocks(QDate const &start, int days, int gap_hours = 0) -> El::PriceBlocks
+{
+    constexpr qint64 INTERVAL_S = 15 * 60;
+    constexpr qint64 HOUR_S     = 60 * 60;
+
+    El::PriceBlocks result{};
+    for (int day = 0; day < days; ++day) {
+        auto const day_start = QDateTime{start.addDays(day), QTime{0, 0}}.toSecsSinceEpoch();
+        auto const day_end   = QDateTime{start.addDays(day + 1), QTime{0, 0}}.toSecsSinceEpoch() - gap_hours * HOUR_S;
+
+        El::PriceBlock block{};
+        for (auto t = day_start; t < day_end; t += INTERVAL_S) {
+            block.append(El::Price{QDateTime::fromSecsSinceEpoch(t), El::Bench::synthetic_price(t, QStringLiteral("ee"))});
+        }
+        result.append(std::move(block));
+    }
+    return result;
+}
+
+/// Returns evenly spread lookup times over the period
+auto lookup_times(QDate const &start, int days) -> QVector<QDateTime>
+{
+    auto const first = QDateTime{start, QTime{0, 0}}.toSecsSinceEpoch();
+    auto const last  = QDateTime{start.addDays(days), QTime{0, 0}}.toSecsSinceEpoch() - 1;
+
+    QVector<QDateTime> result{};
+    result.reserve(LOOKUPS);
+    for (int i = 0; i < LOOKUPS; ++i) {
+        result.append(QDateTime::fromSecsSinceEpoch(first + (last - first) * i / LOOKUPS));
+    }
+    return result;
+}
+
+/// Returns one block of 15 minute prices from `first` to `last` (inclusive)
+auto price_block(QDateTime const &first, QDateTime const &last, double offset) -> El::PriceBlocks
+{
+    El::PriceBuilder builder{};
+    for (auto t = first.toSecsSinceEpoch(); t <= last.toSecsSinceEpoch(); t += El::INTERVAL_S) {
+        builder.add({QDateTime::fromSecsSinceEpoch(t), El::Bench::synthetic_price(t, QStringLiteral("ee")) + offset});
+    }
+    return builder.finish();
+}
+
+/// Replaces the prices of one day in a cached block with prices for half of the day and checks
+/// that none of the old prices remain valid within the day
+/// @param[in] start First of the three days
+/// @return true if the cache returns exactly the expected prices
+auto check_replace(QDate const &start) -> bool
+{
+    auto const day = [&start](int n, int hour, int minute) { return QDateTime{start.addDays(n), QTime{hour, minute}}; };
+
+    // the second day is replaced with prices for its first 12 hours
+    El::TimePair const period{day(1, 0, 0), day(1, 23, 45)};
+    El::TimePair const received{day(1, 0, 0), day(1, 11, 45)};
+    constexpr double   NEW_PRICE = 1.0;
+
+    bool ok = true;
+    for (auto const &[name, old] : {
+             std::pair{"replace/block over the day", El::TimePair{day(0, 0, 0), day(2, 23, 45)}},
+             std::pair{"replace/block ending in the day", El::TimePair{day(0, 0, 0), day(1, 17, 45)}},
+             std::pair{"replace/block starting in the day", El::TimePair{day(1, 6, 0), day(2, 23, 45)}},
+         }) {
+        QTemporaryDir tmp{};
+        El::Options   options{};
+        options.cache_dir = tmp.path();
+
+        El::PriceBlocks prices{};
+        try {
+            El::Cache const cache{options};
+            cache.store_prices(QStringLiteral("ee"), price_block(old.start, old.end, 0.0));
+            cache.replace_prices(QStringLiteral("ee"), period, price_block(received.start, received.end, NEW_PRICE));
+            prices = cache.get_prices(QStringLiteral("ee"), day(0, 0, 0), day(2, 23, 45));
+        }
+        catch (El::Exception const &ex) {
+            fmt::print(stderr, "{}: {}\n", name, ex.what());
+            ok = false;
+            continue;
+        }
+
+        // every interval has the new price, the old price or no price at all
+        qsizetype intervals = 0;
+        qsizetype failed    = 0;
+        for (auto t = day(0, 0, 0); t <= day(2, 23, 45); t = t.addSecs(El::INTERVAL_S)) {
+            std::optional<double> expected{};
+            if (t >= received.start && t <= received.end) {
+                expected = El::Bench::synthetic_price(t.toSecsSinceEpoch(), QStringLiteral("ee")) + NEW_PRICE;
+            }
+            else if ((t < period.start || t > period.end) && t >= old.start && t <= old.end) {
+                expected = El::Bench::synthetic_price(t.toSecsSinceEpoch(), QStringLiteral("ee"));
+            }
+
+            ++intervals;
+            auto const actual  = prices.get_price(t);
+            auto const covered = prices.get_missing_blocks(t, t).isEmpty();
+            if (actual == expected && covered == expected.has_value()) {
+                continue;
+            }
+            if (failed < MAX_REPORTED) {
+                fmt::print(stderr,
+                           "{}: {}: price {} covered {}, expected {}\n",
+                           name,
+                           t,
+                           actual ? fmt::format("{}", *actual) : std::string{"-"},
+                           covered,
+                           expected ? fmt::format("{}", *expected) : std::string{"-"});
+            }
+            ++failed;
+        }
+
+        fmt::print("{:36} {:>8} intervals {:>3} differences\n", name, intervals, failed);
+        ok = failed == 0 && ok;
+    }
+    return ok;
+}
+
+/// Writes the file or prints an error
+auto write_file(QString const &filename, QByteArray const &data) -> bool
+{
+    QFile file{filename};
+    if (!file.open(QFile::WriteOnly | QFile::Truncate) || file.write(data) != data.size()) {
+        fmt::print(stderr, "Failed to write {}: {}\n", filename, file.errorString());
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+auto main(int argc, char *argv[]) -> int
+{
+    int                    days     = DEFAULT_DAYS;
+    double                 min_time = DEFAULT_MIN_TIME;
+    QString                filter{};
+    QString                write_csv{};
+    QString                write_json{};
+    QString                write_cache{};
+    bool                   check = false;
+    El::Bench::CsvOptions  csv_options{};
+
+    int c   = 0;
+    int idx = 0;
+    while ((c = getopt_long(argc, argv, shortOpts, longOpts, &idx)) != -1) {
+        switch (c) {
+            case 'c': check = true; break;
+            case 'd': days = std::atoi(optarg); break;
+            case 'f': filter = QString::fromLocal8Bit(optarg); break;
+            case 'm': min_time = std::strtod(optarg, nullptr); break;
+            case WRITE_CSV: write_csv = QString::fromLocal8Bit(optarg); break;
+            case WRITE_JSON: write_json = QString::fromLocal8Bit(optarg); break;
+            case WRITE_CACHE: write_cache = QString::fromLocal8Bit(optarg); break;
+            case END_TIME: csv_options.end_time = true; break;
+            case NO_TYPE: csv_options.type = false; break;
+            case QUANTITY_TYPE: csv_options.quantity_type = true; break;
+            case EXPORTED: csv_options.exported = true; break;
+            case 'h': {
+                fmt::print(USAGE, argv[0], DEFAULT_DAYS, DEFAULT_MIN_TIME);
+                return EXIT_SUCCESS;
+            }
+            default: {
+                fmt::print(stderr, USAGE, argv[0], DEFAULT_DAYS, DEFAULT_MIN_TIME);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    if (days <= 0) {
+        fmt::print(stderr, "Invalid number of days\n");
+        return EXIT_FAILURE;
+    }
+
+    QDate const     start{START_YEAR, 1, 1};
+    QDateTime const start_time{start, QTime{0, 0}};
+    QDateTime const end_time = QDateTime{start.addDays(days), QTime{0, 0}}.addSecs(-1);
+    csv_options.start        = start;
+    csv_options.end          = start.addDays(days - 1);
+
+    // the SQLite driver needs the application instance; the event loop is never started
+    QCoreApplication app{argc, argv};
+
+    // never touch the real price cache
+    QTemporaryDir tmp{};
+    El::Options   options{};
+    options.cache_dir = write_cache.isEmpty() ? tmp.path() : write_cache;
+
+    // both row parsers must give the same records
+    if (check) {
+        bool ok = true;
+        for (auto const &[name, end, type, quantity, exported] : {
+                 std::tuple{"start;type;kwh", false, true, false, false},
+                 std::tuple{"start;kwh", false, false, false, false},
+                 std::tuple{"start;end;kwh", true, false, false, false},
+                 std::tuple{"start;end;type;kwh;quantity", true, true, true, false},
+                 std::tuple{"start;type;kwh;export", false, true, false, true},
+                 std::tuple{"start;end;kwh;export;quantity", true, false, true, true},
+             }) {
+            auto layout          = csv_options;
+            layout.end_time      = end;
+            layout.type          = type;
+            layout.quantity_type = quantity;
+            layout.exported      = exported;
+            ok                   = check_rows(QString::fromLatin1(name), csv_lines(layout)) && ok;
+        }
+        for (auto i = optind; i < argc; ++i) {
+            auto const filename = QString::fromLocal8Bit(argv[i]);
+            QFile      file{filename};
+            if (!file.open(QFile::ReadOnly)) {
+                fmt::print(stderr, "Failed to open {}: {}\n", filename, file.errorString());
+                ok = false;
+                continue;
+            }
+            ok = check_rows(filename, split_csv(file.readAll())) && ok;
+        }
+        ok = check_replace(start) && ok;
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // generators
+    if (!write_csv.isEmpty() || !write_json.isEmpty() || !write_cache.isEmpty()) {
+        qint64 count = 0;
+        if (!write_csv.isEmpty() && !write_file(write_csv, El::Bench::consumption_csv(csv_options, count))) {
+            return EXIT_FAILURE;
+        }
+        if (!write_json.isEmpty() && !write_file(write_json, El::Bench::price_document(start_time, end_time, count))) {
+            return EXIT_FAILURE;
+        }
+        if (!write_cache.isEmpty()) {
+            El::Cache const cache{options};
+            try {
+                cache.replace_prices(QStringLiteral("ee"), {start_time, end_time}, price_blocks(start, days));
+            }
+            catch (El::Exception const &ex) {
+                fmt::print(stderr, "Failed to write the price cache: {}\n", ex.what());
+                return EXIT_FAILURE;
+            }
+        }
+        return EXIT_SUCCESS;
+    }
+
+    Runner runner{filter, min_time};
+
+    // consumption records
+    for (auto const &[name, parser_name, end, type, quantity] : {
+             std::tuple{"record/start;type;kwh", "rowparser/start;type;kwh", false, true, false},
+             std::tuple{"record/start;end;kwh", "rowparser/start;end;kwh", true, false, false},
+             std::tuple{"record/start;end;type;kwh;quantity", "rowparser/start;end;type;kwh;quantity", true, true, true},
+         }) {
+        auto options          = csv_options;
+        options.end_time      = end;
+        options.type          = type;
+        options.quantity_type = quantity;
+
+        auto const csv = csv_lines(options);
+        runner.run(name, [&csv]() -> qint64 {
+            int lineno = 0;
+            for (auto const &line : csv.lines) {
+                El::Record const rec{++lineno, line, csv.header};
+                sink += rec.kWh();
+            }
+            return csv.lines.size();
+        });
+
+        // the same rows with the parser specialized for the layout
+        runner.run(parser_name, [&csv]() -> qint64 {
+            El::RowParser const parser{csv.header};
+            int                 lineno = 0;
+            for (auto const &line : csv.lines) {
+                auto const rec = parser.parse(++lineno, line);
+                sink += rec.kWh();
+            }
+            return csv.lines.size();
+        });
+    }
+
+    {
+        auto const filename = tmp.filePath(QStringLiteral("consumption.csv"));
+        if (El::Bench::write_consumption_csv(filename, csv_options) > 0) {
+            runner.run("consumption/load", [&filename]() -> qint64 {
+                El::Consumption consumption{};
+                consumption.load(filename, QDateTime{QDate{9999, 1, 1}, QTime{0, 0}});
+                return consumption.records().size();
+            });
+        }
+    }
+
+    // prices
+    {
+        auto const contiguous = price_blocks(start, days);
+        auto const with_holes = price_blocks(start, days, 1);
+        auto const times      = lookup_times(start, days);
+
+        runner.run("prices/get_price", [&contiguous, &times]() -> qint64 {
+            for (auto const &t : times) {
+                sink += contiguous.get_price(t).value_or(0.0);
+            }
+            return times.size();
+        });
+
+        runner.run("prices/get_price with holes", [&with_holes, &times]() -> qint64 {
+            for (auto const &t : times) {
+                sink += with_holes.get_price(t).value_or(0.0);
+            }
+            return times.size();
+        });
+
+        // every append sorts and normalizes the whole array; consecutive days merge into one block
+        QVector<El::PriceBlock> daily{};
+        for (int day = 0; day < days; ++day) {
+            daily.append(price_blocks(start.addDays(day), 1).blocks().first());
+        }
+        runner.run("prices/append daily blocks", [&daily]() -> qint64 {
+            El::PriceBlocks prices{};
+            qint64          count = 0;
+            for (auto const &block : daily) {
+                prices.append(block);
+                count += block.prices.size();
+            }
+            sink += static_cast<double>(prices.size());
+            return count;
+        });
+    }
+
+    // Nord Pool JSON
+    {
+        qint64     count = 0;
+        auto const doc   = El::Bench::price_document(start_time, end_time, count);
+
+        runner.run("json/from_json", [&doc, count]() -> qint64 {
+            auto const json = El::Json::from_json(doc, QStringLiteral("ee"));
+            sink += static_cast<double>(json.prices().size());
+            return count;
+        });
+
+        runner.run("json/feed 16 KiB parts", [&doc, count]() -> qint64 {
+            El::Json json{QStringLiteral("ee")};
+            for (qsizetype pos = 0; pos < doc.size(); pos += JSON_PART_SIZE) {
+                json.feed(QByteArray::fromRawData(doc.constData() + pos, std::min(JSON_PART_SIZE, doc.size() - pos)));
+            }
+            json.finish();
+            sink += static_cast<double>(json.prices().size());
+            return count;
+        });
+    }
+
+    // price cache
+    {
+        El::Cache const cache{options};
+        auto const      prices = price_blocks(start, days);
+        auto const      count  = static_cast<qint64>(days) * prices.blocks().first().prices.size();
+
+        try {
+            runner.run("cache/replace_prices", [&cache, &prices, &start_time, &end_time, count]() -> qint64 {
+                cache.replace_prices(QStringLiteral("ee"), {start_time, end_time}, prices);
+                return count;
+            });
+
+            runner.run("cache/get_prices", [&cache, &start_time, &end_time, count]() -> qint64 {
+                auto const p = cache.get_prices(QStringLiteral("ee"), start_time, end_time);
+                sink += static_cast<double>(p.size());
+                return count;
+            });
+        }
+        catch (El::Exception const &ex) {
+            fmt::print(stderr, "Price cache benchmark failed: {}\n", ex.what());
+            return EXIT_FAILURE;
+        }
+    }
+
+    return sink != 0.0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,175 @@
+#include "generate.h"
+#include "npserver.h"
+
+#include <QCoreApplication>
+#include <QDate>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QHostAddress>
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QTemporaryDir>
+
+#include <fmt/base.h>
+
+#include <cstdlib>
+
+#include <getopt.h>
+
+namespace {
+
+constexpr char const *USAGE = R"(
+USAGE: {0} [args]
+
+Measures fetching Nord Pool prices by elekter from a local stand-in server.
+
+Generates a consumption CSV file for the given number of years and runs elekter twice
+with an empty price cache (cold) and then with the filled cache (warm).
+
+args:
+    -h,--help               Shows this help text.
+    -y,--years <n>          Number of years (default {1}).
+    -l,--latency <ms>       Delay before every response.
+    -c,--chunked            Use chunked transfer encoding.
+    -e,--error-rate <r>     Share of requests answered with 500 Internal Server Error.
+    -t,--timeout-rate <r>   Share of requests that are never answered.
+    -x,--elekter <path>     The elekter executable (default {2}).
+)";
+
+constexpr int DEFAULT_YEARS = 3;
+
+constexpr char const         *shortOpts  = "hy:l:ce:t:x:";
+constexpr struct option const longOpts[] = { // NOLINT(modernize-avoid-c-arrays)
+    {"help",         no_argument,       nullptr, 'h'},
+    {"years",        required_argument, nullptr, 'y'},
+    {"latency",      required_argument, nullptr, 'l'},
+    {"chunked",      no_argument,       nullptr, 'c'},
+    {"error-rate",   required_argument, nullptr, 'e'},
+    {"timeout-rate", required_argument, nullptr, 't'},
+    {"elekter",      required_argument, nullptr, 'x'},
+    {nullptr,        0,                 nullptr, 0  }
+};
+
+/// Runs elekter and waits for it to finish while the server keeps running
+/// @return Exit code and elapsed time in milliseconds
+auto run(QString const &program, QStringList const &args, QString const &home) -> std::pair<int, qint64>
+{
+    QProcess process{};
+    auto     env = QProcessEnvironment::systemEnvironment();
+    env.insert(QStringLiteral("HOME"), home);
+    process.setProcessEnvironment(env);
+    process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    process.setStandardOutputFile(QProcess::nullDevice());
+
+    QEventLoop loop{};
+    QObject::connect(&process, &QProcess::finished, &loop, &QEventLoop::quit);
+    QObject::connect(&process, &QProcess::errorOccurred, &loop, &QEventLoop::quit);
+
+    QElapsedTimer timer{};
+    timer.start();
+    process.start(program, args);
+    loop.exec();
+
+    auto const exit_code = process.exitStatus() == QProcess::NormalExit ? process.exitCode() : -1;
+    return {exit_code, timer.elapsed()};
+}
+
+} // namespace
+
+auto main(int argc, char *argv[]) -> int
+{
+    El::Bench::NordPoolServer::Options options{};
+    int                                years   = DEFAULT_YEARS;
+    QString                            elekter = QStringLiteral(ELEKTER_BIN);
+
+    int c   = 0;
+    int idx = 0;
+    while ((c = getopt_long(argc, argv, shortOpts, longOpts, &idx)) != -1) {
+        switch (c) {
+            case 'y': years = std::atoi(optarg); break;
+            case 'l': options.latency_ms = std::atoi(optarg); break;
+            case 'c': options.chunked = true; break;
+            case 'e': options.error_rate = std::strtod(optarg, nullptr); break;
+            case 't': options.timeout_rate = std::strtod(optarg, nullptr); break;
+            case 'x': elekter = QString::fromLocal8Bit(optarg); break;
+            case 'h': {
+                fmt::print(USAGE, argv[0], DEFAULT_YEARS, ELEKTER_BIN);
+                return EXIT_SUCCESS;
+            }
+            default: {
+                fmt::print(stderr, USAGE, argv[0], DEFAULT_YEARS, ELEKTER_BIN);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    QCoreApplication app{argc, argv};
+
+    El::Bench::NordPoolServer server{options};
+    if (!server.listen(QHostAddress::LocalHost)) {
+        fmt::print(stderr, "Failed to listen: {}\n", server.errorString().toStdString());
+        return EXIT_FAILURE;
+    }
+
+    QTemporaryDir tmp{};
+    if (!tmp.isValid()) {
+        fmt::print(stderr, "Failed to create a temporary directory\n");
+        return EXIT_FAILURE;
+    }
+
+    // consumption data for full years that cover hourly and 15 minute prices
+    auto const csv  = tmp.filePath(QStringLiteral("consumption.csv"));
+    auto const last = QDate{2025, 12, 31};
+    auto const n    = El::Bench::write_consumption_csv(csv, {last.addYears(-years).addDays(1), last});
+    if (n < 0) {
+        return EXIT_FAILURE;
+    }
+
+    auto const home = tmp.filePath(QStringLiteral("home"));
+    QDir{}.mkpath(home);
+
+    QStringList const args{
+        QStringLiteral("-p"),
+        QStringLiteral("--url=http://127.0.0.1:%1").arg(server.serverPort()),
+        csv,
+    };
+
+    fmt::print("{} years, {} records, latency {} ms{}, error rate {}, timeout rate {}\n",
+               years,
+               n,
+               options.latency_ms,
+               options.chunked ? ", chunked" : "",
+               options.error_rate,
+               options.timeout_rate);
+    fmt::print("{:6} {:>6} {:>10} {:>9} {:>10} {:>7} {:>9} {:>5} {:>10} {:>12}\n",
+               "run",
+               "exit",
+               "time ms",
+               "requests",
+               "concurrent",
+               "errors",
+               "timeouts",
+               "304",
+               "prices",
+               "bytes");
+
+    for (auto const *name : {"cold", "warm"}) {
+        server.reset_stats();
+        auto const [exit_code, elapsed] = run(elekter, args, home);
+        auto const &stats               = server.stats();
+        fmt::print("{:6} {:>6} {:>10} {:>9} {:>10} {:>7} {:>9} {:>5} {:>10} {:>12}\n",
+                   name,
+                   exit_code,
+                   elapsed,
+                   stats.requests,
+                   stats.max_concurrent,
+                   stats.errors,
+                   stats.timeouts,
+                   stats.not_modified,
+                   stats.prices,
+                   stats.bytes);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+#include "npserver.h"
+
+#include "generate.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrl>
+#include <QUrlQuery>
+
+#include <algorithm>
+
+namespace {
+
+/// Returns the value of the request header or an empty value
+auto header_value(QByteArray const &request, QByteArray const &name) -> QByteArray
+{
+    for (auto const &line : request.split('\n')) {
+        auto const colon = line.indexOf(':');
+        if (colon > 0 && line.left(colon).trimmed().compare(name, Qt::CaseInsensitive) == 0) {
+            return line.mid(colon + 1).trimmed();
+        }
+    }
+    return {};
+}
+
+} // namespace
+
+namespace El::Bench {
+
+// -----------------------------------------------------------------------------
+
+NordPoolServer::NordPoolServer(Options const &options, QObject *parent)
+    : QTcpServer(parent)
+    , _options(options)
+    , _random(options.seed)
+{
+    connect(this, &QTcpServer::newConnection, this, &NordPoolServer::accept_connections);
+}
+
+NordPoolServer::~NordPoolServer() = default;
+
+void NordPoolServer::accept_connections()
+{
+    while (hasPendingConnections()) {
+        auto *socket = nextPendingConnection();
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { read_requests(socket); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            // requests that were never answered
+            _stats.concurrent -= _pending.value(socket);
+            _pending.remove(socket);
+            _input.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+void NordPoolServer::read_requests(QTcpSocket *socket)
+{
+    auto &input = _input[socket];
+    input.append(socket->readAll());
+
+    // GET requests have no body, so every request ends with an empty line
+    qsizetype end = 0;
+    while ((end = input.indexOf("\r\n\r\n")) >= 0) {
+        auto const request = input.left(end);
+        input.remove(0, end + 4);
+
+        auto const line  = request.left(request.indexOf("\r\n"));
+        auto const parts = line.split(' ');
+
+        ++_stats.requests;
+        ++_stats.concurrent;
+        ++_pending[socket];
+        _stats.max_concurrent = std::max(_stats.max_concurrent, _stats.concurrent);
+
+        if (parts.size() != 3 || parts.at(0) != "GET") {
+            respond(socket, "400 Bad Request", {});
+            continue;
+        }
+
+        auto const target = parts.at(1);
+        if (_options.latency_ms > 0) {
+            QTimer::singleShot(_options.latency_ms, socket, [this, socket, target, request]() {
+                answer(socket, target, request);
+            });
+        }
+        else {
+            answer(socket, target, request);
+        }
+    }
+}
+
+void NordPoolServer::answer(QTcpSocket *socket, QByteArray const &target, QByteArray const &request)
+{
+    std::uniform_real_distribution<double> dist{0.0, 1.0};
+
+    // simulated failures
+    if (_options.timeout_rate > 0.0 && dist(_random) < _options.timeout_rate) {
+        ++_stats.timeouts;
+        return;
+    }
+    if (_options.error_rate > 0.0 && dist(_random) < _options.error_rate) {
+        ++_stats.errors;
+        respond(socket, "500 Internal Server Error", {});
+        return;
+    }
+
+    QUrl const url{QString::fromLatin1(target)};
+    if (url.path() != QStringLiteral("/api/nps/price")) {
+        respond(socket, "404 Not Found", {});
+        return;
+    }
+
+    QUrlQuery const query{url};
+    auto const start = QDateTime::fromString(query.queryItemValue(QStringLiteral("start"), QUrl::FullyDecoded),
+                                             Qt::ISODateWithMs);
+    auto const end   = QDateTime::fromString(query.queryItemValue(QStringLiteral("end"), QUrl::FullyDecoded),
+                                             Qt::ISODateWithMs);
+    if (!start.isValid() || !end.isValid() || end < start) {
+        respond(socket, "400 Bad Request", {});
+        return;
+    }
+
+    qint64 count = 0;
+    auto body = price_document(start, end, count);
+
+    // conditional requests
+    auto const etag = QByteArray{"\""}.append(QCryptographicHash::hash(body, QCryptographicHash::Md5).toHex()).append('"');
+    if (header_value(request, "If-None-Match") == etag) {
+        ++_stats.not_modified;
+        respond(socket, "304 Not Modified", {}, "ETag: " + etag + "\r\n");
+        return;
+    }
+    QByteArray headers{"ETag: " + etag + "\r\n"};
+
+    // compressed transfer; zlib format is what HTTP calls deflate
+    if (header_value(request, "Accept-Encoding").contains("deflate")) {
+        constexpr qsizetype LENGTH_PREFIX = 4;
+        body = qCompress(body).mid(LENGTH_PREFIX);
+        headers.append("Content-Encoding: deflate\r\n");
+    }
+
+    _stats.prices += count;
+    respond(socket, "200 OK", body, headers);
+}
+
+void NordPoolServer::respond(QTcpSocket *socket,
+                             QByteArray const &status,
+                             QByteArray const &body,
+                             QByteArray const &headers)
+{
+    QByteArray header{};
+    header.append("HTTP/1.1 ").append(status).append("\r\n");
+    header.append("Content-Type: application/json\r\n");
+    header.append("Connection: keep-alive\r\n");
+    header.append(headers);
+
+    qint64 written = 0;
+    if (_options.chunked) {
+        header.append("Transfer-Encoding: chunked\r\n\r\n");
+        written += socket->write(header);
+
+        for (qsizetype pos = 0; pos < body.size(); pos += _options.chunk_size) {
+            auto const chunk = body.mid(pos, _options.chunk_size);
+            written += socket->write(QByteArray::number(chunk.size(), 16).append("\r\n"));
+            written += socket->write(chunk);
+            written += socket->write("\r\n");
+        }
+        written += socket->write("0\r\n\r\n");
+    }
+    else {
+        header.append("Content-Length: ").append(QByteArray::number(body.size())).append("\r\n\r\n");
+        written += socket->write(header);
+        written += socket->write(body);
+    }
+
+    _stats.bytes += written;
+    --_stats.concurrent;
+    --_pending[socket];
+}
+
+} // namespace El::Bench
@@ -0,0 +1,104 @@
+#pragma once
+
+#ifndef EL_BENCH_NPSERVER_H_INCLUDED
+#  define EL_BENCH_NPSERVER_H_INCLUDED
+
+#include <QByteArray>
+#include <QHash>
+#include <QTcpServer>
+
+#include <random>
+
+QT_FORWARD_DECLARE_CLASS(QDateTime)
+QT_FORWARD_DECLARE_CLASS(QTcpSocket)
+
+namespace El::Bench {
+
+/// Local stand-in for the Elering Nord Pool price service
+///
+/// Serves synthetic prices for `GET /api/nps/price?start=...&end=...` with hourly prices before
+/// 2025-10-01 and 15 minute prices after that, like the real service. Latency, chunked transfer,
+/// server errors and requests that are never answered can be simulated. Responses are compressed
+/// when the client accepts deflate and have an ETag for conditional requests.
+class NordPoolServer : public QTcpServer {
+    Q_OBJECT
+
+public:
+
+    /// Server options
+    struct Options {
+        int     latency_ms   = 0;     ///< Delay before every response
+        bool    chunked      = false; ///< Use chunked transfer encoding
+        int     chunk_size   = 4096;  ///< Size of chunks with chunked transfer encoding
+        double  error_rate   = 0.0;   ///< Share of requests answered with 500 Internal Server Error
+        double  timeout_rate = 0.0;   ///< Share of requests that are never answered
+        quint32 seed         = 1;     ///< Seed for simulated errors
+    };
+
+    /// Server statistics
+    struct Stats {
+        int    requests       = 0; ///< Number of requests
+        int    errors         = 0; ///< Number of simulated errors
+        int    timeouts       = 0; ///< Number of simulated timeouts
+        int    not_modified   = 0; ///< Number of 304 Not Modified responses
+        int    concurrent     = 0; ///< Number of requests being answered
+        int    max_concurrent = 0; ///< Maximum number of requests answered at the same time
+        qint64 prices         = 0; ///< Number of prices sent
+        qint64 bytes          = 0; ///< Number of bytes sent
+    };
+
+    /// Ctor
+    /// @param[in] options Server options
+    /// @param[in] parent Optional parent
+    explicit NordPoolServer(Options const &options, QObject *parent = nullptr);
+
+    /// Dtor
+    ~NordPoolServer() override;
+
+    /// Returns statistics
+    auto stats() const noexcept -> auto const & { return _stats; }
+
+    /// Resets statistics
+    void reset_stats() { _stats = Stats{}; }
+
+private:
+
+    /// Server options
+    Options _options;
+
+    /// Statistics
+    Stats _stats;
+
+    /// Random numbers for simulated errors
+    std::mt19937 _random;
+
+    /// Unprocessed input per connection
+    QHash<QTcpSocket *, QByteArray> _input;
+
+    /// Number of unanswered requests per connection
+    QHash<QTcpSocket *, int> _pending;
+
+    /// Accepts new connections
+    void accept_connections();
+
+    /// Reads requests from the connection
+    /// @param[in] socket The connection
+    void read_requests(QTcpSocket *socket);
+
+    /// Answers the request
+    /// @param[in] socket The connection
+    /// @param[in] target Request target (path and query)
+    /// @param[in] request Request line and headers
+    void answer(QTcpSocket *socket, QByteArray const &target, QByteArray const &request);
+
+    /// Writes the response
+    /// @param[in] socket The connection
+    /// @param[in] status HTTP status line without the protocol
+    /// @param[in] body Response body
+    /// @param[in] headers Additional headers, each terminated with CRLF
+    void respond(QTcpSocket *socket, QByteArray const &status, QByteArray const &body, QByteArray const &headers = {});
+};
+
+} // namespace El::Bench
+
+#endif
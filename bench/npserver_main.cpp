@@ -0,0 +1,83 @@
+#include "npserver.h"
+
+#include <QCoreApplication>
+#include <QHostAddress>
+
+#include <fmt/base.h>
+
+#include <cstdlib>
+
+#include <getopt.h>
+
+namespace {
+
+constexpr char const *USAGE = R"(
+USAGE: {0} [args]
+
+Local stand-in for the Elering Nord Pool price service.
+
+args:
+    -h,--help               Shows this help text.
+    -p,--port <port>        TCP port (default {1}).
+    -l,--latency <ms>       Delay before every response.
+    -c,--chunked            Use chunked transfer encoding.
+    -e,--error-rate <r>     Share of requests answered with 500 Internal Server Error.
+    -t,--timeout-rate <r>   Share of requests that are never answered.
+
+EXAMPLE:
+
+> {0} --latency=100 --chunked &
+> elekter -p --url=http://127.0.0.1:{1} 2020-06.csv
+)";
+
+constexpr quint16 DEFAULT_PORT = 8'765;
+
+constexpr char const         *shortOpts  = "hp:l:ce:t:";
+constexpr struct option const longOpts[] = { // NOLINT(modernize-avoid-c-arrays)
+    {"help",         no_argument,       nullptr, 'h'},
+    {"port",         required_argument, nullptr, 'p'},
+    {"latency",      required_argument, nullptr, 'l'},
+    {"chunked",      no_argument,       nullptr, 'c'},
+    {"error-rate",   required_argument, nullptr, 'e'},
+    {"timeout-rate", required_argument, nullptr, 't'},
+    {nullptr,        0,                 nullptr, 0  }
+};
+
+} // namespace
+
+auto main(int argc, char *argv[]) -> int
+{
+    El::Bench::NordPoolServer::Options options{};
+    quint16                            port = DEFAULT_PORT;
+
+    int c   = 0;
+    int idx = 0;
+    while ((c = getopt_long(argc, argv, shortOpts, longOpts, &idx)) != -1) {
+        switch (c) {
+            case 'p': port = static_cast<quint16>(std::strtoul(optarg, nullptr, 10)); break;
+            case 'l': options.latency_ms = std::atoi(optarg); break;
+            case 'c': options.chunked = true; break;
+            case 'e': options.error_rate = std::strtod(optarg, nullptr); break;
+            case 't': options.timeout_rate = std::strtod(optarg, nullptr); break;
+            case 'h': {
+                fmt::print(USAGE, argv[0], port);
+                return EXIT_SUCCESS;
+            }
+            default: {
+                fmt::print(stderr, USAGE, argv[0], port);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    QCoreApplication app{argc, argv};
+
+    El::Bench::NordPoolServer server{options};
+    if (!server.listen(QHostAddress::LocalHost, port)) {
+        fmt::print(stderr, "Failed to listen on port {}: {}\n", port, server.errorString().toStdString());
+        return EXIT_FAILURE;
+    }
+    fmt::print("Listening on http://127.0.0.1:{}\n", server.serverPort());
+
+    return QCoreApplication::exec();
+}
@@ -1,64 +1,166 @@
 #include "cache.h"
 #include "common.h"
+#include "options.h"
+#include "profile.h"
 
+#include <QCoreApplication>
 #include <QDateTime>
 #include <QDir>
+#include <QLockFile>
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QSqlQuery>
+#include <QThread>
 #include <QVariant>
 
 #include <fmt/format.h>
 
 #include <array>
+#include <utility>
 
 namespace {
 
 constexpr auto const *CACHE_DIR = ".local/share/elekter";
 constexpr auto const *DB_NAME   = "nordpool.db";
 
-constexpr std::array<char const *, 4> CREATE_TABLES = {
+/// How long a connection waits for a lock held by another process
+constexpr int BUSY_TIMEOUT_MS = 30'000;
+
+/// How long a process waits for another process to finish fetching prices
+constexpr int FETCH_LOCK_TIMEOUT_MS = 120'000;
+
+/// Connection settings that allow concurrent readers and one writer
+constexpr std::array<char const *, 2> PRAGMAS = {
+    "PRAGMA journal_mode=WAL",
+    "PRAGMA synchronous=NORMAL"
+};
+
+constexpr std::array<char const *, 5> CREATE_TABLES = {
 
     R"(CREATE TABLE IF NOT EXISTS blocks (
     id INTEGER PRIMARY KEY,
     region CHAR(2) NOT NULL,
     start_s INTEGER NOT NULL,
-    end_s INTEGER NOT NULL))",
+    end_s INTEGER NOT NULL,
+    resolution_s INTEGER NOT NULL DEFAULT 900))",
 
     "CREATE INDEX IF NOT EXISTS idx_blocks ON blocks (region)",
 
     R"(CREATE TABLE IF NOT EXISTS prices (
     block_id INTEGER NOT NULL,
     time_s INTEGER NOT NULL,
-    price DOUBLE NOT NULL))",
+    price DOUBLE NOT NULL,
+    observed INTEGER NOT NULL DEFAULT 1))",
+
+    "CREATE INDEX IF NOT EXISTS idx_price_blocks ON prices (block_id)",
 
-    "CREATE INDEX IF NOT EXISTS idx_price_blocks ON prices (block_id)"
+    R"(CREATE TABLE IF NOT EXISTS validators (
+    region CHAR(2) NOT NULL,
+    start_s INTEGER NOT NULL,
+    end_s INTEGER NOT NULL,
+    etag TEXT NOT NULL,
+    last_modified TEXT NOT NULL,
+    checked_s INTEGER NOT NULL DEFAULT 0,
+    PRIMARY KEY (region, start_s, end_s)))"
 };
 
-constexpr auto const *INSERT_BLOCK = "INSERT INTO blocks (region, start_s, end_s) VALUES (?,?,?)";
-constexpr auto const *INSERT_PRICE = "INSERT INTO prices (block_id, time_s, price) VALUES (?,?,?)";
+/// Validators tables created by older versions do not have the time of the last check
+constexpr auto const *HAS_CHECKED_COLUMN = "SELECT checked_s FROM validators LIMIT 1";
+constexpr auto const *ADD_CHECKED_COLUMN = "ALTER TABLE validators ADD COLUMN checked_s INTEGER NOT NULL DEFAULT 0";
+
+/// Blocks and prices tables created by older versions do not have the native resolution and the observed flag
+constexpr auto const *HAS_RESOLUTION_COLUMN = "SELECT resolution_s FROM blocks LIMIT 1";
+constexpr auto const *ADD_RESOLUTION_COLUMN = "ALTER TABLE blocks ADD COLUMN resolution_s INTEGER NOT NULL DEFAULT 900";
+constexpr auto const *HAS_OBSERVED_COLUMN   = "SELECT observed FROM prices LIMIT 1";
+constexpr auto const *ADD_OBSERVED_COLUMN   = "ALTER TABLE prices ADD COLUMN observed INTEGER NOT NULL DEFAULT 1";
+
+/// Older versions filled every block up to the requested end time with copies of its last price
+constexpr auto const *GET_BLOCK_IDS     = "SELECT id FROM blocks";
+constexpr auto const *GET_LAST_PRICES   = "SELECT time_s, price FROM prices WHERE block_id = ? ORDER BY time_s DESC";
+constexpr auto const *MARK_NOT_OBSERVED = "UPDATE prices SET observed = 0 WHERE block_id = ? AND time_s > ?";
+
+constexpr auto const *INSERT_BLOCK = "INSERT INTO blocks (region, start_s, end_s, resolution_s) VALUES (?,?,?,?)";
+constexpr auto const *INSERT_PRICE = "INSERT INTO prices (block_id, time_s, price, observed) VALUES (?,?,?,?)";
 constexpr auto const *GET_PRICE_BLOCKS =
 
-    R"(SELECT id, start_s, end_s FROM blocks
-    WHERE region = :region AND
-          (:start >= start_s AND :start <= end_s) OR
-          (:end >= start_s AND :end <= end_s)
+    R"(SELECT id, start_s, end_s, resolution_s FROM blocks
+    WHERE region = :region AND start_s <= :end AND end_s >= :start
     )";
 
 constexpr auto const *GET_PRICES =
 
-    R"(SELECT time_s, price FROM prices
-        WHERE block_id=:block_id AND time_s >= :start AND time_s <= :end
+    R"(SELECT time_s, price, observed FROM prices
+        WHERE block_id=:block_id AND time_s >= :from AND time_s <= :end
+    )";
+
+constexpr auto const *DELETE_PRICES =
+
+    R"(DELETE FROM prices
+        WHERE time_s >= :start AND time_s <= :end AND
+              block_id IN (SELECT id FROM blocks WHERE region = :region)
+    )";
+
+constexpr auto const *DELETE_BLOCKS =
+
+    "DELETE FROM blocks WHERE region = :region AND start_s >= :start AND end_s <= :end";
+
+/// Blocks that extend over both ends of a replaced period are split in two
+constexpr auto const *GET_SPANNING_BLOCKS =
+
+    R"(SELECT id, end_s, resolution_s FROM blocks
+        WHERE region = :region AND start_s < :start AND end_s > :end
+    )";
+
+constexpr auto const *MOVE_PRICES = "UPDATE prices SET block_id = ? WHERE block_id = ? AND time_s > ?";
+
+/// Blocks that extend over one end of a replaced period keep only their part outside the period
+constexpr auto const *CLIP_BLOCK_ENDS =
+
+    R"(UPDATE blocks SET end_s = :start - 900
+        WHERE region = :region AND start_s < :start AND end_s >= :start
+    )";
+
+constexpr auto const *CLIP_BLOCK_STARTS =
+
+    R"(UPDATE blocks SET start_s = :end + 900
+        WHERE region = :region AND start_s <= :end AND end_s > :end
+    )";
+
+constexpr auto const *GET_VALIDATOR =
+
+    R"(SELECT etag, last_modified, checked_s FROM validators
+        WHERE region = :region AND start_s = :start AND end_s = :end)";
+
+constexpr auto const *STORE_VALIDATOR =
+
+    R"(INSERT OR REPLACE INTO validators (region, start_s, end_s, etag, last_modified, checked_s)
+        VALUES (:region, :start, :end, :etag, :last_modified, :checked)
     )";
 
+/// Returns the name of the current thread's connection to the database in the directory
+///
+/// SQLite connections must only be used by the thread that opened them, so every thread that
+/// accesses the cache has its own connection.
+auto connection_name(QString const &dir) -> QString
+{
+    return QStringLiteral("%1@%2").arg(dir).arg(reinterpret_cast<quintptr>(QThread::currentThread()), 0, 16);
+}
+
 class Transaction {
 public:
     Transaction(QSqlDatabase &db)
-        : _db(&db)
     {
-        _db->transaction();
+        // take the write lock up front so that the busy timeout applies instead of failing
+        // when a deferred transaction is upgraded while another process is writing
+        QSqlQuery q{db};
+        if (q.exec(QStringLiteral("BEGIN IMMEDIATE"))) {
+            _db = &db;
+        }
     }
 
+    /// Returns true if the transaction was started
+    auto active() const noexcept { return _db != nullptr; }
+
     ~Transaction()
     {
         if (_db != nullptr) {
@@ -68,6 +170,9 @@ public:
 
     auto commit() -> bool
     {
+        if (_db == nullptr) {
+            return false;
+        }
         auto const rval = _db->commit();
         if (rval) {
             _db = nullptr;
@@ -79,47 +184,130 @@ private:
     QSqlDatabase *_db = nullptr;
 };
 
+/// Marks the prices that older versions repeated at the end of every block as not observed
+///
+/// The repeated prices are the trailing run of equal prices in a block; the first price of the run
+/// is the last real price. A real price that happens to be equal to the previous one is marked too
+/// and is requested again.
+/// @param[in] db Database with the observed column just added
+/// @return true if succeeded
+auto mark_repeated_prices(QSqlDatabase &db) -> bool
+{
+    QSqlQuery q_blocks{db};
+    QSqlQuery q_prices{db};
+    QSqlQuery q_mark{db};
+    for (auto [q, sql] : {std::pair{&q_prices, GET_LAST_PRICES}, std::pair{&q_mark, MARK_NOT_OBSERVED}}) {
+        if (!q->prepare(sql)) {
+            fmt::print(stderr, "Päringu {} ettevalmistamine ebaõnnestus: {}\n", q->lastQuery(), q->lastError().text());
+            return false;
+        }
+    }
+    if (!q_blocks.exec(GET_BLOCK_IDS)) {
+        fmt::print(stderr, "Päringu {} käivitamine ebaõnnestus: {}\n", q_blocks.lastQuery(), q_blocks.lastError().text());
+        return false;
+    }
+
+    while (q_blocks.next()) {
+        auto const id = q_blocks.value(0).toLongLong();
+        q_prices.bindValue(0, QVariant{id});
+        if (!q_prices.exec()) {
+            fmt::print(stderr, "Päringu {} käivitamine ebaõnnestus: {}\n", q_prices.lastQuery(), q_prices.lastError().text());
+            return false;
+        }
+        if (!q_prices.next()) {
+            continue;
+        }
+
+        // walk back from the last price to the first price of the run
+        auto const last  = q_prices.value(1).toDouble();
+        auto const end_s = q_prices.value(0).toLongLong();
+        auto       first = end_s;
+        while (q_prices.next() && q_prices.value(1).toDouble() == last) {
+            first = q_prices.value(0).toLongLong();
+        }
+        q_prices.finish();
+
+        if (first == end_s) {
+            continue;
+        }
+        q_mark.bindValue(0, QVariant{id});
+        q_mark.bindValue(1, QVariant{first});
+        if (!q_mark.exec()) {
+            fmt::print(stderr, "Päringu {} käivitamine ebaõnnestus: {}\n", q_mark.lastQuery(), q_mark.lastError().text());
+            return false;
+        }
+    }
+
+    return true;
+}
+
 } // namespace
 
 namespace El {
 
 // -----------------------------------------------------------------------------
 
-Cache::Cache(App const &app)
-    : _app(app)
+Cache::Cache(Options const &options)
+    : _dir(options.cache_dir.isEmpty() ? QDir::home().filePath(QString::fromLatin1(CACHE_DIR)) : options.cache_dir)
 {
     // create the cache directory
-    auto const home = QDir::home();
-    if (!home.mkpath(CACHE_DIR)) {
-        fmt::print(stderr, "Vahemälu kausta {} loomine ebaõnnestus\n", CACHE_DIR);
+    if (!QDir{}.mkpath(_dir)) {
+        fmt::print(stderr, "Vahemälu kausta {} loomine ebaõnnestus\n", _dir);
         return;
     }
 
     // initialize the database
-    if (!init_database()) {
+    if (!init_database(_dir)) {
         return;
     }
 
     _valid = true;
 }
 
-auto Cache::init_database() -> bool
+auto Cache::init_database(QString const &dir) -> bool
 {
     using namespace Qt::Literals::StringLiterals;
 
-    auto db = QSqlDatabase::addDatabase(u"QSQLITE"_s);
+    // the connection is shared by all the cache instances of the thread using the same directory
+    auto const name = connection_name(dir);
+    if (QSqlDatabase::contains(name)) {
+        return QSqlDatabase::database(name).isOpen();
+    }
+
+    auto db = QSqlDatabase::addDatabase(u"QSQLITE"_s, name);
+
+    // connections of worker threads are closed by the thread when it finishes
+    auto *thread = QThread::currentThread();
+    auto *app    = QCoreApplication::instance();
+    if (app == nullptr || thread != app->thread()) {
+        QObject::connect(
+            thread,
+            &QThread::finished,
+            thread,
+            [name]() { QSqlDatabase::removeDatabase(name); },
+            Qt::DirectConnection);
+    }
 
     // open the database
-    auto const db_name = QString{u"%1/%2/%3"_s}.arg(QDir::homePath(), CACHE_DIR, DB_NAME);
+    auto const db_name = QDir{dir}.filePath(QString::fromLatin1(DB_NAME));
     db.setDatabaseName(db_name);
+    db.setConnectOptions(u"QSQLITE_BUSY_TIMEOUT=%1"_s.arg(BUSY_TIMEOUT_MS));
     if (!db.open()) {
         fmt::print(stderr, "Vahemälu andmebaasi faili {} avamine ebaõnnestus: {}\n", db_name, db.lastError().text());
         return false;
     }
 
-    // create tables
     QSqlQuery q{db};
 
+    // configure the connection
+    for (auto const *sql : PRAGMAS) {
+        if (!q.exec(sql)) {
+            fmt::print(stderr, "Päringu {} käivitamine ebaõnnestus: {}\n", q.lastQuery(), q.lastError().text());
+            return false;
+        }
+    }
+
+    // create tables
     for (auto const *sql : CREATE_TABLES) {
         if (!q.prepare(sql)) {
             fmt::print(stderr, "Päringu {} ettevalmistamine ebaõnnestus: {}\n", q.lastQuery(), q.lastError().text());
@@ -131,6 +319,37 @@ auto Cache::init_database() -> bool
         }
     }
 
+    // upgrade tables
+    if (!q.exec(HAS_CHECKED_COLUMN) && !q.exec(ADD_CHECKED_COLUMN)) {
+        fmt::print(stderr, "Päringu {} käivitamine ebaõnnestus: {}\n", q.lastQuery(), q.lastError().text());
+        return false;
+    }
+    if (!q.exec(HAS_RESOLUTION_COLUMN) && !q.exec(ADD_RESOLUTION_COLUMN)) {
+        fmt::print(stderr, "Päringu {} käivitamine ebaõnnestus: {}\n", q.lastQuery(), q.lastError().text());
+        return false;
+    }
+    if (!q.exec(HAS_OBSERVED_COLUMN)) {
+        // the column is added and repeated prices are marked once, by one process
+        Transaction tr{db};
+        if (!tr.active()) {
+            fmt::print(stderr, "Andmebaasi tehingu alustamine ebaõnnestus: {}\n", db.lastError().text());
+            return false;
+        }
+        if (!q.exec(HAS_OBSERVED_COLUMN)) {
+            if (!q.exec(ADD_OBSERVED_COLUMN)) {
+                fmt::print(stderr, "Päringu {} käivitamine ebaõnnestus: {}\n", q.lastQuery(), q.lastError().text());
+                return false;
+            }
+            if (!mark_repeated_prices(db)) {
+                return false;
+            }
+        }
+        if (!tr.commit()) {
+            fmt::print(stderr, "Andmebaasi salvestamine ebaõnnestus: {}\n", db.lastError().text());
+            return false;
+        }
+    }
+
     return true;
 }
 
@@ -138,19 +357,14 @@ auto Cache::get_prices(QString const &region, QDateTime const &start, QDateTime
 {
     using namespace Qt::Literals::StringLiterals;
 
-    if (!_valid) {
-        throw Exception{"vahemälu ei ole avatud"};
-    }
+    Profile::Scope const profile{"Cache::get_prices"};
+
+    auto db = database();
 
     if (end < start) {
         return {};
     }
 
-    auto db = QSqlDatabase::database();
-    if (!db.isOpen()) {
-        throw Exception{"andmebaas ei ole avatud"};
-    }
-
     // prepare SQL statements
     QSqlQuery q_blocks{db};
     if (!q_blocks.prepare(GET_PRICE_BLOCKS)) {
@@ -166,7 +380,6 @@ auto Cache::get_prices(QString const &region, QDateTime const &start, QDateTime
         throw Exception{"päringu {} ettevalmistamine ebaõnnestus: {}", q_prices.lastQuery(), q_prices.lastError().text()};
     }
 
-    q_prices.bindValue(u":start"_s, QVariant{start.toSecsSinceEpoch()});
     q_prices.bindValue(u":end"_s, QVariant{end.toSecsSinceEpoch()});
 
     if (!q_blocks.exec()) {
@@ -177,7 +390,10 @@ auto Cache::get_prices(QString const &region, QDateTime const &start, QDateTime
     PriceBlocks blocks{};
     while (q_blocks.next()) {
         // load all the prices from this block that are within the request time frame
+        // a price is loaded also if it starts before `start` but is still valid at `start`
+        auto const resolution_s = q_blocks.value(3).toInt();
         q_prices.bindValue(u":block_id"_s, q_blocks.value(0).toLongLong());
+        q_prices.bindValue(u":from"_s, QVariant{start.toSecsSinceEpoch() - resolution_s + INTERVAL_S});
 
         if (!q_prices.exec()) {
             throw Exception{"päringu {} käivitamine ebaõnnestus: {}", q_prices.lastQuery(), q_prices.lastError().text()};
@@ -185,8 +401,11 @@ auto Cache::get_prices(QString const &region, QDateTime const &start, QDateTime
 
         // now we have price records
         PriceBlock block{};
+        block.resolution_s = resolution_s;
         while (q_prices.next()) {
-            block.append({QDateTime::fromSecsSinceEpoch(q_prices.value(0).toLongLong()), q_prices.value(1).toDouble()});
+            block.append({QDateTime::fromSecsSinceEpoch(q_prices.value(0).toLongLong()),
+                          q_prices.value(1).toDouble(),
+                          q_prices.value(2).toBool()});
         }
 
         if (!block.empty()) {
@@ -199,16 +418,124 @@ auto Cache::get_prices(QString const &region, QDateTime const &start, QDateTime
 }
 
 void Cache::store_prices(QString const &region, PriceBlocks const &prices) const
+{
+    Profile::Scope const profile{"Cache::store_prices"};
+
+    auto db = database();
+
+    Transaction tr{db};
+    if (!tr.active()) {
+        throw Exception{"andmebaasi tehingu alustamine ebaõnnestus: {}", db.lastError().text()};
+    }
+
+    insert_prices(db, region, prices);
+
+    if (!tr.commit()) {
+        throw Exception{"andmebaasi salvestamine ebaõnnestus: {}", db.lastError().text()};
+    }
+}
+
+void Cache::replace_prices(QString const &region, TimePair const &period, PriceBlocks const &prices) const
+{
+    using namespace Qt::Literals::StringLiterals;
+
+    Profile::Scope const profile{"Cache::replace_prices"};
+
+    auto db = database();
+
+    Transaction tr{db};
+    if (!tr.active()) {
+        throw Exception{"andmebaasi tehingu alustamine ebaõnnestus: {}", db.lastError().text()};
+    }
+
+    // remove old prices; blocks that are completely replaced are removed and blocks that overlap
+    // the period are cut, so that their remaining prices are not valid within the period
+    split_blocks(db, region, period);
+    for (auto const *sql : {DELETE_PRICES, CLIP_BLOCK_ENDS, CLIP_BLOCK_STARTS, DELETE_BLOCKS}) {
+        QSqlQuery q{db};
+        if (!q.prepare(sql)) {
+            throw Exception{"päringu {} ettevalmistamine ebaõnnestus: {}", q.lastQuery(), q.lastError().text()};
+        }
+        q.bindValue(u":region"_s, region);
+        q.bindValue(u":start"_s, QVariant{period.start.toSecsSinceEpoch()});
+        q.bindValue(u":end"_s, QVariant{period.end.toSecsSinceEpoch()});
+        if (!q.exec()) {
+            throw Exception{"päringu {} käivitamine ebaõnnestus: {}", q.lastQuery(), q.lastError().text()};
+        }
+    }
+
+    insert_prices(db, region, prices);
+
+    if (!tr.commit()) {
+        throw Exception{"andmebaasi salvestamine ebaõnnestus: {}", db.lastError().text()};
+    }
+}
+
+auto Cache::get_validator(QString const &region, TimePair const &period) const -> Validator
+{
+    using namespace Qt::Literals::StringLiterals;
+
+    auto db = database();
+
+    QSqlQuery q{db};
+    if (!q.prepare(GET_VALIDATOR)) {
+        throw Exception{"päringu {} ettevalmistamine ebaõnnestus: {}", q.lastQuery(), q.lastError().text()};
+    }
+    q.bindValue(u":region"_s, region);
+    q.bindValue(u":start"_s, QVariant{period.start.toSecsSinceEpoch()});
+    q.bindValue(u":end"_s, QVariant{period.end.toSecsSinceEpoch()});
+    if (!q.exec()) {
+        throw Exception{"päringu {} käivitamine ebaõnnestus: {}", q.lastQuery(), q.lastError().text()};
+    }
+
+    if (!q.next()) {
+        return {};
+    }
+    return {q.value(0).toByteArray(), q.value(1).toByteArray(), q.value(2).toLongLong()};
+}
+
+void Cache::store_validator(QString const &region, TimePair const &period, Validator const &validator) const
+{
+    using namespace Qt::Literals::StringLiterals;
+
+    auto db = database();
+
+    QSqlQuery q{db};
+    if (!q.prepare(STORE_VALIDATOR)) {
+        throw Exception{"päringu {} ettevalmistamine ebaõnnestus: {}", q.lastQuery(), q.lastError().text()};
+    }
+    q.bindValue(u":region"_s, region);
+    q.bindValue(u":start"_s, QVariant{period.start.toSecsSinceEpoch()});
+    q.bindValue(u":end"_s, QVariant{period.end.toSecsSinceEpoch()});
+    q.bindValue(u":etag"_s, QVariant{validator.etag});
+    q.bindValue(u":last_modified"_s, QVariant{validator.last_modified});
+    q.bindValue(u":checked"_s, QVariant{validator.checked_s});
+    if (!q.exec()) {
+        throw Exception{"päringu {} käivitamine ebaõnnestus: {}", q.lastQuery(), q.lastError().text()};
+    }
+}
+
+auto Cache::database() const -> QSqlDatabase
 {
     if (!_valid) {
         throw Exception{"vahemälu ei ole avatud"};
     }
 
-    auto db = QSqlDatabase::database();
+    // worker threads open their own connections when they first access the cache
+    if (!init_database(_dir)) {
+        throw Exception{"andmebaasi avamine ebaõnnestus"};
+    }
+
+    auto db = QSqlDatabase::database(connection_name(_dir));
     if (!db.isOpen()) {
         throw Exception{"andmebaas ei ole avatud"};
     }
 
+    return db;
+}
+
+void Cache::insert_prices(QSqlDatabase &db, QString const &region, PriceBlocks const &prices)
+{
     // prepare SQL statements
     QSqlQuery q_block{db};
     if (!q_block.prepare(INSERT_BLOCK)) {
@@ -221,12 +548,11 @@ void Cache::store_prices(QString const &region, PriceBlocks const &prices) const
         throw Exception{"päringu {} ettevalmistamine ebaõnnestus: {}", q_price.lastQuery(), q_price.lastError().text()};
     }
 
-    Transaction tr{db};
-
     // store all the blocks and prices
     for (auto const &b : prices.blocks()) {
         q_block.bindValue(1, QVariant{b.start_time.toSecsSinceEpoch()});
         q_block.bindValue(2, QVariant{b.end_time.toSecsSinceEpoch()});
+        q_block.bindValue(3, QVariant{b.resolution_s});
 
         if (!q_block.exec()) {
             throw Exception{"päringu {} käivitamine ebaõnnestus: {}", q_block.lastQuery(), q_block.lastError().text()};
@@ -237,16 +563,77 @@ void Cache::store_prices(QString const &region, PriceBlocks const &prices) const
         for (auto const &price : b.prices) {
             q_price.bindValue(1, QVariant{price.time.toSecsSinceEpoch()});
             q_price.bindValue(2, QVariant{price.price});
+            q_price.bindValue(3, QVariant{price.observed ? 1 : 0});
 
             if (!q_price.exec()) {
                 throw Exception{"päringu {} käivitamine ebaõnnestus: {}", q_price.lastQuery(), q_price.lastError().text()};
             }
         }
     }
+}
 
-    if (!tr.commit()) {
-        throw Exception{"andmebaasi salvestamine ebaõnnestus: {}", db.lastError().text()};
+void Cache::split_blocks(QSqlDatabase &db, QString const &region, TimePair const &period)
+{
+    using namespace Qt::Literals::StringLiterals;
+
+    QSqlQuery q_blocks{db};
+    if (!q_blocks.prepare(GET_SPANNING_BLOCKS)) {
+        throw Exception{"päringu {} ettevalmistamine ebaõnnestus: {}", q_blocks.lastQuery(), q_blocks.lastError().text()};
+    }
+    q_blocks.bindValue(u":region"_s, region);
+    q_blocks.bindValue(u":start"_s, QVariant{period.start.toSecsSinceEpoch()});
+    q_blocks.bindValue(u":end"_s, QVariant{period.end.toSecsSinceEpoch()});
+    if (!q_blocks.exec()) {
+        throw Exception{"päringu {} käivitamine ebaõnnestus: {}", q_blocks.lastQuery(), q_blocks.lastError().text()};
     }
+
+    QSqlQuery q_block{db};
+    if (!q_block.prepare(INSERT_BLOCK)) {
+        throw Exception{"päringu {} ettevalmistamine ebaõnnestus: {}", q_block.lastQuery(), q_block.lastError().text()};
+    }
+    QSqlQuery q_move{db};
+    if (!q_move.prepare(MOVE_PRICES)) {
+        throw Exception{"päringu {} ettevalmistamine ebaõnnestus: {}", q_move.lastQuery(), q_move.lastError().text()};
+    }
+
+    // the part after the period becomes a new block with the prices after the period
+    while (q_blocks.next()) {
+        q_block.bindValue(0, region);
+        q_block.bindValue(1, QVariant{period.end.toSecsSinceEpoch() + INTERVAL_S});
+        q_block.bindValue(2, q_blocks.value(1));
+        q_block.bindValue(3, q_blocks.value(2));
+        if (!q_block.exec()) {
+            throw Exception{"päringu {} käivitamine ebaõnnestus: {}", q_block.lastQuery(), q_block.lastError().text()};
+        }
+
+        q_move.bindValue(0, q_block.lastInsertId());
+        q_move.bindValue(1, q_blocks.value(0));
+        q_move.bindValue(2, QVariant{period.end.toSecsSinceEpoch()});
+        if (!q_move.exec()) {
+            throw Exception{"päringu {} käivitamine ebaõnnestus: {}", q_move.lastQuery(), q_move.lastError().text()};
+        }
+    }
+}
+
+auto Cache::lock_fetch(QString const &region) const -> std::unique_ptr<QLockFile>
+{
+    using namespace Qt::Literals::StringLiterals;
+
+    if (!_valid) {
+        return {};
+    }
+
+    auto const lock_name = QDir{_dir}.filePath(u"nordpool-%1.lock"_s.arg(region));
+    auto lock = std::make_unique<QLockFile>(lock_name);
+
+    // a lock left behind by a crashed process is detected by its PID; a live owner keeps the lock
+    // however long the fetch takes
+    lock->setStaleLockTime(0);
+    if (!lock->tryLock(FETCH_LOCK_TIMEOUT_MS)) {
+        throw Exception{"vahemälu lukustamine ebaõnnestus: {}", lock_name};
+    }
+
+    return lock;
 }
 
 } // namespace El
@@ -8,18 +8,28 @@
 #include <QObject>
 #include <QString>
 
+#include <memory>
+
 QT_FORWARD_DECLARE_CLASS(QDateTime)
+QT_FORWARD_DECLARE_CLASS(QLockFile)
+QT_FORWARD_DECLARE_CLASS(QSqlDatabase)
 
 namespace El {
 
-class App;
+struct Options;
 
 /// Nord Pool price history cache
+///
+/// The cache is an SQLite database in the cache directory of the options (by default
+/// `~/.local/share/elekter`). All the instances using the same directory share one connection per
+/// thread; a thread that first accesses the cache opens its own connection, so that the cache can
+/// be used from worker threads as well as from the main thread.
 class Cache {
 public:
 
     /// Ctor
-    Cache(App const &app);
+    /// @param[in] options Engine options
+    Cache(Options const &options);
 
     /// Dtor
     ~Cache() = default;
@@ -41,16 +51,66 @@ public:
     /// @throws El::Exception on errors
     void store_prices(QString const &region, PriceBlocks const &prices) const;
 
+    /// Replaces Nord Pool prices for the time period
+    /// @param[in] region Price region
+    /// @param[in] period Time period
+    /// @param[in] prices New prices for the time period
+    /// @throws El::Exception on errors
+    void replace_prices(QString const &region, TimePair const &period, PriceBlocks const &prices) const;
+
+    /// Returns HTTP cache validators of the last price response for the time period
+    /// @param[in] region Price region
+    /// @param[in] period Requested time period
+    /// @return Validators (empty if not found)
+    /// @throws El::Exception on errors
+    auto get_validator(QString const &region, TimePair const &period) const -> Validator;
+
+    /// Stores HTTP cache validators of the price response for the time period
+    /// @param[in] region Price region
+    /// @param[in] period Requested time period
+    /// @param[in] validator Validators
+    /// @throws El::Exception on errors
+    void store_validator(QString const &region, TimePair const &period, Validator const &validator) const;
+
+    /// Acquires the exclusive lock for fetching missing prices of the region.
+    ///
+    /// The lock is shared between all the processes using the same cache. Blocks while
+    /// another process holds the lock, so that missing prices are fetched only once. The lock of
+    /// a running process is never taken over; a lock left behind by a crashed process is.
+    /// @param[in] region Price region
+    /// @return The lock (released when destroyed) or nullptr if there is no cache
+    /// @throws Exception if another process holds the lock for longer than the timeout
+    auto lock_fetch(QString const &region) const -> std::unique_ptr<QLockFile>;
+
 private:
 
-    /// Application instance
-    App const &_app;
+    /// Cache directory
+    QString _dir;
 
     /// Flag indicating that cache is valid and can be used
     bool _valid = false;
 
-    /// Initializes the cache database
-    static auto init_database() -> bool;
+    /// Initializes the current thread's connection to the cache database
+    /// @param[in] dir Cache directory
+    static auto init_database(QString const &dir) -> bool;
+
+    /// Returns the open database
+    /// @throws El::Exception if the cache is not valid
+    auto database() const -> QSqlDatabase;
+
+    /// Inserts prices without starting a transaction
+    /// @param[in] db Database
+    /// @param[in] region Price region
+    /// @param[in] prices Price blocks
+    /// @throws El::Exception on errors
+    static void insert_prices(QSqlDatabase &db, QString const &region, PriceBlocks const &prices);
+
+    /// Splits blocks that start before and end after the period in two
+    /// @param[in] db Database
+    /// @param[in] region Price region
+    /// @param[in] period Time period that is being replaced
+    /// @throws El::Exception on errors
+    static void split_blocks(QSqlDatabase &db, QString const &region, TimePair const &period);
 
 };
 
@@ -1,41 +1,47 @@
 #include "common.h"
 
-#include <QJsonObject>
-#include <QVariant>
-
 #include <fmt/format.h>
 
 namespace El {
 
 // -----------------------------------------------------------------------------
 
-auto Price::from_json(QJsonObject const &json) -> Price
+void PriceBuilder::add(Price const &price)
 {
-    using namespace Qt::Literals::StringLiterals;
-
-    if (!json.contains(u"timestamp"_s)) {
-        throw Exception{"Missing 'timestamp' element"};
+    // Nord Pool is returning 1 hour intervals for prices before 2025-10-01
+    constexpr int SEC_IN_HOUR = 3'600;
+
+    if (!_block.empty()) {
+        auto const step = _last_time.secsTo(price.time);
+        if (_block.prices.size() == 1 && step == SEC_IN_HOUR) {
+            // the second price gives the resolution of the block
+            _block.resolution_s = SEC_IN_HOUR;
+        }
+        else if (step != _block.resolution_s) {
+            // a hole or a change of the resolution starts a new block
+            flush();
+        }
     }
-    auto const t = json.value(u"timestamp"_s);
+    _last_time = price.time;
 
-    bool ok = false;
-    auto const timestamp = t.toVariant().toLongLong(&ok);
-    if (!ok) {
-        throw Exception{fmt::format("Invalid 'timestamp' element value '{}'", t.toString())};
-    }
+    _block.append(price);
+}
 
-    if (!json.contains(u"price"_s)) {
-        throw Exception{"Missing 'price' element"};
-    }
-    auto const p = json.value(u"price"_s);
+auto PriceBuilder::finish() -> PriceBlocks
+{
+    flush();
 
-    ok = false;
-    auto const price = p.toVariant().toDouble(&ok);
-    if (!ok) {
-        throw Exception{fmt::format("Invalid 'price' element value '{}'", p.toString())};
-    }
+    _last_time = QDateTime{};
+    return std::move(_prices);
+}
 
-    return Price{QDateTime::fromSecsSinceEpoch(timestamp), price};
+void PriceBuilder::flush()
+{
+    // append the block if it has prices
+    if (!_block.empty()) {
+        _prices.append(std::move(_block));
+    }
+    _block = PriceBlock{};
 }
 
 } // namespace El
@@ -3,8 +3,6 @@
 #ifndef EL_COMMON_H_INCLUDED
 #  define EL_COMMON_H_INCLUDED
 
-#include "args.h"
-
 #include <QByteArray>
 #include <QDateTime>
 #include <QString>
@@ -17,8 +15,7 @@
 #include <stdexcept>
 #include <string>
 #include <string_view>
-
-QT_FORWARD_DECLARE_CLASS(QJsonObject)
+#include <utility>
 
 template <>
 struct fmt::formatter<QByteArray> : public fmt::formatter<std::string_view> {
@@ -71,6 +68,9 @@ namespace El {
 /// Number of kWh in a MWh
 constexpr double KWH_IN_MWH = 1000.0;
 
+/// Length of Nord Pool price intervals and of consumption records without an end time in seconds
+constexpr int INTERVAL_S = 15 * 60;
+
 /// Exception
 class Exception : public std::runtime_error {
 public:
@@ -106,19 +106,14 @@ static inline auto to_datetime(int time_h) -> QDateTime
     return QDateTime::fromSecsSinceEpoch(static_cast<qint64>(time_h) * SECS_IN_MIN * MINS_IN_HOUR);
 }
 
-/// Nord Pool hourly price record
+/// Nord Pool price record
 struct Price {
 
-    /// Constructs the Price record from a JSON object
-    /// @param[in] json JSON object with `timestamp` and `price` attributes
-    /// @return Price record
-    /// @throws Exception on errors
-    static auto from_json(QJsonObject const &json) -> Price;
-
     /// Ctor
-    Price(QDateTime time_, double price_)
+    Price(QDateTime time_, double price_, bool observed_ = true)
         : time(std::move(time_))
         , price(price_)
+        , observed(observed_)
     {}
 
     /// Dtor
@@ -129,9 +124,24 @@ struct Price {
 
     /// Price (EUR/MWh) without taxes
     double price = 0.0;
+
+    /// True if the price was received from Nord Pool, false if it only repeats the previous
+    /// price; repeated prices are only found in caches of older versions, where they are marked
+    /// when the cache is upgraded, and are never used
+    bool observed = true;
+};
+
+/// Start and end time pair
+struct TimePair {
+    QDateTime start; ///< Start time
+    QDateTime end;   ///< End time
 };
 
 /// Nord Pool price block with start and end time
+///
+/// Prices are stored in their native resolution (one hour before 2025-10-01, 15 minutes after
+/// that) and every price is valid until the next one. The end time is the start of the last
+/// price interval (`INTERVAL_S`) that the block covers.
 struct PriceBlock {
 
     /// Default ctr
@@ -148,14 +158,16 @@ struct PriceBlock {
         start_time.swap(rhs.start_time);
         end_time.swap(rhs.end_time);
         prices.swap(rhs.prices);
+        resolution_s = std::exchange(rhs.resolution_s, INTERVAL_S);
     }
 
     auto operator=(PriceBlock const &rhs) -> PriceBlock &
     {
         if (this != &rhs) {
-            start_time = rhs.start_time;
-            end_time   = rhs.end_time;
-            prices     = rhs.prices;
+            start_time   = rhs.start_time;
+            end_time     = rhs.end_time;
+            prices       = rhs.prices;
+            resolution_s = rhs.resolution_s;
         }
         return *this;
     }
@@ -169,6 +181,7 @@ struct PriceBlock {
             end_time.swap(rhs.end_time);
             prices.clear();
             prices.swap(rhs.prices);
+            resolution_s = std::exchange(rhs.resolution_s, INTERVAL_S);
         }
         return *this;
     }
@@ -179,9 +192,11 @@ struct PriceBlock {
     /// Appends a price to the block
     void append(Price const &price)
     {
+        // the last interval covered by the price
+        auto const last = price.time.addSecs(resolution_s - INTERVAL_S);
         if (prices.isEmpty()) {
             start_time = price.time;
-            end_time   = price.time;
+            end_time   = last;
         }
         prices.append(price);
 
@@ -190,11 +205,11 @@ struct PriceBlock {
             start_time = price.time;
             sort       = true;
         }
-        if (end_time > price.time) {
+        if (end_time > last) {
             sort = true;
         }
         else {
-            end_time = price.time;
+            end_time = last;
         }
 
         if (sort) {
@@ -210,13 +225,13 @@ struct PriceBlock {
         for (auto it = prices.cbegin(); it != prices.cend(); ++it) {
             // check for exact match
             if (it->time == time) {
-                return it->price;
+                return it->observed ? std::optional{it->price} : std::nullopt;
             }
 
             // check if we have passed the time
             if (it->time > time) {
                 // it is the previous price (if any)
-                if (it != prices.cbegin()) {
+                if (it != prices.cbegin() && (it - 1)->observed) {
                     return (it - 1)->price;
                 }
 
@@ -224,23 +239,83 @@ struct PriceBlock {
                 return {};
             }
         }
+
+        // the last price is valid up to the end of the block
+        if (!prices.isEmpty() && time <= end_time && prices.back().observed) {
+            return prices.back().price;
+        }
         return {};
     }
 
+    /// Returns periods of the block that are covered by observed prices
+    /// @return Start time and the start of the last interval of every period
+    auto observed_periods() const -> QVector<TimePair>
+    {
+        QVector<TimePair> result{};
+        for (auto i = 0; i < prices.size(); ++i) {
+            auto const &price = prices.at(i);
+            if (!price.observed) {
+                continue;
+            }
+
+            // a price is valid until the next price or the end of the block
+            auto const last = i + 1 < prices.size() ? prices.at(i + 1).time.addSecs(-INTERVAL_S) : end_time;
+            if (!result.isEmpty() && result.back().end.addSecs(INTERVAL_S) >= price.time) {
+                result.back().end = last;
+            }
+            else {
+                result.append({price.time, last});
+            }
+        }
+        return result;
+    }
+
+    /// Returns the part of the block from `start` to `end`
+    ///
+    /// A price that is valid at `start` but starts earlier is moved to `start`.
+    /// @param[in] start Start of the first interval
+    /// @param[in] end Start of the last interval
+    /// @return Price block with the same resolution; empty if there are no prices in the period
+    auto part(QDateTime const &start, QDateTime const &end) const -> PriceBlock
+    {
+        PriceBlock result{};
+        result.resolution_s = resolution_s;
+        for (auto i = 0; i < prices.size(); ++i) {
+            auto       price = prices.at(i);
+            auto const next  = i + 1 < prices.size() ? prices.at(i + 1).time : end_time.addSecs(INTERVAL_S);
+            if (next <= start || price.time > end) {
+                continue;
+            }
+            price.time = std::max(price.time, start);
+            result.append(price);
+        }
+        if (!result.empty()) {
+            result.end_time = std::min({result.end_time, end, end_time});
+        }
+        return result;
+    }
+
     /// Start time of the block
     QDateTime start_time;
 
     /// End time of the block
     QDateTime end_time;
 
-    /// Hourly prices (EUR/MHh) without taxes
+    /// Prices (EUR/MHh) without taxes
     QVector<Price> prices;
+
+    /// Native length of price intervals in the block in seconds
+    int resolution_s = INTERVAL_S;
 };
 
-/// Start and end time pair
-struct TimePair {
-    QDateTime start; ///< Start time
-    QDateTime end;   ///< End time
+/// HTTP cache validators of a price response
+struct Validator {
+    QByteArray etag;          ///< Value of the ETag header
+    QByteArray last_modified; ///< Value of the Last-Modified header
+    qint64     checked_s = 0; ///< Time of the last successful request in seconds since the Epoch
+
+    /// Returns true if there are no validators
+    auto empty() const { return etag.isEmpty() && last_modified.isEmpty(); }
 };
 
 /// Array of price blocks that is always sorted by the start time
@@ -353,6 +428,8 @@ public:
     }
 
     /// Returns missing price blocks information
+    ///
+    /// Prices that are not observed are missing.
     /// @param[in] start Expected start time
     /// @param[in] end Expected end time
     /// @return Array of holes
@@ -365,39 +442,89 @@ public:
         }
 
         QVector<TimePair> result{};
+        auto next    = start; // start of the period that is not yet covered by price blocks
+        bool leading = true;
+        for (auto const &b : _blocks) {
+            if (next > end || b.start_time > end) {
+                break;
+            }
+            if (b.end_time < next) {
+                continue;
+            }
 
-        // check for missing prices before the first block
-        if (start < start_time()) {
-            result.append({start, start_time().addSecs(-1)});
-        }
+            for (auto const &p : b.observed_periods()) {
+                if (next > end || p.start > end) {
+                    break;
+                }
+                if (p.end < next) {
+                    continue;
+                }
 
-        // checks for holes between price blocks
-        auto const &args = Args::instance();
-        auto bend  = _blocks.first().end_time;
-        auto it    = _blocks.cbegin() + 1;
-        while (it != _blocks.cend()) {
+                // the first period must start at `start`, following periods may have a gap of one interval
+                auto const limit = leading ? next : next.addSecs(INTERVAL_S - 1);
+                if (p.start > limit) {
+                    // hole detected
+                    result.append({next, p.start.addSecs(-1)});
+                }
 
-            // check for the end time
-            if (end <= bend) {
-                return result;
+                next    = p.end.addSecs(1);
+                leading = false;
             }
+        }
 
-            // check for missing data between price blocks
-            if (it->start_time > bend.addSecs(args.interval())) {
-                // hole detected
-                result.append({bend, it->start_time.addSecs(-1)});
-            }
+        // check for missing prices after the last block
+        if (next <= end) {
+            result.append({next, end});
+        }
 
-            bend = it->end_time;
+        return result;
+    }
 
-            ++it;
-        }
+    /// Returns prices within the given time period
+    /// @param[in] start Start time
+    /// @param[in] end End time
+    /// @return Price blocks with prices from `start` to `end` (inclusive)
+    auto slice(QDateTime const &start, QDateTime const &end) const -> PriceBlocks
+    {
+        PriceBlocks result{};
+        for (auto const &b : _blocks) {
+            if (b.end_time < start || b.start_time > end) {
+                continue;
+            }
 
-        // check for missing prices after the last block
-        if (end > end_time()) {
-            result.append({end_time().addSecs(1), end});
+            // keep prices with any interval within the period
+            PriceBlock block{};
+            block.resolution_s = b.resolution_s;
+            for (auto const &price : b.prices) {
+                if (price.time <= end && price.time.addSecs(b.resolution_s - INTERVAL_S) >= start) {
+                    block.append(price);
+                }
+            }
+            if (!block.empty()) {
+                result._blocks.append(std::move(block));
+            }
         }
+        return result;
+    }
 
+    /// Returns only the observed prices
+    /// @return Price blocks without repeated prices
+    auto observed() const -> PriceBlocks
+    {
+        PriceBlocks result{};
+        for (auto const &b : _blocks) {
+            for (auto const &p : b.observed_periods()) {
+                PriceBlock block{};
+                block.resolution_s = b.resolution_s;
+                for (auto const &price : b.prices) {
+                    if (price.time >= p.start && price.time <= p.end) {
+                        block.append(price);
+                    }
+                }
+                block.end_time = p.end;
+                result._blocks.append(std::move(block));
+            }
+        }
         return result;
     }
 
@@ -449,9 +576,27 @@ private:
                     // there is a hole
                     normalized.append(b);
                 }
+                else if (b.resolution_s != normalized.back().resolution_s) {
+                    // blocks of different resolution are kept as separate adjacent blocks
+                    split(normalized, b);
+                }
                 else {
                     // block continues
-                    normalized.back().prices.append(b.prices);
+                    auto      &last     = normalized.back();
+                    auto const overlaps = b.start_time <= last.end_time;
+                    last.prices.append(b.prices);
+                    last.end_time = std::max(last.end_time, b.end_time);
+
+                    // keep the first price for the same time; observed prices take precedence
+                    if (overlaps) {
+                        std::stable_sort(last.prices.begin(), last.prices.end(), [](Price const &x, Price const &y) {
+                            return x.time < y.time || (x.time == y.time && x.observed && !y.observed);
+                        });
+                        auto const dup = std::unique(last.prices.begin(), last.prices.end(), [](Price const &x, Price const &y) {
+                            return x.time == y.time;
+                        });
+                        last.prices.erase(dup, last.prices.end());
+                    }
                 }
             }
         }
@@ -459,6 +604,36 @@ private:
         _blocks = std::move(normalized);
     }
 
+    /// Appends a block that overlaps the last normalized block and has a different resolution
+    ///
+    /// The overlapping part is taken from the last block, unless it has repeated prices there and
+    /// the new block does not and the new block covers the rest of the last block.
+    /// @param[in,out] normalized Normalized blocks
+    /// @param[in] b Block that starts within the last normalized block
+    static void split(QVector<PriceBlock> &normalized, PriceBlock const &b)
+    {
+        auto const repeats = [](PriceBlock const &block) {
+            return std::any_of(block.prices.cbegin(), block.prices.cend(), [](Price const &p) { return !p.observed; });
+        };
+
+        auto const &last = normalized.back();
+        if (last.end_time <= b.end_time && repeats(last.part(b.start_time, last.end_time)) &&
+            !repeats(b.part(b.start_time, last.end_time))) {
+            auto head = last.part(last.start_time, b.start_time.addSecs(-INTERVAL_S));
+            normalized.removeLast();
+            if (!head.empty()) {
+                normalized.append(std::move(head));
+            }
+            normalized.append(b);
+            return;
+        }
+
+        auto rest = b.part(last.end_time.addSecs(INTERVAL_S), b.end_time);
+        if (!rest.empty()) {
+            normalized.append(std::move(rest));
+        }
+    }
+
     /// Finds a block that contains the given time
     /// @param[in] time Time to find
     /// @return Pointer to the prices block or NULL if not found
@@ -475,6 +650,37 @@ private:
     }
 };
 
+/// Collects prices ordered by time into price blocks
+///
+/// Prices are kept in their native resolution, which is detected from the first two prices of
+/// a block (hourly prices were used by Nord Pool before 2025-10-01). A new block is started
+/// whenever there is a hole between two prices or the resolution changes.
+class PriceBuilder {
+public:
+
+    /// Adds the next price
+    /// @param[in] price Price that is not earlier than any of the previously added prices
+    void add(Price const &price);
+
+    /// Finishes the last block and returns collected prices
+    /// @return Price blocks
+    auto finish() -> PriceBlocks;
+
+private:
+
+    /// Finished price blocks
+    PriceBlocks _prices;
+
+    /// Current price block
+    PriceBlock _block;
+
+    /// Time of the previous price
+    QDateTime _last_time;
+
+    /// Appends the current block to finished blocks
+    void flush();
+};
+
 } // namespace El
 
 #endif // EL_COMMON_H_INCLUDED
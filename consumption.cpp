@@ -1,81 +1,176 @@
 #include "consumption.h"
-#include "app.h"
-#include "args.h"
 #include "common.h" // IWYU pragma: keep Needed for formatting Qt types
+#include "decompressor.h"
 #include "header.h"
-
-#include <QFile>
+#include "profile.h"
+#include "rowparser.h"
 
 #include <fmt/format.h>
 
+#include <algorithm>
+
 namespace El {
 
-Consumption::Consumption(App const &app)
-    : _app(app)
-{}
+auto Consumption::peek_period(QString const &filename, QDateTime const &end) -> std::optional<TimePair>
+{
+    using namespace Qt::Literals::StringLiterals;
+
+    auto const input = Decompressor::open_input(filename);
+    if (!input->isOpen()) {
+        return {};
+    }
+
+    // the period is given before the header
+    constexpr int MAX_PREAMBLE_LINES = 10;
+    for (int i = 0; i < MAX_PREAMBLE_LINES && !input->atEnd(); ++i) {
+        auto const fields = QString::fromUtf8(input->readLine().trimmed()).split(';');
+        if (fields.size() < 2 || fields.at(0) != u"Periood"_s) {
+            continue;
+        }
+
+        auto const dates = fields.at(1).split(u" kuni "_s);
+        if (dates.size() != 2) {
+            return {};
+        }
+
+        auto const first_day = QDate::fromString(dates.at(0).trimmed(), Qt::ISODate);
+        auto const last_day  = QDate::fromString(dates.at(1).trimmed(), Qt::ISODate);
+        if (!first_day.isValid() || !last_day.isValid()) {
+            return {};
+        }
+
+        // start time of the last interval of the last day
+        auto const last = QDateTime{last_day.addDays(1), QTime{0, 0}}.addSecs(-INTERVAL_S);
+        return TimePair{QDateTime{first_day, QTime{0, 0}}, std::min(last, end)};
+    }
+
+    return {};
+}
+
+auto Consumption::load(QString const &filename, QDateTime const &end) -> bool
+{
+    Position pos{};
+    if (!load(filename, end, pos)) {
+        return false;
+    }
+
+    // ensure that there is at least one record
+    if (_records.isEmpty()) {
+        fmt::print(stderr, "CSV fail ei sisalda ühtegi kirjet\n");
+        return false;
+    }
 
-Consumption::~Consumption() = default;
+    return true;
+}
 
-auto Consumption::load(QString const &filename) -> bool
+auto Consumption::load(QString const &filename, QDateTime const &end, Position &pos) -> bool
 {
-    auto const &args = Args::instance();
+    Profile::Scope const profile{"Consumption::load"};
 
-    // open the input file
-    QFile file(filename);
-    if (!file.open(QFile::ReadOnly | QFile::Text)) {
+    // open the input file; compressed files are decompressed while they are read
+    auto const input = Decompressor::open_input(filename);
+    auto      &file  = *input;
+    if (!file.isOpen()) {
         fmt::print(stderr, "CSV faili {} avamine ebaõnnestus: {}", filename, file.errorString());
         return false;
     }
 
+    // continue after the last complete line once the header is known; the offset in compressed
+    // files is in the decompressed data
+    auto const resume = pos.header.isValid();
+    if (!resume) {
+        pos = Position{};
+    }
+    auto const sequential = file.isSequential();
+    if (sequential ? file.skip(pos.offset) != pos.offset : !file.seek(pos.offset)) {
+        fmt::print(stderr, "CSV faili {} lugemine ebaõnnestus: {}", filename, file.errorString());
+        return false;
+    }
+    auto offset = pos.offset;
+
     // load all the records
-    int lineno = 0;
-    bool skip = true;
-    bool header = true;
-    Header hdr;
+    auto const count    = _records.size();
+    int        rejected = 0;
+    bool       skip     = !resume;
+    bool       header   = !resume;
+
+    // rows are parsed with a parser specialized for the layout of the file
+    RowParser parser{};
+    if (resume) {
+        parser = RowParser{pos.header};
+    }
     while (!file.atEnd()) {
-        ++lineno;
+        ++pos.lineno;
 
-        auto const line = file.readLine().trimmed();
+        auto const raw  = file.readLine();
+        auto const line = raw.trimmed();
+        offset += raw.size();
+
+        // a line that is still being written is read again next time
+        auto const advance = [&file, &pos, sequential, offset, complete = raw.endsWith('\n')]() {
+            if (complete) {
+                pos.offset = sequential ? offset : file.pos();
+            }
+            else {
+                --pos.lineno;
+            }
+        };
 
         // skip the first lines until we reach the header
         if (skip) {
             // there is an empty line or a line with just two quotes between the beginning and header
             skip = !line.isEmpty() && line != "\"\"";
+            advance();
             continue;
         }
 
         // read the header
         if (header) {
+            // an incomplete header is the last line; the file is read from the start next time
+            if (!raw.endsWith('\n')) {
+                break;
+            }
             header = false;
 
-            hdr = Header(line);
-            if (!hdr.isValid()) {
+            pos.header = Header(line);
+            if (!pos.header.isValid()) {
                 return false;
             }
+            parser = RowParser{pos.header};
+            advance();
             continue;
         }
 
-        Record rec{lineno, line, hdr};
+        auto rec = parser.isValid() ? parser.parse(pos.lineno, line) : Record{pos.lineno, line, pos.header};
         if (!rec.isValid()) {
+            ++rejected;
+            advance();
             continue;
         }
 
-        // verify time
-        if (rec.endTime() > args.time()) {
+        // verify time; later records are read again next time
+        if (rec.endTime() > end) {
+            --pos.lineno;
             break;
         }
 
         _records.append(std::move(rec));
+        advance();
     }
 
-    // ensure that there is at least one record
-    if (_records.isEmpty()) {
-        fmt::print(stderr, "CSV fail ei sisalda ühtegi kirjet\n");
+    // corrupt or truncated compressed data
+    if (auto const *d = dynamic_cast<Decompressor const *>(input.get()); d != nullptr && d->failed()) {
+        fmt::print(stderr, "CSV faili {} lugemine ebaõnnestus: {}\n", filename, file.errorString());
         return false;
     }
 
-    _first_record_time = _records.first().startTime();
-    _last_record_time = _records.last().startTime();
+    Profile::count(Profile::Counter::RowsParsed, _records.size() - count);
+    Profile::count(Profile::Counter::RowsRejected, rejected);
+
+    if (!_records.isEmpty()) {
+        _first_record_time = _records.first().startTime();
+        _last_record_time  = _records.last().startTime();
+    }
 
     return true;
 }
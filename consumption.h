@@ -3,30 +3,59 @@
 #ifndef EL_CONSUMPTION_H_INCLUDED
 #  define EL_CONSUMPTION_H_INCLUDED
 
+#include "common.h"
+#include "header.h"
 #include "record.h"
 
 #include <QDateTime>
 #include <QVector>
 
-namespace El {
+#include <optional>
 
-class App;
+namespace El {
 
 /// Container class for consumption records
 class Consumption {
 public:
 
     /// Ctor
-    /// @param[in] app Application instance
-    Consumption(App const &app);
+    Consumption() = default;
 
-    /// Dtor
-    ~Consumption();
+    /// Returns the period from the preamble of the CSV file without loading the whole file
+    ///
+    /// Elering CSV files have a line like `Periood;2025-08-01 kuni 2025-08-28` before the header.
+    /// The end of the period is limited by the requested end time.
+    /// @param[in] filename Name of the CSV file
+    /// @param[in] end Requested end time
+    /// @return The start time of the first and last record or an empty value if not found
+    static auto peek_period(QString const &filename, QDateTime const &end) -> std::optional<TimePair>;
 
-    /// Loads records from the given CSV file
+    /// Loads records that end before the given time from the CSV file
+    ///
+    /// Can be called from a worker thread.
     /// @param[in] filename Name of the CSV file
+    /// @param[in] end Records ending after this time are ignored
     /// @return True when succeeded, otherwise false
-    auto load(QString const &filename) -> bool;
+    auto load(QString const &filename, QDateTime const &end) -> bool;
+
+    /// Position in a CSV file for loading records appended to the file
+    struct Position {
+        qint64 offset = 0; ///< Offset after the last complete line that was read; 0 for the start
+        int    lineno = 0; ///< Number of the last complete line that was read
+        Header header;     ///< Header of the file
+    };
+
+    /// Loads records that end before the given time from the CSV file starting from the position
+    ///
+    /// Records are appended to the already loaded records. The position is updated, so that the
+    /// next call loads only lines appended to the file since this call. A last line without a
+    /// line feed may be incomplete and is loaded again by the next call. Can be called from a
+    /// worker thread.
+    /// @param[in] filename Name of the CSV file
+    /// @param[in] end Records ending after this time are ignored
+    /// @param[in,out] pos Position in the file
+    /// @return True when succeeded (also if there were no new records), otherwise false
+    auto load(QString const &filename, QDateTime const &end, Position &pos) -> bool;
 
     /// Returns consumption records
     auto records() const noexcept -> auto const & { return _records; }
@@ -39,9 +68,6 @@ public:
 
 private:
 
-    /// Application instance
-    App const &_app;
-
     /// Consumption records
     QVector<Record> _records;
 
@@ -0,0 +1,478 @@
+#include "decompressor.h"
+
+#include <QFile>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef ELEKTER_HAVE_ZLIB
+#  include <zlib.h>
+#endif
+#ifdef ELEKTER_HAVE_ZSTD
+#  include <zstd.h>
+#endif
+
+namespace {
+
+constexpr std::size_t INPUT_SIZE = 128 * 1024;
+
+/// Zip local file header without the file name and extra field
+constexpr std::size_t ZIP_HEADER_SIZE = 30;
+
+/// Zip compression methods
+constexpr unsigned ZIP_STORED   = 0;
+constexpr unsigned ZIP_DEFLATED = 8;
+
+/// Zip flag for sizes that follow the data instead of the header
+constexpr unsigned ZIP_DATA_DESCRIPTOR = 0x08;
+
+/// Returns a little-endian 16-bit value
+auto le16(unsigned char const *p) -> unsigned
+{
+    return p[0] | (p[1] << 8U);
+}
+
+/// Returns a little-endian 32-bit value
+auto le32(unsigned char const *p) -> quint32
+{
+    return p[0] | (p[1] << 8U) | (p[2] << 16U) | (static_cast<quint32>(p[3]) << 24U);
+}
+
+} // namespace
+
+namespace El {
+
+struct Decompressor::State {
+    Format     format = Format::Gzip;
+    std::FILE *file   = nullptr;
+
+#ifdef ELEKTER_HAVE_ZLIB
+    z_stream zs{};
+    bool     zs_init = false;
+#endif
+#ifdef ELEKTER_HAVE_ZSTD
+    ZSTD_DStream *zstd = nullptr;
+#endif
+
+    std::vector<char> in = std::vector<char>(INPUT_SIZE);
+    std::size_t       in_pos  = 0;
+    std::size_t       in_size = 0;
+    bool              in_eof  = false;
+
+    qint64 stored_left = -1;    ///< Bytes left in a stored zip entry; -1 if deflated
+    bool   frame_end   = false; ///< A gzip member or zstd frame ended at the current input
+    bool   finished    = false; ///< All the data is decompressed
+    std::string error;          ///< Error message; empty if succeeded
+
+    std::thread             thread;
+    mutable std::mutex      mutex;
+    std::condition_variable cv;
+    std::deque<QByteArray>  queue;
+    bool                    done = false; ///< The thread has finished
+    bool                    stop = false; ///< The thread is asked to stop
+
+    ~State()
+    {
+        if (thread.joinable()) {
+            {
+                std::lock_guard const lock{mutex};
+                stop = true;
+            }
+            cv.notify_all();
+            thread.join();
+        }
+#ifdef ELEKTER_HAVE_ZLIB
+        if (zs_init) {
+            inflateEnd(&zs);
+        }
+#endif
+#ifdef ELEKTER_HAVE_ZSTD
+        ZSTD_freeDStream(zstd);
+#endif
+        if (file != nullptr) {
+            std::fclose(file);
+        }
+    }
+
+    /// Initializes the decoder; reads the local file header of zip archives
+    auto init() -> bool
+    {
+        switch (format) {
+            case Format::Gzip:
+            case Format::Zip: {
+#ifdef ELEKTER_HAVE_ZLIB
+                if (format == Format::Zip && !read_zip_header()) {
+                    return false;
+                }
+                // gzip header (15 + 16) or raw deflate data in zip archives
+                constexpr int WINDOW_BITS = 15;
+                constexpr int GZIP        = 16;
+                if (inflateInit2(&zs, format == Format::Gzip ? WINDOW_BITS + GZIP : -WINDOW_BITS) != Z_OK) {
+                    error = "zlib initsialiseerimine ebaõnnestus";
+                    return false;
+                }
+                zs_init = true;
+                return true;
+#else
+                error = "gzip ja zip tugi puudub";
+                return false;
+#endif
+            }
+            case Format::Zstd: {
+#ifdef ELEKTER_HAVE_ZSTD
+                zstd = ZSTD_createDStream();
+                if (zstd == nullptr || ZSTD_isError(ZSTD_initDStream(zstd))) {
+                    error = "zstd initsialiseerimine ebaõnnestus";
+                    return false;
+                }
+                return true;
+#else
+                error = "zstd tugi puudub";
+                return false;
+#endif
+            }
+        }
+        return false;
+    }
+
+    /// Reads the local file header of the first file in a zip archive
+    auto read_zip_header() -> bool
+    {
+        while (true) {
+            std::array<unsigned char, ZIP_HEADER_SIZE> h{};
+            if (std::fread(h.data(), 1, h.size(), file) != h.size() || le32(h.data()) != 0x04034b50) {
+                error = "zip arhiivis ei ole ühtegi faili";
+                return false;
+            }
+
+            auto const flags  = le16(h.data() + 6);
+            auto const method = le16(h.data() + 8);
+            auto const size   = le32(h.data() + 18);
+            auto const name   = le16(h.data() + 26);
+            auto const extra  = le16(h.data() + 28);
+
+            std::string filename(name, '\0');
+            if (std::fread(filename.data(), 1, name, file) != name || std::fseek(file, extra, SEEK_CUR) != 0) {
+                error = "vigane zip arhiiv";
+                return false;
+            }
+
+            // skip directories
+            if (!filename.empty() && filename.back() == '/') {
+                if (std::fseek(file, static_cast<long>(size), SEEK_CUR) != 0) {
+                    error = "vigane zip arhiiv";
+                    return false;
+                }
+                continue;
+            }
+
+            if (method == ZIP_STORED && (flags & ZIP_DATA_DESCRIPTOR) == 0) {
+                stored_left = size;
+                return true;
+            }
+            if (method == ZIP_DEFLATED) {
+                return true;
+            }
+            error = "zip arhiivi tihendusmeetodit ei toetata";
+            return false;
+        }
+    }
+
+    /// Decompresses the next chunk
+    /// @param[out] out Decompressed data (may be empty)
+    /// @return false if all the data is decompressed or on errors
+    auto decode(QByteArray &out) -> bool
+    {
+        out.resize(CHUNK_SIZE);
+        std::size_t produced = 0;
+
+        while (produced < static_cast<std::size_t>(out.size()) && !finished && error.empty()) {
+
+            // read more input
+            if (in_pos == in_size && !in_eof) {
+                in_pos  = 0;
+                in_size = std::fread(in.data(), 1, in.size(), file);
+                if (in_size == 0) {
+                    if (std::ferror(file) != 0) {
+                        error = "faili lugemine ebaõnnestus";
+                        break;
+                    }
+                    in_eof = true;
+                }
+            }
+
+            // the input ends; complete only after the end of a member, frame or stored entry
+            if (in_pos == in_size && in_eof) {
+                if (frame_end || stored_left == 0) {
+                    finished = true;
+                }
+                else {
+                    error = "tihendatud fail on poolik";
+                }
+                break;
+            }
+
+            auto *dst   = out.data() + produced;
+            auto  space = static_cast<std::size_t>(out.size()) - produced;
+
+            if (stored_left >= 0) {
+                auto const n = std::min({space, in_size - in_pos, static_cast<std::size_t>(stored_left)});
+                std::memcpy(dst, in.data() + in_pos, n);
+                in_pos += n;
+                produced += n;
+                stored_left -= static_cast<qint64>(n);
+                finished = stored_left == 0;
+                continue;
+            }
+
+            switch (format) {
+                case Format::Gzip:
+                case Format::Zip: {
+#ifdef ELEKTER_HAVE_ZLIB
+                    // data after the end of a gzip member is the next member
+                    if (frame_end) {
+                        inflateReset(&zs);
+                        frame_end = false;
+                    }
+                    zs.next_in   = reinterpret_cast<Bytef *>(in.data() + in_pos);
+                    zs.avail_in  = static_cast<uInt>(in_size - in_pos);
+                    zs.next_out  = reinterpret_cast<Bytef *>(dst);
+                    zs.avail_out = static_cast<uInt>(space);
+                    auto const rc = inflate(&zs, Z_NO_FLUSH);
+                    in_pos        = in_size - zs.avail_in;
+                    produced += space - zs.avail_out;
+                    if (rc == Z_STREAM_END) {
+                        frame_end = true;
+                        finished  = format == Format::Zip;
+                    }
+                    else if (rc != Z_OK && rc != Z_BUF_ERROR) {
+                        error = "vigased tihendatud andmed";
+                    }
+#endif
+                    break;
+                }
+                case Format::Zstd: {
+#ifdef ELEKTER_HAVE_ZSTD
+                    ZSTD_inBuffer  input{in.data(), in_size, in_pos};
+                    ZSTD_outBuffer output{dst, space, 0};
+                    auto const     rc = ZSTD_decompressStream(zstd, &output, &input);
+                    if (ZSTD_isError(rc)) {
+                        error = ZSTD_getErrorName(rc);
+                        break;
+                    }
+                    in_pos = input.pos;
+                    produced += output.pos;
+                    frame_end = rc == 0;
+#endif
+                    break;
+                }
+            }
+        }
+
+        out.resize(static_cast<qsizetype>(produced));
+        return !finished && error.empty();
+    }
+
+    /// Decompresses chunks ahead of the reader
+    void run()
+    {
+        while (true) {
+            QByteArray chunk{};
+            auto const more = decode(chunk);
+
+            std::unique_lock lock{mutex};
+            cv.wait(lock, [this]() { return stop || queue.size() < QUEUE_CHUNKS; });
+            if (stop) {
+                return;
+            }
+            if (!chunk.isEmpty()) {
+                queue.push_back(std::move(chunk));
+            }
+            done = !more;
+            cv.notify_all();
+            if (done) {
+                return;
+            }
+        }
+    }
+};
+
+auto Decompressor::open_input(QString const &filename) -> std::unique_ptr<QIODevice>
+{
+    // the magic bytes decide the format
+    auto file = std::make_unique<QFile>(filename);
+    if (!file->open(QFile::ReadOnly)) {
+        return file;
+    }
+    auto const format = detect(file->peek(4));
+    file->close();
+
+    if (format) {
+        auto d = std::make_unique<Decompressor>(filename, *format);
+        d->open(QIODevice::ReadOnly);
+        return d;
+    }
+
+    file->open(QFile::ReadOnly | QFile::Text);
+    return file;
+}
+
+auto Decompressor::detect(QByteArray const &head) -> std::optional<Format>
+{
+    if (head.startsWith("\x1f\x8b")) {
+        return Format::Gzip;
+    }
+    if (head.startsWith("\x28\xb5\x2f\xfd")) {
+        return Format::Zstd;
+    }
+    if (head.startsWith("PK\x03\x04")) {
+        return Format::Zip;
+    }
+    return {};
+}
+
+Decompressor::Decompressor(QString filename, Format format)
+    : _filename(std::move(filename))
+    , _format(format)
+{}
+
+Decompressor::~Decompressor()
+{
+    Decompressor::close();
+}
+
+auto Decompressor::open(OpenMode mode) -> bool
+{
+    if (isOpen() || (mode & WriteOnly) != 0) {
+        setErrorString(QStringLiteral("toetatud on ainult lugemine"));
+        return false;
+    }
+
+    _state         = std::make_unique<State>();
+    _state->format = _format;
+    _state->file   = std::fopen(QFile::encodeName(_filename).constData(), "rb");
+    if (_state->file == nullptr) {
+        setErrorString(QString::fromLocal8Bit(std::strerror(errno)));
+        _state.reset();
+        return false;
+    }
+
+    // large files are decompressed ahead of the reader
+    std::fseek(_state->file, 0, SEEK_END);
+    auto const size = std::ftell(_state->file);
+    std::fseek(_state->file, 0, SEEK_SET);
+
+    if (!_state->init()) {
+        setErrorString(QString::fromStdString(_state->error));
+        _state.reset();
+        return false;
+    }
+    if (size >= THREAD_MIN_SIZE) {
+        _state->thread = std::thread{[state = _state.get()]() { state->run(); }};
+    }
+
+    _current.clear();
+    _pos = 0;
+    return QIODevice::open(mode);
+}
+
+void Decompressor::close()
+{
+    _state.reset();
+    _current.clear();
+    _pos = 0;
+    QIODevice::close();
+}
+
+auto Decompressor::atEnd() const -> bool
+{
+    // decompresses the next chunk if needed; the device is still logically unchanged
+    return QIODevice::bytesAvailable() == 0 && !const_cast<Decompressor *>(this)->fetch();
+}
+
+auto Decompressor::bytesAvailable() const -> qint64
+{
+    return QIODevice::bytesAvailable() + (_current.size() - _pos);
+}
+
+auto Decompressor::failed() const -> bool
+{
+    if (!_state) {
+        return false;
+    }
+
+    // the thread sets the error before it is done
+    if (_state->thread.joinable()) {
+        std::lock_guard const lock{_state->mutex};
+        return _state->done && !_state->error.empty();
+    }
+    return !_state->error.empty();
+}
+
+auto Decompressor::fetch() -> bool
+{
+    if (_pos < _current.size()) {
+        return true;
+    }
+    if (!_state) {
+        return false;
+    }
+
+    _current.clear();
+    _pos = 0;
+
+    // decompressed ahead in the thread
+    if (_state->thread.joinable()) {
+        std::unique_lock lock{_state->mutex};
+        _state->cv.wait(lock, [this]() { return !_state->queue.empty() || _state->done; });
+        if (_state->queue.empty()) {
+            return false;
+        }
+        _current = std::move(_state->queue.front());
+        _state->queue.pop_front();
+        _state->cv.notify_all();
+        return true;
+    }
+
+    // decompressed when needed
+    while (!_state->done) {
+        _state->done = !_state->decode(_current);
+        if (!_current.isEmpty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+auto Decompressor::readData(char *data, qint64 maxSize) -> qint64
+{
+    qint64 n = 0;
+    while (n < maxSize && fetch()) {
+        auto const count = std::min<qint64>(maxSize - n, _current.size() - _pos);
+        std::memcpy(data + n, _current.constData() + _pos, static_cast<std::size_t>(count));
+        _pos += count;
+        n += count;
+    }
+
+    if (n == 0 && failed()) {
+        setErrorString(QString::fromStdString(_state->error));
+        return -1;
+    }
+    return n;
+}
+
+auto Decompressor::writeData(char const * /*data*/, qint64 /*maxSize*/) -> qint64
+{
+    return -1;
+}
+
+} // namespace El
@@ -0,0 +1,110 @@
+#pragma once
+
+#ifndef EL_DECOMPRESSOR_H_INCLUDED
+#  define EL_DECOMPRESSOR_H_INCLUDED
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+
+#include <memory>
+#include <optional>
+
+namespace El {
+
+/// Sequential device that decompresses a gzip, zstd or zip file as a stream
+///
+/// The format is detected by the magic bytes at the beginning of the file, not by the file name.
+/// Only the first file in a zip archive is read. Large files are decompressed ahead in a
+/// separate thread, so that decompressing and parsing run in parallel; the decompressors
+/// themselves are single-threaded.
+class Decompressor : public QIODevice {
+public:
+
+    /// Compression formats
+    enum class Format {
+        Gzip, ///< gzip, also with multiple members
+        Zstd, ///< Zstandard, also with multiple frames
+        Zip,  ///< The first file of a zip archive (stored or deflated)
+    };
+
+    /// Size of decompressed chunks
+    static constexpr qint64 CHUNK_SIZE = 256 * 1024;
+
+    /// Maximum number of decompressed chunks waiting for the reader
+    static constexpr int QUEUE_CHUNKS = 4;
+
+    /// Files at least this large are decompressed in a separate thread
+    static constexpr qint64 THREAD_MIN_SIZE = 1024 * 1024;
+
+    /// Opens the file for reading, decompressing it if it is compressed
+    ///
+    /// Plain files are opened as a `QFile` in text mode.
+    /// @param[in] filename Name of the file
+    /// @return The device; check `isOpen()` and `errorString()` for errors
+    static auto open_input(QString const &filename) -> std::unique_ptr<QIODevice>;
+
+    /// Detects the compression format
+    /// @param[in] head The first bytes of the file (at least 4)
+    /// @return The format or an empty value if the data is not compressed
+    static auto detect(QByteArray const &head) -> std::optional<Format>;
+
+    /// Ctor
+    /// @param[in] filename Name of the compressed file
+    /// @param[in] format Compression format
+    Decompressor(QString filename, Format format);
+
+    /// Dtor
+    ~Decompressor() override;
+
+    Decompressor(Decompressor const &)                     = delete;
+    Decompressor(Decompressor &&)                          = delete;
+    auto operator=(Decompressor const &) -> Decompressor & = delete;
+    auto operator=(Decompressor &&) -> Decompressor &      = delete;
+
+    /// Opens the file and starts decompressing; only `ReadOnly` is supported
+    auto open(OpenMode mode) -> bool override;
+
+    /// Stops decompressing and closes the file
+    void close() override;
+
+    auto isSequential() const -> bool override { return true; }
+    auto atEnd() const -> bool override;
+    auto bytesAvailable() const -> qint64 override;
+
+    /// Returns true if the data could not be read or is corrupt
+    auto failed() const -> bool;
+
+protected:
+
+    auto readData(char *data, qint64 maxSize) -> qint64 override;
+    auto writeData(char const *data, qint64 maxSize) -> qint64 override;
+
+private:
+
+    /// Decompressor state (defined in the source to keep the codec headers private)
+    struct State;
+
+    /// Name of the compressed file
+    QString _filename;
+
+    /// Compression format
+    Format _format;
+
+    /// Decompressor state while open
+    std::unique_ptr<State> _state;
+
+    /// Decompressed data being read
+    QByteArray _current;
+
+    /// Read position in `_current`
+    qsizetype _pos = 0;
+
+    /// Makes sure that `_current` has unread data
+    /// @return false at the end of the data or on errors
+    auto fetch() -> bool;
+};
+
+} // namespace El
+
+#endif // EL_DECOMPRESSOR_H_INCLUDED
@@ -0,0 +1,172 @@
+#include "digest.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+
+/// Scale function k1 of the t-digest; centroids are at most one unit of `k` wide
+auto scale(double q, double compression) -> double
+{
+    return compression / (2.0 * PI) * std::asin(2.0 * q - 1.0);
+}
+
+/// Returns the largest quantile that a centroid starting at `q` may reach
+auto limit(double q, double compression) -> double
+{
+    auto const k = scale(q, compression) + 1.0;
+    if (k >= compression / 4.0) {
+        return 1.0;
+    }
+    return (std::sin(k * 2.0 * PI / compression) + 1.0) / 2.0;
+}
+
+} // namespace
+
+namespace El {
+
+Digest::Digest(double compression)
+    : _compression(compression)
+{}
+
+void Digest::add(double value, double weight)
+{
+    if (weight <= 0.0 || !std::isfinite(value)) {
+        return;
+    }
+
+    _buffer.push_back({value, weight});
+    _weight += weight;
+    _min = std::min(_min, value);
+    _max = std::max(_max, value);
+
+    if (static_cast<double>(_buffer.size()) >= BUFFER_FACTOR * _compression) {
+        compress();
+    }
+}
+
+void Digest::merge(Digest const &other)
+{
+    if (other.empty()) {
+        return;
+    }
+
+    _buffer.insert(_buffer.end(), other._centroids.cbegin(), other._centroids.cend());
+    _buffer.insert(_buffer.end(), other._buffer.cbegin(), other._buffer.cend());
+    _weight += other._weight;
+    _min = std::min(_min, other._min);
+    _max = std::max(_max, other._max);
+
+    compress();
+}
+
+void Digest::compress()
+{
+    if (_buffer.empty()) {
+        return;
+    }
+
+    _buffer.insert(_buffer.end(), _centroids.cbegin(), _centroids.cend());
+    std::sort(_buffer.begin(), _buffer.end(), [](Centroid const &a, Centroid const &b) { return a.mean < b.mean; });
+
+    std::vector<Centroid> merged{};
+    merged.reserve(static_cast<size_t>(_compression));
+
+    // merge neighbours as long as the centroid stays within its size limit
+    auto   current = _buffer.front();
+    double so_far  = 0.0;
+    double max_q   = limit(0.0, _compression);
+    for (auto it = _buffer.cbegin() + 1; it != _buffer.cend(); ++it) {
+        if ((so_far + current.weight + it->weight) / _weight <= max_q) {
+            current.weight += it->weight;
+            current.mean += (it->mean - current.mean) * it->weight / current.weight;
+        }
+        else {
+            so_far += current.weight;
+            merged.push_back(current);
+            max_q   = limit(so_far / _weight, _compression);
+            current = *it;
+        }
+    }
+    merged.push_back(current);
+
+    _centroids = std::move(merged);
+    _buffer.clear();
+}
+
+auto Digest::quantile(double q) const -> double
+{
+    if (!_buffer.empty()) {
+        auto copy = *this;
+        copy.compress();
+        return copy.quantile(q);
+    }
+    if (_centroids.empty()) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    if (_centroids.size() == 1) {
+        return _centroids.front().mean;
+    }
+
+    // interpolate between the centres of centroids and the smallest and largest values
+    auto const  index = std::clamp(q, 0.0, 1.0) * _weight;
+    auto const &first = _centroids.front();
+    if (index < first.weight / 2.0) {
+        return _min + (first.mean - _min) * index / (first.weight / 2.0);
+    }
+
+    auto centre = first.weight / 2.0;
+    for (size_t i = 0; i + 1 < _centroids.size(); ++i) {
+        auto const &a    = _centroids[i];
+        auto const &b    = _centroids[i + 1];
+        auto const  step = (a.weight + b.weight) / 2.0;
+        if (index < centre + step) {
+            return a.mean + (b.mean - a.mean) * (index - centre) / step;
+        }
+        centre += step;
+    }
+
+    auto const &last = _centroids.back();
+    return last.mean + (_max - last.mean) * std::min(1.0, (index - centre) / (last.weight / 2.0));
+}
+
+auto Digest::cdf(double value) const -> double
+{
+    if (!_buffer.empty()) {
+        auto copy = *this;
+        copy.compress();
+        return copy.cdf(value);
+    }
+    if (_centroids.empty()) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    if (value < _min) {
+        return 0.0;
+    }
+    if (value >= _max) {
+        return 1.0;
+    }
+
+    auto const &first = _centroids.front();
+    if (value < first.mean) {
+        return first.weight / 2.0 * (value - _min) / (first.mean - _min) / _weight;
+    }
+
+    auto centre = first.weight / 2.0;
+    for (size_t i = 0; i + 1 < _centroids.size(); ++i) {
+        auto const &a    = _centroids[i];
+        auto const &b    = _centroids[i + 1];
+        auto const  step = (a.weight + b.weight) / 2.0;
+        if (value < b.mean) {
+            return (centre + step * (value - a.mean) / (b.mean - a.mean)) / _weight;
+        }
+        centre += step;
+    }
+
+    auto const &last = _centroids.back();
+    return (centre + last.weight / 2.0 * (value - last.mean) / (_max - last.mean)) / _weight;
+}
+
+} // namespace El
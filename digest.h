@@ -0,0 +1,83 @@
+#pragma once
+
+#ifndef EL_DIGEST_H_INCLUDED
+#  define EL_DIGEST_H_INCLUDED
+
+#include <limits>
+#include <vector>
+
+namespace El {
+
+/// Mergeable streaming quantile sketch (merging t-digest)
+///
+/// Values are collected into a buffer that is merged into a bounded number of weighted
+/// centroids when it is full. Centroids near the tails are kept small, so that extreme
+/// quantiles like p99 are accurate, while centroids near the median can be large. The size of
+/// the digest does not depend on the number of values and two digests built from different
+/// data, for example in different threads, can be merged into one that describes all the data.
+class Digest {
+public:
+
+    /// Default compression; a digest has at most about this many centroids
+    static constexpr double DEFAULT_COMPRESSION = 100.0;
+
+    /// Ctor
+    /// @param[in] compression Compression; higher values are more accurate and use more memory
+    explicit Digest(double compression = DEFAULT_COMPRESSION);
+
+    /// Adds a value
+    /// @param[in] value The value
+    /// @param[in] weight Weight of the value
+    void add(double value, double weight = 1.0);
+
+    /// Adds all the values from another digest
+    /// @param[in] other The other digest
+    void merge(Digest const &other);
+
+    /// Merges buffered values into centroids
+    void compress();
+
+    /// Returns true if there are no values
+    auto empty() const noexcept { return _weight <= 0.0; }
+
+    /// Returns the sum of weights
+    auto weight() const noexcept { return _weight; }
+
+    /// Returns the smallest value
+    auto min() const noexcept { return _min; }
+
+    /// Returns the largest value
+    auto max() const noexcept { return _max; }
+
+    /// Returns the estimated quantile
+    /// @param[in] q Quantile from 0 to 1
+    /// @return The value or NaN if there are no values
+    auto quantile(double q) const -> double;
+
+    /// Returns the estimated fraction of the weight of values that are not larger than the value
+    /// @param[in] value The value
+    /// @return The fraction from 0 to 1 or NaN if there are no values
+    auto cdf(double value) const -> double;
+
+private:
+
+    /// Number of buffered values per unit of compression
+    static constexpr double BUFFER_FACTOR = 5.0;
+
+    /// Weighted mean of values
+    struct Centroid {
+        double mean   = 0.0;
+        double weight = 0.0;
+    };
+
+    double                _compression;
+    std::vector<Centroid> _centroids;
+    std::vector<Centroid> _buffer;
+    double                _weight = 0.0;
+    double                _min    = std::numeric_limits<double>::infinity();
+    double                _max    = -std::numeric_limits<double>::infinity();
+};
+
+} // namespace El
+
+#endif // EL_DIGEST_H_INCLUDED
@@ -0,0 +1,77 @@
+#include "distribution.h"
+#include "record.h"
+
+namespace El {
+
+// -----------------------------------------------------------------------------
+
+void Distribution::add(Record const &rec, std::optional<double> const &price)
+{
+    kwh.add(rec.kWh());
+    if (price) {
+        this->price.add(*price);
+        paid.add(*price, rec.kWh());
+    }
+}
+
+void Distribution::merge(Distribution const &other)
+{
+    kwh.merge(other.kwh);
+    price.merge(other.price);
+    paid.merge(other.paid);
+}
+
+void Distribution::compress()
+{
+    kwh.compress();
+    price.compress();
+    paid.compress();
+}
+
+// -----------------------------------------------------------------------------
+
+void Distributions::add(Record const &rec, std::optional<double> const &price)
+{
+    auto const date = rec.startTime().date();
+    _months[QDate{date.year(), date.month(), 1}].add(rec, price);
+    _total.add(rec, price);
+}
+
+void Distributions::merge(Distributions const &other)
+{
+    for (auto const &[month, dist] : other._months) {
+        _months[month].merge(dist);
+    }
+    _total.merge(other._total);
+}
+
+void Distributions::compress()
+{
+    for (auto &[month, dist] : _months) {
+        dist.compress();
+    }
+    _total.compress();
+}
+
+auto Distributions::histogram(int bins) const -> QVector<Bin>
+{
+    auto const &kwh = _total.kwh;
+    if (kwh.empty() || bins <= 0) {
+        return {};
+    }
+
+    QVector<Bin> result{};
+    result.reserve(bins);
+    auto const width = (kwh.max() - kwh.min()) / bins;
+    auto       below = 0.0;
+    for (auto i = 0; i < bins; ++i) {
+        auto const from = kwh.min() + width * i;
+        auto const to   = i + 1 < bins ? from + width : kwh.max();
+        auto const cdf  = kwh.cdf(to);
+        result.append({from, to, (cdf - below) * kwh.weight()});
+        below = cdf;
+    }
+    return result;
+}
+
+} // namespace El
@@ -0,0 +1,92 @@
+#pragma once
+
+#ifndef EL_DISTRIBUTION_H_INCLUDED
+#  define EL_DISTRIBUTION_H_INCLUDED
+
+#include "digest.h"
+
+#include <QDate>
+#include <QVector>
+
+#include <array>
+#include <map>
+#include <optional>
+
+namespace El {
+
+class Record;
+
+/// Distributions of interval consumption and prices
+struct Distribution {
+    Digest kwh;   ///< Consumption of intervals kWh
+    Digest price; ///< Prices of intervals EUR/kWh without taxes
+    Digest paid;  ///< Prices of intervals weighted by the consumption, i.e. prices of consumed kWh
+
+    /// Adds the record
+    /// @param[in] rec Consumption record
+    /// @param[in] price Price EUR/kWh or an empty value if there is no price for the record
+    void add(Record const &rec, std::optional<double> const &price);
+
+    /// Adds all the values from another distribution
+    /// @param[in] other The other distribution
+    void merge(Distribution const &other);
+
+    /// Merges buffered values of the digests
+    void compress();
+};
+
+/// Streaming distributions for every month and for the whole period
+///
+/// Records are added while they are calculated, so that no values need to be kept or sorted.
+/// Distributions of different files and meters can be built in parallel and merged.
+class Distributions {
+public:
+
+    /// Quantiles that are reported
+    static constexpr std::array<double, 3> QUANTILES = {0.5, 0.9, 0.99};
+
+    /// Names of the reported quantiles
+    static constexpr std::array<char const *, 3> QUANTILE_NAMES = {"p50", "p90", "p99"};
+
+    /// Number of bins in the histogram of interval consumption
+    static constexpr int HISTOGRAM_BINS = 10;
+
+    /// One bin of a histogram
+    struct Bin {
+        double from  = 0.0; ///< Lower bound kWh
+        double to    = 0.0; ///< Upper bound kWh
+        double count = 0.0; ///< Estimated number of intervals
+    };
+
+    /// Adds the record
+    /// @param[in] rec Consumption record
+    /// @param[in] price Price EUR/kWh or an empty value if there is no price for the record
+    void add(Record const &rec, std::optional<double> const &price = {});
+
+    /// Adds all the values from another distributions object
+    /// @param[in] other The other distributions
+    void merge(Distributions const &other);
+
+    /// Merges buffered values of the digests; call after the last record
+    void compress();
+
+    /// Returns distributions by the first day of the month
+    auto months() const noexcept -> auto const & { return _months; }
+
+    /// Returns distributions for the whole period
+    auto total() const noexcept -> auto const & { return _total; }
+
+    /// Returns the histogram of interval consumption with bins of equal width
+    /// @param[in] bins Number of bins
+    /// @return The histogram or an empty array if there are no records
+    auto histogram(int bins = HISTOGRAM_BINS) const -> QVector<Bin>;
+
+private:
+
+    std::map<QDate, Distribution> _months;
+    Distribution                  _total;
+};
+
+} // namespace El
+
+#endif // EL_DISTRIBUTION_H_INCLUDED
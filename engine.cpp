@@ -0,0 +1,138 @@
+#include "engine.h"
+#include "prices.h"
+#include "pricetable.h"
+#include "profile.h"
+#include "record.h"
+
+#include <QDateTime>
+#include <QEventLoop>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <utility>
+
+namespace El {
+
+Engine::Engine(Options options)
+    : _options(std::move(options))
+{}
+
+Engine::~Engine() = default;
+
+auto Engine::load_consumption(QString const &filename) const -> std::optional<Consumption>
+{
+    Consumption consumption{};
+    if (!consumption.load(filename, _options.time)) {
+        return {};
+    }
+    return consumption;
+}
+
+auto Engine::load_prices(QString const &region, QDateTime const &start, QDateTime const &end) -> bool
+{
+    // loaded prices are reused for the same region only
+    if (!_prices || region != _region) {
+        _prices = std::make_unique<Prices>(_options);
+        _region = region;
+    }
+
+    // prices from the cache or a file are loaded before load() returns
+    std::optional<bool> result{};
+    QEventLoop          loop{};
+    QObject::connect(_prices.get(), &Prices::loaded, &loop, [&result, &loop](bool ok) {
+        result = ok;
+        loop.quit();
+    });
+
+    _prices->load(region, start, end);
+    if (!result) {
+        loop.exec();
+    }
+
+    return result.value_or(false);
+}
+
+auto Engine::add_record(Summary &summary, Record const &rec, PriceTable const *table, Options const &options)
+    -> std::optional<double>
+{
+    if (table == nullptr) {
+        summary.add(rec);
+        return {};
+    }
+
+    auto const price = table->get_price(rec.startTime(), rec.endTime());
+    summary.add(rec, price, options.net_margin());
+    return price;
+}
+
+auto Engine::summarize(Consumption const &consumption) const -> Summary
+{
+    auto const table = _prices ? _prices->snapshot() : nullptr;
+    return summarize(consumption.records(), table.get(), _options);
+}
+
+auto Engine::summarize(QVector<Record> const &records,
+                       PriceTable const     *table,
+                       Options const        &options,
+                       Visitor const        &visit) -> Summary
+{
+    Profile::Scope const profile{"Engine::summarize"};
+
+    // partial totals of a chunk and the prices of its records for the visitor
+    struct Chunk {
+        qsizetype                      first = 0;
+        Summary                        summary;
+        QVector<std::optional<double>> prices;
+    };
+
+    auto const sum = [&records, table, &options, keep = static_cast<bool>(visit)](qsizetype first) {
+        Chunk      c{first, {}, {}};
+        auto const last = std::min(first + SUMMARIZE_CHUNK, records.size());
+        if (keep) {
+            c.prices.reserve(last - first);
+        }
+        for (auto i = first; i < last; ++i) {
+            auto const price = add_record(c.summary, records.at(i), table, options);
+            if (keep) {
+                c.prices.append(price);
+            }
+        }
+        return c;
+    };
+
+    QVector<qsizetype> starts{};
+    for (qsizetype i = 0; i < records.size(); i += SUMMARIZE_CHUNK) {
+        starts.append(i);
+    }
+
+    // totals are integers, so the partial totals add up to the same result as a sequential loop
+    auto const chunks =
+        starts.size() <= 1 ? QVector<Chunk>{sum(0)} : QtConcurrent::blockingMapped<QVector<Chunk>>(starts, sum);
+
+    // the visitor sees the records in order
+    Summary total{};
+    for (auto const &c : chunks) {
+        total = total + c.summary;
+        for (qsizetype i = 0; i < c.prices.size(); ++i) {
+            visit(records.at(c.first + i), c.prices.at(i));
+        }
+    }
+    return total;
+}
+
+auto Engine::calculate(QString const &filename) -> std::optional<Summary>
+{
+    auto const consumption = load_consumption(filename);
+    if (!consumption) {
+        return {};
+    }
+
+    if (_options.prices &&
+        !load_prices(_options.region(), consumption->first_record_time(), consumption->last_record_time())) {
+        return {};
+    }
+
+    return summarize(*consumption);
+}
+
+} // namespace El
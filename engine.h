@@ -0,0 +1,135 @@
+#pragma once
+
+#ifndef EL_ENGINE_H_INCLUDED
+#  define EL_ENGINE_H_INCLUDED
+
+#include "consumption.h"
+#include "options.h"
+#include "summary.h"
+
+#include <QString>
+#include <QVector>
+
+#include <functional>
+#include <memory>
+#include <optional>
+
+QT_FORWARD_DECLARE_CLASS(QDateTime)
+
+namespace El {
+
+class PriceTable;
+class Prices;
+class Record;
+
+/// Synchronous interface to the engine for programs that embed it
+///
+/// Runs the same stages as the command line tool: ingestion (`Consumption`), pricing (`Prices`
+/// with the price cache `Cache` and the Nord Pool service) and aggregation (`Summary`). The
+/// stages can also be used directly; this class only ties them together with one set of options.
+///
+/// Waiting for prices runs a local event loop, so the calling thread needs a `QCoreApplication`
+/// instance. One engine is used from one thread at a time; use one engine per thread to process
+/// several meters in parallel.
+class Engine {
+public:
+
+    /// Number of records summed by one task of `summarize()`
+    static constexpr qsizetype SUMMARIZE_CHUNK = 16 * 1024;
+
+    /// Function that is called for every record with its price EUR/kWh without taxes
+    using Visitor = std::function<void(Record const &rec, std::optional<double> const &price)>;
+
+    /// Prices the record and adds it to the totals
+    ///
+    /// This is the pricing stage of all the front ends: the price of the record is the average
+    /// price of its interval and the cost is calculated with the margin without VAT.
+    /// @param[in,out] summary Totals
+    /// @param[in] rec Consumption record
+    /// @param[in] table Prices or nullptr to sum only the consumption
+    /// @param[in] options Options with the margin and VAT
+    /// @return The price EUR/kWh without taxes or an empty value if the record has no price
+    static auto add_record(Summary &summary, Record const &rec, PriceTable const *table, Options const &options)
+        -> std::optional<double>;
+
+    /// Prices the records and calculates totals
+    ///
+    /// Long series are priced and summed in parallel chunks on the global thread pool; the result
+    /// is identical to summing the records one by one. The visitor is called after that in the
+    /// order of the records, so that output, peaks and distributions see the same prices as the
+    /// totals.
+    /// @param[in] records Consumption records
+    /// @param[in] table Prices or nullptr to sum only the consumption
+    /// @param[in] options Options with the margin and VAT
+    /// @param[in] visit Optional function that is called for every record with its price
+    /// @return Totals (costs without VAT)
+    static auto summarize(QVector<Record> const &records,
+                          PriceTable const     *table,
+                          Options const        &options,
+                          Visitor const        &visit = {}) -> Summary;
+
+    /// Ctor
+    /// @param[in] options Engine options
+    Engine(Options options);
+
+    /// Dtor
+    ~Engine();
+
+    /// Deleted move and copy operations; the stages refer to the options
+    Engine(Engine const &other)                     = delete;
+    Engine(Engine &&other)                          = delete;
+    auto operator=(Engine const &other) -> Engine & = delete;
+    auto operator=(Engine &&other) -> Engine &      = delete;
+
+    /// Returns the options
+    auto options() const noexcept -> auto const & { return _options; }
+
+    /// Loads consumption records from the CSV file
+    ///
+    /// Records ending after the time in the options are ignored.
+    /// @param[in] filename Name of the CSV file
+    /// @return Consumption records or an empty value on errors
+    auto load_consumption(QString const &filename) const -> std::optional<Consumption>;
+
+    /// Loads prices for the time period and waits until they are loaded
+    ///
+    /// Prices come from the price file in the options, from the cache or from Nord Pool.
+    /// @param[in] region Price region
+    /// @param[in] start Start time
+    /// @param[in] end End time
+    /// @return true if succeeded, otherwise false
+    auto load_prices(QString const &region, QDateTime const &start, QDateTime const &end) -> bool;
+
+    /// Returns the loaded prices or nullptr if prices are not loaded
+    auto prices() const noexcept -> Prices const * { return _prices.get(); }
+
+    /// Calculates totals for the records
+    ///
+    /// Costs are calculated with the loaded prices and the margin in the options; without
+    /// prices only the consumption is summed. Long series are summed in parallel on the global
+    /// thread pool; the result is identical to summing the records one by one.
+    /// @param[in] consumption Consumption records
+    /// @return Totals (costs without VAT)
+    auto summarize(Consumption const &consumption) const -> Summary;
+
+    /// Loads the CSV file, loads prices for its records if requested in the options and
+    /// calculates totals
+    /// @param[in] filename Name of the CSV file
+    /// @return Totals or an empty value on errors
+    auto calculate(QString const &filename) -> std::optional<Summary>;
+
+private:
+
+    /// Engine options
+    Options _options;
+
+    /// Region of the loaded prices
+    QString _region;
+
+    /// Loaded prices
+    std::unique_ptr<Prices> _prices;
+};
+
+} // namespace El
+
+#endif
@@ -7,6 +7,19 @@
 
 #include <fmt/format.h>
 
+namespace {
+
+/// Returns true if the header is a grid export or production field
+auto is_export(QString const &header) -> bool
+{
+    using namespace Qt::Literals::StringLiterals;
+
+    return header.contains(u"võrku"_s, Qt::CaseInsensitive) || header.contains(u"tootmine"_s, Qt::CaseInsensitive) ||
+           header.contains(u"toodang"_s, Qt::CaseInsensitive) || header.contains(u"eksport"_s, Qt::CaseInsensitive);
+}
+
+} // namespace
+
 namespace El {
 
 // -----------------------------------------------------------------------------
@@ -40,6 +53,9 @@ auto Header::process(QByteArray const &line) -> bool
         else if (_idx_end_time < 0 && header.contains(u"lõpp"_s, Qt::CaseInsensitive)) {
             _idx_end_time = idx;
         }
+        else if (is_export(header)) {
+            _channels.append({Channel::Type::Export, idx});
+        }
         else if (_idx_consumption < 0 &&
             (header.contains(u"tarbimine"_s, Qt::CaseInsensitive) ||
              header.contains(u"kogus"_s, Qt::CaseInsensitive) ||
@@ -55,6 +71,10 @@ auto Header::process(QByteArray const &line) -> bool
         ++idx;
     }
 
+    if (_idx_consumption >= 0) {
+        _channels.prepend({Channel::Type::Import, _idx_consumption});
+    }
+
     return _num_fields > 0 && _idx_start_time >= 0 && _idx_consumption >= 0;
 }
 
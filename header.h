@@ -3,12 +3,26 @@
 #ifndef EL_HEADER_H_INCLUDED
 #  define EL_HEADER_H_INCLUDED
 
+#include <QVector>
 #include <QtTypes>
 
 QT_FORWARD_DECLARE_CLASS(QByteArray)
 
 namespace El {
 
+/// Measurement channel of the CSV file
+struct Channel {
+
+    /// Direction of the energy
+    enum class Type {
+        Import, ///< Consumption from the grid
+        Export, ///< Production fed into the grid
+    };
+
+    Type      type = Type::Import; ///< Type of the channel
+    qsizetype idx  = -1;           ///< Index of the field
+};
+
 /// CSV file header information
 class Header {
 public:
@@ -47,6 +61,15 @@ public:
     /// Returns the index of the consumption type field (-1 if not used)
     auto idxConsumptionType() const noexcept { return _idx_consumption_type; }
 
+    /// Returns the measurement channels
+    ///
+    /// The consumption field is the only import channel; every field with grid export or
+    /// production ("võrku antud", "tootmine") is an export channel.
+    auto channels() const noexcept -> auto const & { return _channels; }
+
+    /// Returns true if there are export channels
+    auto hasExport() const noexcept { return _channels.size() > 1; }
+
 private:
 
     /// Validity flag
@@ -67,6 +90,9 @@ private:
     /// Index of the consumption type field
     qsizetype _idx_consumption_type = -1;
 
+    /// Measurement channels
+    QVector<Channel> _channels;
+
     /// Process the header line and initialize the fields
     /// @param[in] line Input line
     /// @returns true if succeeded; false if not
@@ -1,113 +1,518 @@
 #include "json.h"
 
-#include "args.h"
-
 #include <QByteArray>
+#include <QChar>
 #include <QDateTime>
-#include <QJsonArray>
-#include <QJsonDocument>
-#include <QJsonObject>
 #include <QString>
 
 #include <fmt/format.h>
 
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+namespace {
+
+/// Returns true if the character is JSON whitespace
+constexpr auto is_space(char c) -> bool
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/// Returns true if the character can be part of a JSON number
+constexpr auto is_number(char c) -> bool
+{
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+/// Parses a JSON number without copying it
+/// @param[in] text The number
+/// @param[out] value Set to the value of the number
+/// @return true if the whole text is a valid number
+auto to_number(std::string_view text, double &value) -> bool
+{
+    auto const *end    = text.data() + text.size();
+    auto const  result = std::from_chars(text.data(), end, value);
+    return result.ec == std::errc{} && result.ptr == end;
+}
+
+/// Returns the value of a hexadecimal digit or -1
+constexpr auto hex_value(char c) -> int
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10; // NOLINT(readability-magic-numbers)
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10; // NOLINT(readability-magic-numbers)
+    }
+    return -1;
+}
+
+/// Decodes escape sequences in a JSON string
+/// @param[in] s The string without quotes with at least one escape sequence
+/// @param[out] ok Set to false if the string has invalid escape sequences
+/// @return UTF-8 encoded string
+auto decode_string(std::string_view s, bool &ok) -> QByteArray
+{
+    ok = true;
+
+    QString     result{};
+    std::size_t run = 0;
+    std::size_t i   = 0;
+    while (i < s.size()) {
+        if (s[i] != '\\') {
+            ++i;
+            continue;
+        }
+
+        result.append(QString::fromUtf8(s.data() + run, static_cast<qsizetype>(i - run)));
+        if (i + 1 >= s.size()) {
+            ok = false;
+            return {};
+        }
+
+        auto const c = s[i + 1];
+        i += 2;
+        switch (c) {
+            case '"':  result.append(u'"'); break;
+            case '\\': result.append(u'\\'); break;
+            case '/':  result.append(u'/'); break;
+            case 'b':  result.append(u'\b'); break;
+            case 'f':  result.append(u'\f'); break;
+            case 'n':  result.append(u'\n'); break;
+            case 'r':  result.append(u'\r'); break;
+            case 't':  result.append(u'\t'); break;
+            case 'u': {
+                constexpr std::size_t HEX_DIGITS = 4;
+                if (i + HEX_DIGITS > s.size()) {
+                    ok = false;
+                    return {};
+                }
+                char16_t code = 0;
+                for (std::size_t d = 0; d < HEX_DIGITS; ++d) {
+                    auto const v = hex_value(s[i + d]);
+                    if (v < 0) {
+                        ok = false;
+                        return {};
+                    }
+                    code = static_cast<char16_t>((code << 4) | v);
+                }
+                i += HEX_DIGITS;
+                result.append(QChar{code});
+                break;
+            }
+            default: {
+                ok = false;
+                return {};
+            }
+        }
+        run = i;
+    }
+    result.append(QString::fromUtf8(s.data() + run, static_cast<qsizetype>(s.size() - run)));
+
+    return result.toUtf8();
+}
+
+} // namespace
+
 namespace El {
 
 // -----------------------------------------------------------------------------
 
-auto Json::from_json(QByteArray const &json, QString const &region, QDateTime const &end) -> Json
+auto Json::from_json(QByteArray const &json, QString const &region) -> Json
 {
-
-    Json me{};
-    me.parse(region, json, end);
+    Json me{region};
+    me.feed(json);
+    me.finish();
     return me;
 }
 
 // -----------------------------------------------------------------------------
 
-Json::Json() = default;
+Json::Json(QString region)
+    : _region(std::move(region))
+    , _region_utf8(_region.toUtf8())
+{}
 
-void Json::parse(QString const &region, QByteArray const &json, QDateTime const &end)
+void Json::feed(QByteArray const &data)
 {
-    using namespace Qt::Literals::StringLiterals;
+    if (_syntax_error) {
+        return;
+    }
+
+    if (_buffer.isEmpty()) {
+        _buffer = data;
+    }
+    else {
+        _buffer.append(data);
+    }
+    parse(false);
+}
 
-    // get the JSON object
-    auto const doc = QJsonDocument::fromJson(json);
-    if (!doc.isObject()) {
+void Json::finish()
+{
+    if (!_syntax_error) {
+        parse(true);
+    }
+
+    // check the document structure
+    if (_syntax_error || !_complete || _pos < _buffer.size()) {
         throw Exception{"Invalid JSON document"};
     }
-    auto const obj = doc.object();
 
     // check for success
-    auto const success = obj.value(u"success"_s);
-    if (!success.isBool()) {
+    if (_success != Status::Valid) {
         throw Exception{"Invalid or missing 'success' element"};
     }
-    if (!success.toBool(false)) {
+    if (!_success_value) {
         throw Exception{"The JSON document is not good ('success' element is false)"};
     }
 
     // get data
-    auto const data = obj.value(u"data"_s);
-    if (!data.isObject()) {
+    if (_data != Status::Valid) {
         throw Exception{"Invalid or missing 'data' element"};
     }
 
     // get prices for the region
-    auto const reg = data.toObject().value(region);
-    if (!reg.isArray()) {
-        throw Exception{fmt::format("Invalid or missing region '{}' element", region)};
+    if (_region_status != Status::Valid) {
+        throw Exception{fmt::format("Invalid or missing region '{}' element", _region)};
     }
-    auto const prices = reg.toArray();
 
-    // parse price records and store them in price blocks
-    auto const &args = Args::instance();
-    PriceBlock block{};
-    QDateTime last_time;
-    double last_price = 0.0;
-    for (auto const &el : prices) {
-        if (!el.isObject()) {
-            throw Exception{fmt::format("Invalid price element '{}'", el.toString())};
+    // check price elements
+    if (!_element_error.empty()) {
+        throw Exception{_element_error};
+    }
+
+    // prices that Nord Pool has not published yet are missing, not copies of the last price
+    PriceBuilder builder{};
+    for (auto const &[time_s, price] : std::as_const(_collected)) {
+        builder.add({QDateTime::fromSecsSinceEpoch(time_s), price});
+    }
+    _prices    = builder.finish();
+    _collected = {};
+}
+
+void Json::parse(bool final)
+{
+    while (next_token(final)) {
+    }
+
+    // drop processed input
+    if (_pos > 0) {
+        _buffer.remove(0, _pos);
+        _pos = 0;
+    }
+}
+
+auto Json::next_token(bool final) -> bool
+{
+    // skip whitespace
+    while (_pos < _buffer.size() && is_space(_buffer.at(_pos))) {
+        ++_pos;
+    }
+    if (_pos >= _buffer.size() || _syntax_error) {
+        return false;
+    }
+
+    // nothing is allowed after the document object
+    if (_complete) {
+        _syntax_error = true;
+        return false;
+    }
+
+    auto const c = _buffer.at(_pos);
+    switch (c) {
+
+        case '{':
+        case '[': {
+            ++_pos;
+            value(c == '{' ? Kind::Object : Kind::Array);
+            break;
+        }
+
+        case '}':
+        case ']': {
+            ++_pos;
+            close(c == '}');
+            break;
+        }
+
+        case ':': {
+            ++_pos;
+            if (_stack.isEmpty() || _stack.back().state != State::Colon) {
+                _syntax_error = true;
+                return false;
+            }
+            _stack.back().state = State::Value;
+            break;
+        }
+
+        case ',': {
+            ++_pos;
+            if (_stack.isEmpty() || _stack.back().state != State::Comma) {
+                _syntax_error = true;
+                return false;
+            }
+            _stack.back().state = _stack.back().object ? State::Key : State::Value;
+            break;
         }
-        auto const o = el.toObject();
-        auto price = Price::from_json(o);
 
-        // check for 1 hour intervals that Nord Pool is returning for prices before 2025-10-01
-        constexpr int SEC_IN_HOUR = 3'600;
-        if (!last_time.isNull() && last_time.addSecs(SEC_IN_HOUR) == price.time) {
+        case '"': {
+            // find the closing quote
+            auto end = _pos + 1;
+            while (end < _buffer.size() && _buffer.at(end) != '"') {
+                end += _buffer.at(end) == '\\' ? 2 : 1;
+            }
+            if (end >= _buffer.size()) {
+                // wait for the rest of the string
+                _syntax_error = final;
+                return false;
+            }
 
-            // we have a full hour, so fill in missing 15 minute intervals with the previous price
-            for (int i = 0; i < 3; ++i) {
-                last_time = last_time.addSecs(args.interval());
-                block.append({last_time, last_price});
+            std::string_view text{_buffer.constData() + _pos + 1, static_cast<std::size_t>(end - _pos - 1)};
+            _pos = end + 1;
+
+            // only strings with escape sequences are copied
+            QByteArray decoded{};
+            if (text.find('\\') != std::string_view::npos) {
+                bool ok = false;
+                decoded = decode_string(text, ok);
+                if (!ok) {
+                    _syntax_error = true;
+                    return false;
+                }
+                text = std::string_view{decoded.constData(), static_cast<std::size_t>(decoded.size())};
             }
+
+            // object keys
+            if (!_stack.isEmpty() && _stack.back().object && _stack.back().state == State::Key) {
+                auto &frame = _stack.back();
+                frame.key   = key(frame.role, text);
+                frame.state = State::Colon;
+                frame.empty = false;
+                break;
+            }
+
+            value(Kind::String, text);
+            break;
         }
-        last_time = price.time;
-        last_price = price.price;
 
-        // check for holes in the block
-        if (!block.empty() && block.end_time.addSecs(args.interval()) < price.time) {
-            // move the block to the price blocks array
-            _prices.append(std::move(block));
+        case 't':
+        case 'f':
+        case 'n': {
+            std::string_view const literal = c == 't' ? "true" : c == 'f' ? "false" : "null";
+            if (static_cast<std::size_t>(_buffer.size() - _pos) < literal.size()) {
+                // wait for the rest of the literal
+                _syntax_error = final;
+                return false;
+            }
+            if (std::string_view{_buffer.constData() + _pos, literal.size()} != literal) {
+                _syntax_error = true;
+                return false;
+            }
+            _pos += static_cast<qsizetype>(literal.size());
+            value(c == 't' ? Kind::True : c == 'f' ? Kind::False : Kind::Null);
+            break;
+        }
+
+        default: {
+            if (!is_number(c)) {
+                _syntax_error = true;
+                return false;
+            }
+
+            auto end = _pos + 1;
+            while (end < _buffer.size() && is_number(_buffer.at(end))) {
+                ++end;
+            }
+            if (end >= _buffer.size() && !final) {
+                // wait for the rest of the number
+                return false;
+            }
 
-            // block is now empty
+            // numbers are parsed in place
+            double number = 0.0;
+            if (!to_number({_buffer.constData() + _pos, static_cast<std::size_t>(end - _pos)}, number)) {
+                _syntax_error = true;
+                return false;
+            }
+            _pos = end;
+            value(Kind::Number, {}, number);
+            break;
         }
+    }
 
-        block.append(price);
+    return !_syntax_error;
+}
+
+void Json::value(Kind kind, std::string_view text, double number)
+{
+    bool const container = kind == Kind::Object || kind == Kind::Array;
+
+    // the document must be an object
+    if (_stack.isEmpty()) {
+        if (kind != Kind::Object) {
+            _syntax_error = true;
+            return;
+        }
+        _stack.append({Role::Root, true, true, State::Key, {}});
+        return;
+    }
+
+    auto &parent = _stack.back();
+    if (parent.state != State::Value) {
+        _syntax_error = true;
+        return;
     }
+    parent.state = State::Comma;
+    parent.empty = false;
+
+    // find out the role of the value
+    auto role = Role::Other;
+    switch (parent.role) {
+
+        case Role::Root: {
+            if (parent.key == Key::Success) {
+                _success       = (kind == Kind::True || kind == Kind::False) ? Status::Valid : Status::Invalid;
+                _success_value = kind == Kind::True;
+            }
+            else if (parent.key == Key::Data) {
+                _data = kind == Kind::Object ? Status::Valid : Status::Invalid;
+                if (kind == Kind::Object) {
+                    role = Role::Data;
+                }
+            }
+            break;
+        }
+
+        case Role::Data: {
+            if (parent.key == Key::Region) {
+                _region_status = kind == Kind::Array ? Status::Valid : Status::Invalid;
+                if (kind == Kind::Array) {
+                    role = Role::Region;
+                }
+            }
+            break;
+        }
+
+        case Role::Region: {
+            if (kind == Kind::Object) {
+                role           = Role::Element;
+                _has_timestamp = false;
+                _has_price     = false;
+            }
+            else if (_element_error.empty()) {
+                _element_error =
+                    fmt::format("Invalid price element '{}'", kind == Kind::String ? text : std::string_view{});
+            }
+            break;
+        }
+
+        case Role::Element: {
+            if (parent.key != Key::Timestamp && parent.key != Key::Price) {
+                break;
+            }
+
+            // strings with numbers are accepted too
+            auto const valid = kind == Kind::Number || (kind == Kind::String && to_number(text, number));
+            auto const error = kind == Kind::String && !valid ? std::string{text} : std::string{};
+            if (parent.key == Key::Timestamp) {
+                _has_timestamp  = true;
+                _timestamp_ok   = valid;
+                _timestamp      = valid ? std::llround(number) : 0;
+                _timestamp_text = error;
+            }
+            else {
+                _has_price  = true;
+                _price_ok   = valid;
+                _price      = number;
+                _price_text = error;
+            }
+            break;
+        }
 
-    // fill in missing prices up to 'end' time
-    if (!last_time.isNull()) {
-        while (last_time < end) {
-            last_time = last_time.addSecs(args.interval());
-            block.append({last_time, last_price});
+        case Role::Other: {
+            break;
         }
     }
 
-    // append the block if it has prices
-    if (!block.empty()) {
-        _prices.append(std::move(block));
+    if (container) {
+        _stack.append({role, kind == Kind::Object, true, kind == Kind::Object ? State::Key : State::Value, {}});
+    }
+}
+
+void Json::close(bool object)
+{
+    if (_stack.isEmpty() || _stack.back().object != object) {
+        _syntax_error = true;
+        return;
+    }
+
+    // empty objects and arrays can be closed right away, others after a value
+    auto const &frame = _stack.back();
+    auto const  state = object ? State::Key : State::Value;
+    if (frame.state != State::Comma && !(frame.empty && frame.state == state)) {
+        _syntax_error = true;
+        return;
+    }
+
+    if (frame.role == Role::Element) {
+        add_price();
     }
+
+    _stack.removeLast();
+    _complete = _stack.isEmpty();
+}
+
+auto Json::key(Role role, std::string_view name) const -> Key
+{
+    switch (role) {
+        case Role::Root:
+            return name == "success" ? Key::Success : name == "data" ? Key::Data : Key::Other;
+        case Role::Data:
+            return name == std::string_view{_region_utf8.constData(), static_cast<std::size_t>(_region_utf8.size())}
+                       ? Key::Region
+                       : Key::Other;
+        case Role::Element:
+            return name == "timestamp" ? Key::Timestamp : name == "price" ? Key::Price : Key::Other;
+        default:
+            return Key::Other;
+    }
+}
+
+void Json::add_price()
+{
+    if (!_element_error.empty()) {
+        return;
+    }
+
+    // timestamp as seconds since the EPOCH
+    if (!_has_timestamp) {
+        _element_error = "Missing 'timestamp' element";
+        return;
+    }
+    if (!_timestamp_ok) {
+        _element_error = fmt::format("Invalid 'timestamp' element value '{}'", _timestamp_text);
+        return;
+    }
+
+    // price EUR/MWh
+    if (!_has_price) {
+        _element_error = "Missing 'price' element";
+        return;
+    }
+    if (!_price_ok) {
+        _element_error = fmt::format("Invalid 'price' element value '{}'", _price_text);
+        return;
+    }
+
+    _collected.append({_timestamp, _price});
 }
 
 } // namespace El
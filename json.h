@@ -5,47 +5,169 @@
 
 #include "common.h"
 
-#include <QtGlobal>
+#include <QByteArray>
+#include <QDateTime>
+#include <QString>
+#include <QVector>
 
-QT_FORWARD_DECLARE_CLASS(QByteArray)
-QT_FORWARD_DECLARE_CLASS(QDateTime)
-QT_FORWARD_DECLARE_CLASS(QString)
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
 
 namespace El {
 
-/// Helper class for parsing JSON documents with Nord Pool price records
+/// Streaming parser for JSON documents with Nord Pool price records
+///
+/// The document is parsed incrementally as its parts arrive. Only the `success` element and
+/// `timestamp`/`price` pairs of the requested region are extracted; everything else is skipped
+/// without building a DOM.
 class Json {
 public:
 
     /// Parses the JSON document and returns a JSON class instance with prices
     /// @param[in] json JSON document
     /// @param[in] region price region
-    /// @param[in] end end time for the requested prices
     /// @return Json class instance with prices
     /// @throws Exception on errors
-    static auto from_json(QByteArray const &json, QString const &region, QDateTime const &end) -> Json;
+    static auto from_json(QByteArray const &json, QString const &region) -> Json;
+
+    /// Ctor
+    /// @param[in] region price region
+    explicit Json(QString region);
 
     /// Dtor
     ~Json() = default;
 
+    /// Default move and copy operations
+    Json(Json const &other)                     = default;
+    Json(Json &&other)                          = default;
+    auto operator=(Json const &rhs) -> Json &   = default;
+    auto operator=(Json &&rhs) -> Json &        = default;
+
+    /// Parses the next part of the JSON document
+    ///
+    /// Errors are reported by `finish()`.
+    /// @param[in] data Next part of the document
+    void feed(QByteArray const &data);
+
+    /// Finishes parsing the JSON document
+    /// @throws Exception on errors
+    void finish();
+
     /// Returns price blocks
     auto prices() const noexcept -> auto const & { return _prices; }
 
 private:
 
+    /// Kind of a JSON value
+    enum class Kind : std::uint8_t { Object, Array, String, Number, True, False, Null };
+
+    /// Role of a JSON object or array in the document
+    enum class Role : std::uint8_t {
+        Root,    ///< The document object
+        Data,    ///< The `data` object
+        Region,  ///< Array with prices of the requested region
+        Element, ///< Price element
+        Other    ///< Skipped
+    };
+
+    /// Parser state within an object or array
+    enum class State : std::uint8_t { Key, Colon, Value, Comma };
+
+    /// Status of a required element
+    enum class Status : std::uint8_t { Missing, Invalid, Valid };
+
+    /// Keys that are interesting in objects with the role
+    enum class Key : std::uint8_t { Other, Success, Data, Region, Timestamp, Price };
+
+    /// Object or array that is being parsed
+    struct Frame {
+        Role  role   = Role::Other;
+        bool  object = false;
+        bool  empty  = true;
+        State state  = State::Value;
+        Key   key    = Key::Other; ///< The last key in objects
+    };
+
+    /// price region
+    QString _region;
+
+    /// price region as a UTF-8 encoded key
+    QByteArray _region_utf8;
+
+    /// Unprocessed input
+    QByteArray _buffer;
+
+    /// Position of the first unprocessed byte in the buffer
+    qsizetype _pos = 0;
+
+    /// Objects and arrays that are being parsed
+    QVector<Frame> _stack;
+
+    /// Flag indicating that the document has a syntax error
+    bool _syntax_error = false;
+
+    /// Flag indicating that the document object is parsed
+    bool _complete = false;
+
+    /// Status and value of the `success` element
+    Status _success       = Status::Missing;
+    bool   _success_value = false;
+
+    /// Status of the `data` element
+    Status _data = Status::Missing;
+
+    /// Status of the region element
+    Status _region_status = Status::Missing;
+
+    /// Values of the current price element; the text of an invalid string value is kept for
+    /// the error message
+    bool        _has_timestamp = false;
+    bool        _timestamp_ok  = false;
+    qint64      _timestamp     = 0;
+    std::string _timestamp_text;
+    bool        _has_price = false;
+    bool        _price_ok  = false;
+    double      _price     = 0.0;
+    std::string _price_text;
+
+    /// The first error in price elements
+    std::string _element_error;
+
+    /// Collected prices as seconds since the EPOCH and EUR/MWh; converted to price blocks by
+    /// `finish()`
+    QVector<std::pair<qint64, double>> _collected;
+
     /// price blocks
     PriceBlocks _prices;
 
-    /// Private ctor
-    Json();
+    /// Processes tokens in the buffer
+    /// @param[in] final true if there is no more input
+    void parse(bool final);
 
-    /// Parses the JSON document
-    /// @param[in] region region
-    /// @param[in] json JSON document
-    /// @param[in] end end time for the requested prices
-    /// @throws Exception on errors
-    void parse(QString const &region, QByteArray const &json, QDateTime const &end);
+    /// Processes the next token in the buffer
+    /// @param[in] final true if there is no more input
+    /// @return false if more input is needed or there was a syntax error
+    auto next_token(bool final) -> bool;
+
+    /// Processes the start of a value
+    /// @param[in] kind Kind of the value
+    /// @param[in] text Value of a string (decoded); only valid during the call
+    /// @param[in] number Value of a number
+    void value(Kind kind, std::string_view text = {}, double number = 0.0);
+
+    /// Returns the key in an object with the role
+    /// @param[in] role Role of the object
+    /// @param[in] name Name of the key (decoded)
+    auto key(Role role, std::string_view name) const -> Key;
+
+    /// Processes the end of an object or array
+    /// @param[in] object true for an object, false for an array
+    void close(bool object);
 
+    /// Validates the current price element and adds its price
+    void add_price();
 };
 
 } // namespace El
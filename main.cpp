@@ -5,11 +5,12 @@
 
 auto main(int argc, char *argv[]) -> int
 {
-    if (!El::Args::instance().init(argc, argv)) {
+    El::Args args{};
+    if (!args.init(argc, argv)) {
         return EXIT_FAILURE;
     }
 
     // Create and run the application
-    El::App app{argc, argv};
+    El::App app{argc, argv, args.options()};
     return El::App::exec();
 }
@@ -0,0 +1,78 @@
+#pragma once
+
+#ifndef EL_MONEY_H_INCLUDED
+#  define EL_MONEY_H_INCLUDED
+
+#include <QtGlobal>
+
+#include <cmath>
+
+namespace El {
+
+/// Energy in Wh
+///
+/// Elering reports consumption in kWh with three decimals, so Wh are exact.
+using Wh = qint64;
+
+/// Money in units of 1e-8 EUR
+///
+/// The cost of every record is rounded once to whole units with `llround()`; prices with the
+/// margin or averaged from hourly prices have more decimals and their costs are not exact. Totals
+/// are sums of these integers that do not depend on the order of the additions, so that partial
+/// totals calculated in parallel add up to exactly the same result as a sequential loop.
+using Money = qint64;
+
+/// Number of Wh in one kWh
+constexpr double WH_IN_KWH = 1000.0;
+
+/// Number of money units in one EUR
+constexpr double UNITS_IN_EUR = 1e8;
+
+// Rounding rules: every conversion from floating point rounds to the nearest integer, halfway
+// cases away from zero, and happens once per record or once per total.
+
+/// Converts kWh to Wh
+/// @param[in] kwh Energy kWh
+/// @return Energy Wh
+inline auto to_wh(double kwh) -> Wh
+{
+    return std::llround(kwh * WH_IN_KWH);
+}
+
+/// Converts Wh to kWh
+/// @param[in] wh Energy Wh
+/// @return Energy kWh
+constexpr auto to_kwh(Wh wh) -> double
+{
+    return static_cast<double>(wh) / WH_IN_KWH;
+}
+
+/// Returns the cost of the energy at the price
+/// @param[in] eur_per_kwh Price EUR/kWh
+/// @param[in] wh Energy Wh
+/// @return Cost
+inline auto cost(double eur_per_kwh, Wh wh) -> Money
+{
+    return std::llround(eur_per_kwh * static_cast<double>(wh) * (UNITS_IN_EUR / WH_IN_KWH));
+}
+
+/// Returns the amount with VAT
+/// @param[in] amount Amount without VAT
+/// @param[in] km VAT, 0.24 for 24%
+/// @return Amount with VAT
+inline auto with_vat(Money amount, double km) -> Money
+{
+    return std::llround(static_cast<double>(amount) * (1.0 + km));
+}
+
+/// Converts money units to EUR
+/// @param[in] amount Amount
+/// @return Amount EUR
+constexpr auto to_eur(Money amount) -> double
+{
+    return static_cast<double>(amount) / UNITS_IN_EUR;
+}
+
+} // namespace El
+
+#endif // EL_MONEY_H_INCLUDED
@@ -1,80 +1,354 @@
 #include "nordpool.h"
 
-#include "app.h"
-#include "args.h"
 #include "common.h"
 #include "json.h"
+#include "options.h"
+#include "profile.h"
 
 #include <QDateTime>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QNetworkRequest>
 #include <QStringLiteral>
+#include <QTimer>
 #include <QUrl>
 
 #include <fmt/format.h>
 
+#include <algorithm>
+#include <memory>
+
+namespace {
+
+/// Transfer timeout of one network request
+constexpr int MAX_TIME_MS = 5000;
+
+/// Returns true if the request failed with an error that may go away when it is repeated
+///
+/// Timeouts, connection errors, server errors (5xx) and rate limiting (429) are transient; other
+/// HTTP errors like 400, 401 and 404 fail the same way every time.
+auto is_transient(QNetworkReply const *reply) -> bool
+{
+    constexpr int HTTP_BAD_REQUEST       = 400;
+    constexpr int HTTP_TOO_MANY_REQUESTS = 429;
+    constexpr int HTTP_SERVER_ERROR      = 500;
+
+    auto const status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
+    if (status.isValid() && status.toInt() >= HTTP_BAD_REQUEST) {
+        return status.toInt() == HTTP_TOO_MANY_REQUESTS || status.toInt() >= HTTP_SERVER_ERROR;
+    }
+
+    switch (reply->error()) {
+        case QNetworkReply::ConnectionRefusedError:
+        case QNetworkReply::RemoteHostClosedError:
+        case QNetworkReply::HostNotFoundError:
+        case QNetworkReply::TimeoutError:
+        case QNetworkReply::OperationCanceledError:
+        case QNetworkReply::TemporaryNetworkFailureError:
+        case QNetworkReply::NetworkSessionFailedError:
+        case QNetworkReply::UnknownNetworkError:
+        case QNetworkReply::ProxyConnectionRefusedError:
+        case QNetworkReply::ProxyConnectionClosedError:
+        case QNetworkReply::ProxyTimeoutError:
+        case QNetworkReply::ProxyNotFoundError:
+        case QNetworkReply::InternalServerError:
+        case QNetworkReply::ServiceUnavailableError:
+        case QNetworkReply::UnknownServerError:
+            return true;
+        default:
+            return false;
+    }
+}
+
+} // namespace
+
 namespace El {
 
 // -----------------------------------------------------------------------------
 
-NordPool::NordPool(App const &app, QObject *parent)
+NordPool::NordPool(Options const &options, QObject *parent)
     : QObject(parent)
-    , _app(app)
+    , _options(options)
 {}
 
 NordPool::~NordPool() = default;
 
-auto NordPool::get_prices(QString const &region, QDateTime const &start, QDateTime const &end) -> PriceBlocks
+void NordPool::get_prices(QString const &region, QVector<TimePair> const &periods, Handler const &handler)
 {
-    using namespace Qt::Literals::StringLiterals;
+    QVector<Request> requests{};
+    for (auto const &period : plan_requests(periods)) {
+        requests.append({period, 0, {}, {}, -1});
+    }
 
-    constexpr char const *URL = "https://dashboard.elering.ee";
+    if (_options.verbose && requests.size() != periods.size()) {
+        fmt::print("Küsin {} puuduvat perioodi {} päringuga\n", periods.size(), requests.size());
+    }
 
-    fmt::print("Küsin võrgust Nord Pool hindasid perioodile {} ... {}\n", start, end);
+    _phase = "NordPool::get_prices";
+    start(region, std::move(requests), handler);
+}
 
-    // create the network access manager if needed
+void NordPool::revalidate(QString const &region,
+                          TimePair const &period,
+                          Validator const &validator,
+                          Handler const &handler)
+{
+    _phase = "NordPool::revalidate";
+    start(region, {{period, 0, validator, {}, -1}}, handler);
+}
+
+void NordPool::start(QString const &region, QVector<Request> &&requests, Handler const &handler)
+{
+    // create the network access manager if needed; the same manager keeps connections open
+    // between requests and asks for compressed responses that are decompressed as they arrive
     if (_manager == nullptr) {
         _manager = new QNetworkAccessManager{this};
-        connect(_manager, &QNetworkAccessManager::finished, this, [this](QNetworkReply *) { _done = true; });
+        connect(_manager, &QNetworkAccessManager::finished, this, &NordPool::finished);
+
+        _timer = new QTimer{this};
+        _timer->setSingleShot(true);
+        connect(_timer, &QTimer::timeout, this, &NordPool::timeout);
+    }
+
+    _region   = region;
+    _pending  = std::move(requests);
+    _total    = static_cast<int>(_pending.size());
+    _handler  = handler;
+    _retrying = 0;
+    _error.clear();
+    _busy    = true;
+    _started = Profile::start();
+
+    // every request times out on its own, so this is just a safety net
+    constexpr int MAX_RETRY_TIME_MS = (MAX_TIME_MS + (RETRY_DELAY_MS << MAX_RETRIES)) * (MAX_RETRIES + 1);
+    _timer->start(MAX_RETRY_TIME_MS * (_total / MAX_PARALLEL + 1));
+
+    start_requests();
+}
+
+void NordPool::timeout()
+{
+    using namespace Qt::Literals::StringLiterals;
+
+    if (_error.isEmpty()) {
+        _error = u"võrgupäring aegus"_s;
+    }
+
+    // aborted requests finish with an error and the `done()` signal is emitted after the last one
+    for (auto *reply : _running.keys()) {
+        reply->abort();
+    }
+
+    finish_if_done();
+}
+
+void NordPool::finish_if_done()
+{
+    if (!_busy || !_pending.isEmpty() || !_running.isEmpty() || _retrying != 0) {
+        return;
+    }
+
+    _busy = false;
+    _timer->stop();
+    _handler = nullptr;
+
+    if (_started >= 0) {
+        Profile::add(_phase, _started, QStringLiteral("%1 päringut").arg(_total), true);
+    }
+
+    emit done(_error);
+}
+
+auto NordPool::plan_requests(QVector<TimePair> const &periods) -> QVector<TimePair>
+{
+    // coalesce periods with small gaps between them
+    QVector<TimePair> coalesced{};
+    for (auto const &period : periods) {
+        if (!coalesced.isEmpty() && coalesced.back().end.secsTo(period.start) < COALESCE_GAP_S) {
+            coalesced.back().end = std::max(coalesced.back().end, period.end);
+        }
+        else {
+            coalesced.append(period);
+        }
+    }
+
+    // split long periods into chunks; chunks end one price interval before the next chunk starts
+    // so that the last price of a chunk is not extended into the next chunk
+    QVector<TimePair> result{};
+    for (auto const &period : coalesced) {
+        auto start = period.start;
+        while (start <= period.end) {
+            auto const next = start.addDays(MAX_CHUNK_DAYS);
+            if (next > period.end) {
+                result.append({start, period.end});
+                break;
+            }
+            result.append({start, next.addSecs(-INTERVAL_S)});
+            start = next;
+        }
+    }
+
+    return result;
+}
+
+void NordPool::start_requests()
+{
+    while (_error.isEmpty() && !_pending.isEmpty() && _running.size() < MAX_PARALLEL) {
+        start_request(_pending.takeFirst());
+    }
+
+    // do not start new requests after a failure
+    if (!_error.isEmpty()) {
+        _pending.clear();
+    }
+
+    finish_if_done();
+}
+
+auto NordPool::retry_request(Request const &rqst) -> bool
+{
+    if (rqst.attempt >= MAX_RETRIES || !_error.isEmpty()) {
+        return false;
+    }
+
+    auto const delay_ms = RETRY_DELAY_MS << rqst.attempt;
+    if (_options.verbose) {
+        fmt::print("Kordan päringut perioodile {} ... {} {} ms pärast\n", rqst.period.start, rqst.period.end, delay_ms);
+    }
+
+    ++_retrying;
+    QTimer::singleShot(delay_ms, this, [this, rqst]() {
+        --_retrying;
+        if (_error.isEmpty()) {
+            start_request({rqst.period, rqst.attempt + 1, rqst.validator, {}, -1});
+        }
+        start_requests();
+    });
+
+    return true;
+}
+
+void NordPool::start_request(Request const &rqst)
+{
+    using namespace Qt::Literals::StringLiterals;
+
+    auto const &period = rqst.period;
+    if (rqst.attempt == 0) {
+        fmt::print("Küsin võrgust Nord Pool hindasid perioodile {} ... {}\n", period.start, period.end);
     }
 
     // prepare the request
     auto const query = QStringLiteral(u"%1/api/nps/price?start=%2&end=%3")
-                           .arg(URL,
-                                start.toUTC().toString(u"yyyy-MM-ddThh\'\%3A\'mm\'\%3A\'ss.zzzZ"_s),
-                                end.toUTC().toString(u"yyyy-MM-ddThh\'\%3A\'mm\'\%3A\'ss.zzzZ"_s));
-    if (Args::instance().verbose()) {
+                           .arg(_options.url,
+                                period.start.toUTC().toString(u"yyyy-MM-ddThh\'\%3A\'mm\'\%3A\'ss.zzzZ"_s),
+                                period.end.toUTC().toString(u"yyyy-MM-ddThh\'\%3A\'mm\'\%3A\'ss.zzzZ"_s));
+    if (_options.verbose) {
         fmt::print("GET {}\n", query);
     }
 
-    QNetworkRequest rqst{};
-    rqst.setUrl(QUrl{query});
-    rqst.setRawHeader("accept", "*/*");
+    QNetworkRequest request{};
+    request.setUrl(QUrl{query});
+    request.setRawHeader("accept", "*/*");
+    request.setTransferTimeout(MAX_TIME_MS);
 
-    _done       = false;
-    auto *reply = _manager->get(rqst);
-    if (reply == nullptr) {
-        throw Exception{"võrgupäring ebaõnnestus"};
+    // conditional request
+    if (!rqst.validator.etag.isEmpty()) {
+        request.setRawHeader("If-None-Match", rqst.validator.etag);
     }
-
-    // wait for the results
-    constexpr int MAX_TIME_MS = 5000;
-    if (!App::wait_for(_done, MAX_TIME_MS)) {
-        throw Exception{"võrgupäring aegus"};
+    if (!rqst.validator.last_modified.isEmpty()) {
+        request.setRawHeader("If-Modified-Since", rqst.validator.last_modified);
     }
 
-    // check for errors
-    if (reply->error() != QNetworkReply::NoError) {
-        throw Exception{fmt::format("võrgupäring ebaõnnestus: {}", reply->errorString())};
+    auto *reply = _manager->get(request);
+    if (reply == nullptr) {
+        _error = u"võrgupäring ebaõnnestus"_s;
+        return;
     }
 
-    auto prices = Json::from_json(reply->readAll(), region, end);
+    Profile::count(Profile::Counter::Requests);
+
+    // parse the response as it arrives
+    auto running    = rqst;
+    running.json    = std::make_shared<Json>(_region);
+    running.started = Profile::start();
+    connect(reply, &QNetworkReply::readyRead, this, [this, reply]() {
+        auto const it = _running.constFind(reply);
+        if (it != _running.cend() && reply->error() == QNetworkReply::NoError) {
+            auto const data = reply->readAll();
+            Profile::count(Profile::Counter::BytesDecoded, data.size());
+            it->json->feed(data);
+        }
+    });
+
+    // the reply is decompressed; download progress is reported in the bytes transferred
+    connect(reply, &QNetworkReply::downloadProgress, this, [received = qint64{0}](qint64 bytes, qint64) mutable {
+        Profile::count(Profile::Counter::BytesDownloaded, bytes - received);
+        received = bytes;
+    });
+
+    _running.insert(reply, running);
+}
+
+void NordPool::finished(QNetworkReply *reply)
+{
+    using namespace Qt::Literals::StringLiterals;
 
     // delete the reply
     reply->deleteLater();
 
-    return prices.prices();
+    auto const it = _running.constFind(reply);
+    if (it == _running.cend()) {
+        return;
+    }
+    auto const rqst   = it.value();
+    auto const period = rqst.period;
+    _running.erase(it);
+
+    if (rqst.started >= 0) {
+        auto const detail = QStringLiteral("%1 ... %2").arg(period.start.toString(Qt::ISODate),
+                                                            period.end.toString(Qt::ISODate));
+        Profile::add("NordPool request", rqst.started, detail, true);
+    }
+
+    // check for errors; only transient errors are retried
+    if (reply->error() != QNetworkReply::NoError && is_transient(reply) && retry_request(rqst)) {
+        // will be retried
+    }
+    else if (reply->error() == QNetworkReply::OperationCanceledError || reply->error() == QNetworkReply::TimeoutError) {
+        if (_error.isEmpty()) {
+            _error = u"võrgupäring aegus"_s;
+        }
+    }
+    else if (reply->error() != QNetworkReply::NoError) {
+        if (_error.isEmpty()) {
+            _error = u"võrgupäring ebaõnnestus: %1"_s.arg(reply->errorString());
+        }
+    }
+    else if (_error.isEmpty()) {
+        constexpr int HTTP_NOT_MODIFIED = 304;
+        try {
+            Response response{period, {}, {reply->rawHeader("ETag"), reply->rawHeader("Last-Modified")}, true};
+            if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == HTTP_NOT_MODIFIED) {
+                response.modified = false;
+            }
+            else {
+                auto const data = reply->readAll();
+                Profile::count(Profile::Counter::BytesDecoded, data.size());
+                rqst.json->feed(data);
+                rqst.json->finish();
+                response.prices = rqst.json->prices();
+            }
+
+            if (_handler) {
+                _handler(std::move(response));
+            }
+        }
+        catch (Exception const &ex) {
+            _error = QString::fromUtf8(ex.what());
+        }
+    }
+
+    start_requests();
 }
 
 } // namespace El
@@ -5,16 +5,23 @@
 
 #include "common.h"
 
+#include <QHash>
 #include <QObject>
+#include <QString>
 #include <QVector>
 
+#include <functional>
+#include <memory>
+
 QT_FORWARD_DECLARE_CLASS(QDateTime)
 QT_FORWARD_DECLARE_CLASS(QNetworkAccessManager)
 QT_FORWARD_DECLARE_CLASS(QNetworkReply)
+QT_FORWARD_DECLARE_CLASS(QTimer)
 
 namespace El {
 
-class App;
+class Json;
+struct Options;
 
 /// Class that queries Nord Pool prices over the network
 class NordPool : public QObject {
@@ -22,33 +29,152 @@ class NordPool : public QObject {
 
 public:
 
+    /// Prices received for one requested period
+    struct Response {
+        TimePair    period;          ///< Requested period
+        PriceBlocks prices;          ///< Received prices (empty if not modified)
+        Validator   validator;       ///< HTTP cache validators of the response
+        bool        modified = true; ///< False if the server responded with 304 Not Modified
+    };
+
+    /// Handler that is called with the prices of every finished request
+    using Handler = std::function<void(Response &&response)>;
+
+    /// Maximum number of concurrent requests
+    static constexpr int MAX_PARALLEL = 4;
+
+    /// Maximum length of the period in one request
+    static constexpr int MAX_CHUNK_DAYS = 31;
+
+    /// Holes closer to each other than this are requested together
+    static constexpr int COALESCE_GAP_S = 24 * 60 * 60;
+
+    /// Maximum number of retries for a failed request
+    static constexpr int MAX_RETRIES = 4;
+
+    /// Delay before the first retry; doubled for every following retry
+    static constexpr int RETRY_DELAY_MS = 500;
+
     /// Ctor
-    /// @param[in] app The application instance
+    /// @param[in] options Engine options
     /// @param[in] parent Optional parent
-    NordPool(App const &app, QObject *parent = nullptr);
+    NordPool(Options const &options, QObject *parent = nullptr);
 
     /// Dtor
     ~NordPool() override;
 
-    /// Request NordPool prices
+    /// Returns true if requests are running
+    auto busy() const noexcept { return _busy; }
+
+    /// Starts requesting NordPool prices for multiple periods concurrently
+    ///
+    /// Adjacent periods with small gaps are coalesced and long periods are split into chunks
+    /// of `MAX_CHUNK_DAYS`. At most `MAX_PARALLEL` requests are running at the same time and
+    /// failed requests are retried with an exponential backoff. The handler is called for every
+    /// chunk in the order in which the requests finish, so that finished chunks can be stored
+    /// even if some other chunk fails. The `done()` signal is emitted when all the requests
+    /// have finished.
     /// @param[in] region Price region
-    /// @param[in] start Start time
-    /// @param[in] end End time
-    /// @return Price blocks with NordPool prices
-    /// @throws El::Exception on errors
-    auto get_prices(QString const &region, QDateTime const &start, QDateTime const &end) -> PriceBlocks;
+    /// @param[in] periods Time periods
+    /// @param[in] handler Handler for the prices of each period
+    void get_prices(QString const &region, QVector<TimePair> const &periods, Handler const &handler);
+
+    /// Starts a conditional request for prices that may have changed since they were received
+    ///
+    /// The handler is called with `modified` set to false if the prices have not changed.
+    /// The `done()` signal is emitted when the request has finished.
+    /// @param[in] region Price region
+    /// @param[in] period Time period
+    /// @param[in] validator HTTP cache validators of the previous response for the same period
+    /// @param[in] handler Handler for the prices
+    void revalidate(QString const &region, TimePair const &period, Validator const &validator, Handler const &handler);
+
+signals:
+
+    /// Emitted when all the requests have finished
+    /// @param[in] error Error message of the first failed request; empty on success
+    void done(QString const &error);
 
 private:
 
-    /// Application instance
-    App const &_app;
+    /// Engine options
+    Options const &_options;
 
     /// Network access manager
     QNetworkAccessManager *_manager = nullptr;
 
-    /// Flag indicating that network request is finished
-    bool _done = false;
+    /// Timer that aborts requests that are not finished in time
+    QTimer *_timer = nullptr;
+
+    /// Flag indicating that network requests are running
+    bool _busy = false;
+
+    /// Price region of the running requests
+    QString _region;
+
+    /// One request
+    struct Request {
+        TimePair              period;       ///< Requested period
+        int                   attempt = 0;  ///< Number of the attempt starting from 0
+        Validator             validator;    ///< Validators for a conditional request
+        std::shared_ptr<Json> json;         ///< Parser for the response
+        qint64                started = -1; ///< Start time for profiling
+    };
+
+    /// Requests waiting to be started
+    QVector<Request> _pending;
+
+    /// Number of periods requested
+    int _total = 0;
+
+    /// Running requests
+    QHash<QNetworkReply *, Request> _running;
+
+    /// Number of requests waiting for a retry
+    int _retrying = 0;
+
+    /// Handler for the prices of finished requests
+    Handler _handler;
+
+    /// Error message of the first failed request
+    QString _error;
+
+    /// Name of the profiled phase and its start time
+    char const *_phase   = "";
+    qint64      _started = -1;
+
+    /// Coalesces adjacent periods and splits long periods into chunks
+    /// @param[in] periods Time periods ordered by the start time
+    /// @return Time periods for network requests
+    static auto plan_requests(QVector<TimePair> const &periods) -> QVector<TimePair>;
+
+    /// Starts requests
+    /// @param[in] region Price region
+    /// @param[in] requests Requests
+    /// @param[in] handler Handler for the prices of each request
+    void start(QString const &region, QVector<Request> &&requests, Handler const &handler);
+
+    /// Starts pending requests up to the maximum number of concurrent requests
+    void start_requests();
+
+    /// Starts the network request
+    /// @param[in] rqst The request
+    void start_request(Request const &rqst);
+
+    /// Retries the failed request after a delay if retries are left
+    /// @param[in] rqst The request
+    /// @return true if the request will be retried, otherwise false
+    auto retry_request(Request const &rqst) -> bool;
+
+    /// Processes the finished network request
+    /// @param[in] reply Network reply
+    void finished(QNetworkReply *reply);
+
+    /// Aborts all the running requests
+    void timeout();
 
+    /// Emits the `done()` signal if all the requests have finished
+    void finish_if_done();
 };
 
 } // namespace El
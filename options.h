@@ -0,0 +1,80 @@
+#pragma once
+
+#ifndef EL_OPTIONS_H_INCLUDED
+#  define EL_OPTIONS_H_INCLUDED
+
+#include <QDateTime>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include <optional>
+
+namespace El {
+
+/// Settings of the engine
+///
+/// The command line tool fills these from its arguments (see `Args`), programs that embed the
+/// engine fill them directly. Every stage reads only the options given to its constructor, so
+/// that several differently configured instances can live in the same process. The options must
+/// outlive the objects that use them.
+struct Options {
+
+    /// Output formats
+    enum class Format {
+        Text,   ///< Human readable text
+        Csv,    ///< CSV with a header line
+        Ndjson, ///< One JSON object per line
+        Json,   ///< One JSON document
+    };
+
+    /// Default base URL of the Nord Pool price service
+    static constexpr char const *DEFAULT_URL = "https://dashboard.elering.ee";
+
+    /// Default number of days for which missing prices are fetched by the daemon
+    static constexpr int DEFAULT_PREFETCH_DAYS = 31;
+
+    /// Default number of peak intervals reported per month with `peaks`
+    static constexpr int DEFAULT_PEAK_TOP = 3;
+
+    /// Default name of the Chrome trace file written with `profile`
+    static constexpr char const *DEFAULT_TRACE_FILE = "elekter-trace.json";
+
+    bool                  verbose = false;                              ///< Print progress information
+    QString               file_name;                                    ///< CSV file with consumption records
+    bool                  prices = false;                               ///< Calculate costs with Nord Pool prices
+    QString               price_file_name;                              ///< JSON or CSV file or directory with prices
+    bool                  import_prices = false;                        ///< Store prices from the file in the cache
+    QStringList           regions       = {QStringLiteral("ee")};       ///< Price regions
+    bool                  prefetch      = false;                        ///< Run the prefetch daemon
+    int                   prefetch_days = DEFAULT_PREFETCH_DAYS;        ///< Days backfilled by the daemon
+    bool                  serve         = false;                        ///< Run the query server
+    QString               socket_name;                                  ///< Local socket; empty for the default
+    bool                  watch = false;                                ///< Update totals when files change
+    bool                  batch = false;                                ///< `file_name` is a manifest of meters
+    QString               url = QString::fromLatin1(DEFAULT_URL);       ///< Nord Pool price service
+    QString               cache_dir;                                    ///< Price cache; empty for the default
+    double                margin = 0.0;                                 ///< Margin EUR/kWh (with VAT if `km` is set)
+    std::optional<double> start_day;                                    ///< Initial day meter reading
+    std::optional<double> start_night;                                  ///< Initial night meter reading
+    QDateTime             time       = QDateTime::currentDateTime();    ///< Records ending later are ignored
+    bool                  fixed_time = false;                           ///< `time` was given explicitly
+    double                km         = 0.0;                             ///< VAT, 0.24 for 24%
+    Format                format     = Format::Text;                    ///< Output format
+    bool                  profile    = false;                           ///< Record phase timings and counters
+    QString               trace_file = QString::fromLatin1(DEFAULT_TRACE_FILE); ///< Chrome trace file
+    bool                  peaks      = false;                           ///< Analyze peak demand
+    bool                  distribution = false;                         ///< Quantiles and histograms
+    int                   peak_top   = DEFAULT_PEAK_TOP;                ///< Peak intervals per month
+    QList<int>            peak_windows = {15, 60, 24 * 60};             ///< Peak demand windows in minutes
+
+    /// Price region (the first one if multiple regions are given)
+    auto region() const -> QString { return regions.value(0, QStringLiteral("ee")); }
+
+    /// Margin EUR/kWh without VAT; the margin is given with VAT
+    auto net_margin() const noexcept { return margin / (1.0 + km); }
+};
+
+} // namespace El
+
+#endif // EL_OPTIONS_H_INCLUDED
@@ -0,0 +1,654 @@
+#include "output.h"
+#include "common.h" // IWYU pragma: keep Needed for formatting Qt types
+#include "distribution.h"
+#include "peaks.h"
+#include "record.h"
+#include "summary.h"
+
+#include <QDateTime>
+
+#include <fmt/base.h>
+
+#include <cmath>
+#include <iterator>
+
+namespace El {
+
+Output::Output(Options const &options, bool costs, std::FILE *file)
+    : _options(options)
+    , _format(options.format)
+    , _costs(costs)
+    , _file(file)
+{}
+
+Output::~Output()
+{
+    flush();
+}
+
+void Output::begin()
+{
+    if (_begun) {
+        return;
+    }
+    _begun = true;
+
+    switch (_format) {
+        case Options::Format::Csv: {
+            fmt::format_to(std::back_inserter(_buf), "row,start,end,zone,kwh,price,cost,meter\n");
+            break;
+        }
+        case Options::Format::Json: {
+            fmt::format_to(std::back_inserter(_buf), R"({{"records":[)");
+            break;
+        }
+        default: {
+            break;
+        }
+    }
+}
+
+void Output::record(Record const &rec, std::optional<double> const &price)
+{
+    // costs and revenues are rounded the same way as the totals (see `money.h`)
+    std::optional<double> price_vat{};
+    std::optional<double> paid{};
+    std::optional<double> revenue{};
+    if (price) {
+        price_vat = *price * (1.0 + _options.km);
+        paid      = to_eur(with_vat(cost(*price + _options.net_margin(), to_wh(rec.kWh())), _options.km));
+        revenue   = to_eur(cost(*price, to_wh(rec.exportedKWh())));
+    }
+
+    begin();
+    auto it = std::back_inserter(_buf);
+
+    switch (_format) {
+
+        case Options::Format::Text: {
+            if (!_costs) {
+                break;
+            }
+            if (!price) {
+                fmt::format_to(it, "WARNING: puudub hinnainfo ajale {}\n", rec.startTime());
+            }
+            else if (_options.verbose && rec.exportedKWh() != 0.0) {
+                fmt::format_to(it,
+                               "\t{}\t{:.3f} kWh\t{:.3f} EUR\t@{:.4f} EUR\teksport {:.3f} kWh\t{:.3f} EUR\n",
+                               rec.startTime(),
+                               rec.kWh(),
+                               *paid,
+                               *price_vat,
+                               rec.exportedKWh(),
+                               *revenue);
+            }
+            else if (_options.verbose) {
+                fmt::format_to(it, "\t{}\t{:.3f} kWh\t{:.3f} EUR\t@{:.4f} EUR\n", rec.startTime(), rec.kWh(), *paid, *price_vat);
+            }
+            break;
+        }
+
+        case Options::Format::Csv: {
+            fmt::format_to(it, "record,");
+            append_time(rec.startTime());
+            _buf.push_back(',');
+            append_time(rec.endTime());
+            fmt::format_to(it, ",{},{},", rec.isNight() ? "night" : "day", rec.kWh());
+            if (_costs) {
+                append_number(price_vat);
+                _buf.push_back(',');
+                append_number(paid);
+            }
+            else {
+                _buf.push_back(',');
+            }
+            fmt::format_to(it, ",\n");
+
+            // exported energy is a separate row with the price and revenue without VAT
+            if (rec.exportedKWh() != 0.0) {
+                fmt::format_to(it, "record,");
+                append_time(rec.startTime());
+                _buf.push_back(',');
+                append_time(rec.endTime());
+                fmt::format_to(it, ",export,{},", rec.exportedKWh());
+                if (_costs) {
+                    append_number(price);
+                    _buf.push_back(',');
+                    append_number(revenue);
+                }
+                else {
+                    _buf.push_back(',');
+                }
+                fmt::format_to(it, ",\n");
+            }
+            break;
+        }
+
+        case Options::Format::Ndjson:
+        case Options::Format::Json: {
+            if (_format == Options::Format::Json && _records > 0) {
+                _buf.push_back(',');
+            }
+            fmt::format_to(it, "{{");
+            if (_format == Options::Format::Ndjson) {
+                fmt::format_to(it, R"("row":"record",)");
+            }
+            fmt::format_to(it, R"("start":)");
+            append_time(rec.startTime());
+            fmt::format_to(it, R"(,"end":)");
+            append_time(rec.endTime());
+            fmt::format_to(it, R"(,"zone":"{}","kwh":{})", rec.isNight() ? "night" : "day", rec.kWh());
+            if (_costs) {
+                fmt::format_to(it, R"(,"price":)");
+                append_number(price_vat);
+                fmt::format_to(it, R"(,"cost":)");
+                append_number(paid);
+            }
+            if (rec.exportedKWh() != 0.0) {
+                fmt::format_to(it, R"(,"export_kwh":{})", rec.exportedKWh());
+                if (_costs) {
+                    fmt::format_to(it, R"(,"export_price":)");
+                    append_number(price);
+                    fmt::format_to(it, R"(,"revenue":)");
+                    append_number(revenue);
+                }
+            }
+            _buf.push_back('}');
+            if (_format == Options::Format::Ndjson) {
+                _buf.push_back('\n');
+            }
+            break;
+        }
+    }
+
+    ++_records;
+    flush_if_full();
+}
+
+void Output::summary(Summary const &s, QDateTime const &start, QDateTime const &end)
+{
+    // costs with VAT; VAT is applied once to the exact totals
+    auto const night_eur = to_eur(with_vat(s.night_cost, _options.km));
+    auto const day_eur   = to_eur(with_vat(s.day_cost, _options.km));
+    auto const total_eur = to_eur(with_vat(s.total_cost(), _options.km));
+
+    // export revenue is without VAT and the margin
+    auto const export_eur = to_eur(s.export_revenue);
+    auto const net_eur    = total_eur - export_eur;
+
+    begin();
+    auto it = std::back_inserter(_buf);
+
+    switch (_format) {
+
+        case Options::Format::Text: {
+            if (_options.start_day && _options.start_night) {
+                fmt::format_to(it,
+                               "arvesti näit\n\töö: {:10.3f}\tpäev: {:10.3f}\n",
+                               _options.start_night.value() + s.night_kwh(),
+                               _options.start_day.value() + s.day_kwh());
+            }
+            fmt::format_to(it,
+                           "kulu kWh\n\töö: {:10.3f} kWh\tpäev: {:10.3f} kWh\tkokku: {:10.3f} kWh\n",
+                           s.night_kwh(),
+                           s.day_kwh(),
+                           s.total_kwh());
+            if (_costs) {
+                fmt::format_to(it,
+                               "kulu EUR\n\töö: {:10.2f} EUR\tpäev: {:10.2f} EUR\tkokku: {:10.2f} EUR\n",
+                               night_eur,
+                               day_eur,
+                               total_eur);
+                fmt::format_to(it,
+                               "hind EUR/kWh\n\töö: {:6.4f} EUR/kWh\tpäev: {:6.4f} EUR/kWh\tkeskmine: {:6.4f} EUR/kWh\n",
+                               night_eur / s.night_kwh(),
+                               day_eur / s.day_kwh(),
+                               total_eur / s.total_kwh());
+            }
+            if (s.has_export()) {
+                fmt::format_to(it, "võrku antud\n\t{:10.3f} kWh", s.export_kwh());
+                if (_costs) {
+                    fmt::format_to(it, "\t{:10.2f} EUR\t{:6.4f} EUR/kWh", export_eur, export_eur / s.export_kwh());
+                }
+                fmt::format_to(it, "\nneto\n\t{:10.3f} kWh", s.net_kwh());
+                if (_costs) {
+                    fmt::format_to(it, "\t{:10.2f} EUR", net_eur);
+                }
+                _buf.push_back('\n');
+            }
+            break;
+        }
+
+        case Options::Format::Csv: {
+            auto row = [&](char const *zone, double kwh, double eur, std::optional<double> const &meter) {
+                fmt::format_to(it, "summary,");
+                append_time(start);
+                _buf.push_back(',');
+                append_time(end);
+                fmt::format_to(it, ",{},{},", zone, kwh);
+                if (_costs) {
+                    append_number(eur / kwh);
+                    _buf.push_back(',');
+                    append_number(eur);
+                }
+                else {
+                    _buf.push_back(',');
+                }
+                _buf.push_back(',');
+                append_number(meter);
+                _buf.push_back('\n');
+            };
+
+            auto const night_meter =
+                _options.start_night ? std::optional{*_options.start_night + s.night_kwh()} : std::nullopt;
+            auto const day_meter = _options.start_day ? std::optional{*_options.start_day + s.day_kwh()} : std::nullopt;
+            row("night", s.night_kwh(), night_eur, night_meter);
+            row("day", s.day_kwh(), day_eur, day_meter);
+            row("total", s.total_kwh(), total_eur, std::nullopt);
+            if (s.has_export()) {
+                row("export", s.export_kwh(), export_eur, std::nullopt);
+                row("net", s.net_kwh(), net_eur, std::nullopt);
+            }
+            break;
+        }
+
+        case Options::Format::Ndjson:
+        case Options::Format::Json: {
+            if (_format == Options::Format::Json) {
+                fmt::format_to(it, _records_closed ? R"(,"summary":)" : R"(],"summary":)");
+            }
+            fmt::format_to(it, "{{");
+            if (_format == Options::Format::Ndjson) {
+                fmt::format_to(it, R"("row":"summary",)");
+            }
+            fmt::format_to(it, R"("start":)");
+            append_time(start);
+            fmt::format_to(it, R"(,"end":)");
+            append_time(end);
+            fmt::format_to(it, R"(,"night":)");
+            append_zone(s.night_kwh(),
+                        night_eur,
+                        _options.start_night ? std::optional{*_options.start_night + s.night_kwh()} : std::nullopt);
+            fmt::format_to(it, R"(,"day":)");
+            append_zone(s.day_kwh(),
+                        day_eur,
+                        _options.start_day ? std::optional{*_options.start_day + s.day_kwh()} : std::nullopt);
+            fmt::format_to(it, R"(,"total":)");
+            append_zone(s.total_kwh(), total_eur, std::nullopt);
+            if (s.has_export()) {
+                fmt::format_to(it, R"(,"export":)");
+                append_zone(s.export_kwh(), export_eur, std::nullopt);
+                fmt::format_to(it, R"(,"net":)");
+                append_zone(s.net_kwh(), net_eur, std::nullopt);
+            }
+            fmt::format_to(it, R"(,"records":{})", s.records);
+            if (_costs) {
+                fmt::format_to(it, R"(,"missing_prices":{})", s.missing);
+            }
+            _buf.push_back('}');
+            if (_format == Options::Format::Json) {
+                _buf.push_back('}');
+            }
+            _buf.push_back('\n');
+            break;
+        }
+    }
+
+    flush();
+}
+
+void Output::peaks(Peaks const &p, QDateTime const &start, QDateTime const &end)
+{
+    auto const windows  = p.windows();
+    auto const peak_eur = to_eur(with_vat(p.peak_cost(), _options.km));
+
+    begin();
+    auto it = std::back_inserter(_buf);
+
+    switch (_format) {
+
+        case Options::Format::Text: {
+            fmt::format_to(it, "suurim keskmine võimsus\n");
+            for (auto const &w : windows) {
+                if (w.peak) {
+                    fmt::format_to(it, "\t{:5} min: {:10.3f} kW\t{} - {}\n", w.minutes, w.peak->kw, w.peak->start, w.peak->end);
+                }
+            }
+            if (!p.months().isEmpty()) {
+                fmt::format_to(it, "suurimad tipud\n");
+                for (auto const &m : p.months()) {
+                    for (auto const &i : m.top) {
+                        fmt::format_to(it, "\t{:04}-{:02}: {:10.3f} kW\t{}\n", m.month.year(), m.month.month(), i.kw, i.start);
+                    }
+                }
+            }
+            if (p.peak_records() > 0) {
+                fmt::format_to(it, "tipuaja kulu\n\ttipp: {:10.3f} kWh", p.peak_kwh());
+                if (_costs) {
+                    fmt::format_to(it, "\t{:10.2f} EUR\t{:6.4f} EUR/kWh", peak_eur, peak_eur / p.peak_kwh());
+                }
+                _buf.push_back('\n');
+            }
+            break;
+        }
+
+        case Options::Format::Csv: {
+            auto row = [&](char const *type, Peaks::Interval const &i, auto const &zone) {
+                fmt::format_to(it, "{},", type);
+                append_time(i.start);
+                _buf.push_back(',');
+                append_time(i.end);
+                fmt::format_to(it, ",{},{},,,\n", zone, i.kwh);
+            };
+
+            for (auto const &w : windows) {
+                if (w.peak) {
+                    row("peak", *w.peak, fmt::format("{}min", w.minutes));
+                }
+            }
+            for (auto const &m : p.months()) {
+                for (auto j = 0; j < m.top.size(); ++j) {
+                    row("top", m.top.at(j), j + 1);
+                }
+            }
+
+            fmt::format_to(it, "summary,");
+            append_time(start);
+            _buf.push_back(',');
+            append_time(end);
+            fmt::format_to(it, ",peak,{},", p.peak_kwh());
+            if (_costs) {
+                append_number(peak_eur / p.peak_kwh());
+                _buf.push_back(',');
+                append_number(peak_eur);
+            }
+            else {
+                _buf.push_back(',');
+            }
+            fmt::format_to(it, ",\n");
+            break;
+        }
+
+        case Options::Format::Ndjson:
+        case Options::Format::Json: {
+            auto interval = [&](Peaks::Interval const &i) {
+                fmt::format_to(it, R"({{"start":)");
+                append_time(i.start);
+                fmt::format_to(it, R"(,"end":)");
+                append_time(i.end);
+                fmt::format_to(it, R"(,"kwh":{},"kw":{}}})", i.kwh, i.kw);
+            };
+
+            if (_format == Options::Format::Json) {
+                fmt::format_to(it, _records_closed ? R"(,"peaks":{{)" : R"(],"peaks":{{)");
+                _records_closed = true;
+            }
+            else {
+                fmt::format_to(it, R"({{"row":"peaks",)");
+            }
+
+            fmt::format_to(it, R"("windows":[)");
+            for (auto i = 0; i < windows.size(); ++i) {
+                if (i > 0) {
+                    _buf.push_back(',');
+                }
+                fmt::format_to(it, R"({{"minutes":{},"peak":)", windows.at(i).minutes);
+                if (windows.at(i).peak) {
+                    interval(*windows.at(i).peak);
+                }
+                else {
+                    fmt::format_to(it, "null");
+                }
+                _buf.push_back('}');
+            }
+
+            fmt::format_to(it, R"(],"months":[)");
+            for (auto i = 0; i < p.months().size(); ++i) {
+                auto const &m = p.months().at(i);
+                if (i > 0) {
+                    _buf.push_back(',');
+                }
+                fmt::format_to(it, R"({{"month":"{:04}-{:02}","top":[)", m.month.year(), m.month.month());
+                for (auto j = 0; j < m.top.size(); ++j) {
+                    if (j > 0) {
+                        _buf.push_back(',');
+                    }
+                    interval(m.top.at(j));
+                }
+                fmt::format_to(it, "]}}");
+            }
+
+            fmt::format_to(it, R"(],"peak":)");
+            append_zone(p.peak_kwh(), peak_eur, std::nullopt);
+            _buf.push_back('}');
+            if (_format == Options::Format::Ndjson) {
+                _buf.push_back('\n');
+            }
+            break;
+        }
+    }
+
+    flush_if_full();
+}
+
+void Output::distributions(Distributions const &d, QDateTime const &start, QDateTime const &end)
+{
+    // prices with VAT
+    auto const vat       = 1.0 + _options.km;
+    auto const histogram = d.histogram();
+
+    begin();
+    auto it = std::back_inserter(_buf);
+
+    switch (_format) {
+
+        case Options::Format::Text: {
+            auto line = [&](char const *name, Distribution const &dist) {
+                fmt::format_to(it, "\t{}\tkWh:", name);
+                for (auto const q : Distributions::QUANTILES) {
+                    fmt::format_to(it, " {:8.3f}", dist.kwh.quantile(q));
+                }
+                if (_costs) {
+                    fmt::format_to(it, "\tEUR/kWh:");
+                    for (auto const q : Distributions::QUANTILES) {
+                        fmt::format_to(it, " {:7.4f}", dist.price.quantile(q) * vat);
+                    }
+                    fmt::format_to(it, "\tmakstud EUR/kWh:");
+                    for (auto const q : Distributions::QUANTILES) {
+                        fmt::format_to(it, " {:7.4f}", dist.paid.quantile(q) * vat);
+                    }
+                }
+                _buf.push_back('\n');
+            };
+
+            fmt::format_to(it, "jaotus (p50 / p90 / p99)\n");
+            for (auto const &[month, dist] : d.months()) {
+                line(fmt::format("{:04}-{:02}", month.year(), month.month()).c_str(), dist);
+            }
+            line("kokku  ", d.total());
+
+            if (!histogram.isEmpty()) {
+                fmt::format_to(it, "tarbimise histogramm\n");
+                for (auto const &bin : histogram) {
+                    fmt::format_to(it, "\t{:8.3f} - {:8.3f} kWh\t{:10.0f}\n", bin.from, bin.to, bin.count);
+                }
+            }
+            break;
+        }
+
+        case Options::Format::Csv: {
+            auto rows = [&](QDateTime const &from, QDateTime const &to, Distribution const &dist) {
+                for (size_t i = 0; i < Distributions::QUANTILES.size(); ++i) {
+                    auto const q = Distributions::QUANTILES.at(i);
+                    fmt::format_to(it, "quantile,");
+                    append_time(from);
+                    _buf.push_back(',');
+                    append_time(to);
+                    fmt::format_to(it, ",{},", Distributions::QUANTILE_NAMES.at(i));
+                    append_number(dist.kwh.quantile(q));
+                    _buf.push_back(',');
+                    if (_costs) {
+                        append_number(dist.price.quantile(q) * vat);
+                    }
+                    fmt::format_to(it, ",,\n");
+                    if (_costs) {
+                        fmt::format_to(it, "paid,");
+                        append_time(from);
+                        _buf.push_back(',');
+                        append_time(to);
+                        fmt::format_to(it, ",{},,", Distributions::QUANTILE_NAMES.at(i));
+                        append_number(dist.paid.quantile(q) * vat);
+                        fmt::format_to(it, ",,\n");
+                    }
+                }
+            };
+
+            for (auto const &[month, dist] : d.months()) {
+                auto const last = month.addMonths(1).addDays(-1);
+                rows(QDateTime{month, QTime{0, 0}}, QDateTime{last, QTime{23, 59}}, dist);
+            }
+            rows(start, end, d.total());
+
+            for (auto const &bin : histogram) {
+                fmt::format_to(it, "histogram,");
+                append_time(start);
+                _buf.push_back(',');
+                append_time(end);
+                fmt::format_to(it, ",{}-{},{},,,\n", bin.from, bin.to, bin.count);
+            }
+            break;
+        }
+
+        case Options::Format::Ndjson:
+        case Options::Format::Json: {
+            auto quantiles = [&](char const *name, Digest const &digest, double scale) {
+                fmt::format_to(it, R"("{}":{{)", name);
+                for (size_t i = 0; i < Distributions::QUANTILES.size(); ++i) {
+                    if (i > 0) {
+                        _buf.push_back(',');
+                    }
+                    fmt::format_to(it, R"("{}":)", Distributions::QUANTILE_NAMES.at(i));
+                    append_number(digest.quantile(Distributions::QUANTILES.at(i)) * scale);
+                }
+                _buf.push_back('}');
+            };
+            auto distribution = [&](Distribution const &dist) {
+                quantiles("kwh", dist.kwh, 1.0);
+                if (_costs) {
+                    _buf.push_back(',');
+                    quantiles("price", dist.price, vat);
+                    _buf.push_back(',');
+                    quantiles("paid", dist.paid, vat);
+                }
+            };
+
+            if (_format == Options::Format::Json) {
+                fmt::format_to(it, _records_closed ? R"(,"distribution":{{)" : R"(],"distribution":{{)");
+                _records_closed = true;
+            }
+            else {
+                fmt::format_to(it, R"({{"row":"distribution",)");
+            }
+
+            fmt::format_to(it, R"("months":[)");
+            auto first = true;
+            for (auto const &[month, dist] : d.months()) {
+                if (!first) {
+                    _buf.push_back(',');
+                }
+                first = false;
+                fmt::format_to(it, R"({{"month":"{:04}-{:02}",)", month.year(), month.month());
+                distribution(dist);
+                _buf.push_back('}');
+            }
+
+            fmt::format_to(it, R"(],"total":{{)");
+            distribution(d.total());
+            fmt::format_to(it, R"(}},"histogram":[)");
+            for (auto i = 0; i < histogram.size(); ++i) {
+                auto const &bin = histogram.at(i);
+                if (i > 0) {
+                    _buf.push_back(',');
+                }
+                fmt::format_to(it, R"({{"from":{},"to":{},"count":{}}})", bin.from, bin.to, bin.count);
+            }
+            fmt::format_to(it, "]}}");
+            if (_format == Options::Format::Ndjson) {
+                _buf.push_back('\n');
+            }
+            break;
+        }
+    }
+
+    flush_if_full();
+}
+
+void Output::append_zone(double kwh, double eur, std::optional<double> const &meter)
+{
+    auto it = std::back_inserter(_buf);
+
+    fmt::format_to(it, R"({{"kwh":{})", kwh);
+    if (_costs) {
+        fmt::format_to(it, R"(,"price":)");
+        append_number(eur / kwh);
+        fmt::format_to(it, R"(,"cost":)");
+        append_number(eur);
+    }
+    if (meter) {
+        fmt::format_to(it, R"(,"meter":{})", *meter);
+    }
+    _buf.push_back('}');
+}
+
+void Output::append_time(QDateTime const &time)
+{
+    // QDateTime::toString() is much slower than formatting the fields
+    auto const d     = time.date();
+    auto const t     = time.time();
+    auto const quote = _format == Options::Format::Ndjson || _format == Options::Format::Json;
+
+    if (quote) {
+        _buf.push_back('"');
+    }
+    fmt::format_to(std::back_inserter(_buf),
+                   "{:04}-{:02}-{:02}T{:02}:{:02}:{:02}",
+                   d.year(),
+                   d.month(),
+                   d.day(),
+                   t.hour(),
+                   t.minute(),
+                   t.second());
+    if (quote) {
+        _buf.push_back('"');
+    }
+}
+
+void Output::append_number(std::optional<double> const &value)
+{
+    auto const json = _format == Options::Format::Ndjson || _format == Options::Format::Json;
+    if (!value || !std::isfinite(*value)) {
+        if (json) {
+            fmt::format_to(std::back_inserter(_buf), "null");
+        }
+        return;
+    }
+    fmt::format_to(std::back_inserter(_buf), "{}", *value);
+}
+
+void Output::flush_if_full()
+{
+    if (_buf.size() >= FLUSH_SIZE) {
+        flush();
+    }
+}
+
+void Output::flush()
+{
+    if (_buf.size() > 0) {
+        std::fwrite(_buf.data(), 1, _buf.size(), _file);
+        _buf.clear();
+    }
+    std::fflush(_file);
+}
+
+} // namespace El
@@ -0,0 +1,149 @@
+#pragma once
+
+#ifndef EL_OUTPUT_H_INCLUDED
+#  define EL_OUTPUT_H_INCLUDED
+
+#include "options.h"
+
+#include <fmt/format.h>
+
+#include <cstdio>
+#include <optional>
+
+QT_FORWARD_DECLARE_CLASS(QDateTime)
+
+namespace El {
+
+class Distributions;
+class Peaks;
+class Record;
+struct Summary;
+
+/// Writes consumption records and totals in the requested format
+///
+/// Everything is formatted into one reusable buffer that is written to the file only when it
+/// grows over `FLUSH_SIZE` bytes and at explicit flush points, instead of one write per record.
+///
+/// Machine readable formats contain every record and the summary:
+///
+/// - csv: `row,start,end,zone,kwh,price,cost,meter` where `row` is `record` or `summary` and
+///   `zone` is `night`, `day` or `total`
+/// - ndjson: one object per record and a summary object, distinguished by the `row` member
+/// - json: `{"records": [...], "summary": {...}}`
+///
+/// Peak demand analysis adds `peak` rows (zone is the window length like `60min`), `top` rows
+/// (zone is the rank in the month) and a `summary` row for the `peak` zone to csv, a `peaks` object to ndjson and a `peaks`
+/// member before the summary to json.
+///
+/// Distributions add `quantile` rows (zone is `p50`, `p90` or `p99`, kwh is the quantile of
+/// interval consumption and price the quantile of prices), `paid` rows (price is the quantile of
+/// prices weighted by the consumption) and `histogram` rows (zone is the range of interval
+/// consumption kWh and kwh the number of intervals) to csv, a `distribution` object to ndjson and
+/// a `distribution` member before the summary to json. Quantiles are for every month and for the
+/// whole period.
+///
+/// Files with grid export channels add `record` rows with the `export` zone for records with
+/// exported energy and `summary` rows for the `export` and `net` zones to csv, and `export_kwh`,
+/// `export_price` and `revenue` members to records and `export` and `net` members to the summary
+/// in json. Export prices and revenues are the Nord Pool prices without the margin and VAT; the
+/// net cost is the cost with VAT minus the export revenue.
+///
+/// The price of a record is the Nord Pool price with VAT, the price in the summary is the average
+/// cost of one kWh. Costs are with the margin and VAT; costs of records are rounded by the same
+/// rules as the totals (see `money.h`). Prices and costs are empty (csv) or null (json) for
+/// records without a price and omitted if prices are not requested. Times are local ISO 8601
+/// times.
+class Output {
+public:
+
+    /// Size of the buffer that triggers writing to the file
+    static constexpr std::size_t FLUSH_SIZE = 64 * 1024;
+
+    /// Ctor
+    /// @param[in] options Engine options; the format, VAT, margin and initial meter readings are used
+    /// @param[in] costs True if prices and costs are shown
+    /// @param[in] file Output file
+    Output(Options const &options, bool costs, std::FILE *file = stdout);
+
+    /// Dtor; writes out buffered output
+    ~Output();
+
+    /// Deleted move and copy operations
+    Output(Output const &other)                     = delete;
+    Output(Output &&other)                          = delete;
+    auto operator=(Output const &other) -> Output & = delete;
+    auto operator=(Output &&other) -> Output &      = delete;
+
+    /// Writes one consumption record
+    ///
+    /// The text format shows records only with `--verbose` and warns about missing prices.
+    /// @param[in] rec Consumption record
+    /// @param[in] price Nord Pool price EUR/kWh or an empty value if not known
+    void record(Record const &rec, std::optional<double> const &price);
+
+    /// Writes totals and the end of the document
+    /// @param[in] s Totals (costs without VAT)
+    /// @param[in] start Start time of the first record
+    /// @param[in] end End time of the last record
+    void summary(Summary const &s, QDateTime const &start, QDateTime const &end);
+
+    /// Writes the peak demand analysis; must be written before the summary
+    /// @param[in] p Finished peak demand analysis (costs without VAT)
+    /// @param[in] start Start time of the first record
+    /// @param[in] end End time of the last record
+    void peaks(Peaks const &p, QDateTime const &start, QDateTime const &end);
+
+    /// Writes the distributions of consumption and prices; must be written before the summary
+    /// @param[in] d Distributions (prices without VAT)
+    /// @param[in] start Start time of the first record
+    /// @param[in] end End time of the last record
+    void distributions(Distributions const &d, QDateTime const &start, QDateTime const &end);
+
+    /// Writes buffered output to the file
+    void flush();
+
+private:
+
+    /// Engine options
+    Options const &_options;
+
+    /// Output format
+    Options::Format _format;
+
+    /// True if prices and costs are shown
+    bool _costs;
+
+    /// Output file
+    std::FILE *_file;
+
+    /// Output buffer
+    fmt::memory_buffer _buf;
+
+    /// Flag indicating that the CSV header or the start of the JSON document is written
+    bool _begun = false;
+
+    /// Number of records written
+    qsizetype _records = 0;
+
+    /// Flag indicating that the JSON array of records is closed
+    bool _records_closed = false;
+
+    /// Writes the CSV header or the start of the JSON document before the first output
+    void begin();
+
+    /// Writes buffered output if the buffer is full
+    void flush_if_full();
+
+    /// Appends the time in ISO 8601 format
+    void append_time(QDateTime const &time);
+
+    /// Appends a number or an empty value (`null` in JSON)
+    void append_number(std::optional<double> const &value);
+
+    /// Appends totals for one zone as a JSON object; the cost is with VAT
+    void append_zone(double kwh, double eur, std::optional<double> const &meter);
+};
+
+} // namespace El
+
+#endif
@@ -0,0 +1,149 @@
+#include "peaks.h"
+#include "record.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+constexpr qint64 SECS_IN_MIN  = 60;
+constexpr double SECS_IN_HOUR = 3'600.0;
+
+/// Returns the end time of the record (exclusive) in seconds since the Epoch
+///
+/// The end time of a record is the last minute or the last second of the interval.
+auto end_secs(El::Record const &rec) -> qint64
+{
+    return (rec.endTime().toSecsSinceEpoch() / SECS_IN_MIN + 1) * SECS_IN_MIN;
+}
+
+} // namespace
+
+namespace El {
+
+Peaks::Peaks(QList<int> const &window_minutes, int top)
+    : _top(top)
+{
+    _sliders.reserve(static_cast<size_t>(window_minutes.size()));
+    for (auto const minutes : window_minutes) {
+        Slider s{};
+        s.length_s    = minutes * SECS_IN_MIN;
+        s.max.minutes = minutes;
+        _sliders.push_back(std::move(s));
+    }
+}
+
+void Peaks::add(Record const &rec)
+{
+    auto const start_s = rec.startTime().toSecsSinceEpoch();
+    auto const end_s   = end_secs(rec);
+    auto const wh      = to_wh(rec.kWh());
+    if (end_s <= start_s) {
+        return;
+    }
+
+    if (rec.isPeak()) {
+        _peak_wh += wh;
+        ++_peak_records;
+    }
+
+    // a record that goes back in time restarts the windows
+    if (start_s < _last_end_s) {
+        for (auto &s : _sliders) {
+            s.slices.clear();
+            s.wh = 0;
+        }
+    }
+    _last_end_s = end_s;
+
+    for (auto &s : _sliders) {
+        s.slices.push_back({start_s, end_s, wh});
+        s.wh += wh;
+
+        // drop records that end before the window; the current record is always within it
+        auto const from_s = end_s - s.length_s;
+        while (s.slices.front().end_s <= from_s) {
+            s.wh -= s.slices.front().wh;
+            s.slices.pop_front();
+        }
+
+        // the first record may start before the window
+        auto        energy = static_cast<double>(s.wh);
+        auto const &first  = s.slices.front();
+        if (first.start_s < from_s) {
+            energy -= static_cast<double>(first.wh) * static_cast<double>(from_s - first.start_s) /
+                      static_cast<double>(first.end_s - first.start_s);
+        }
+
+        auto const kwh = energy / WH_IN_KWH;
+        auto const kw  = kwh / (static_cast<double>(s.length_s) / SECS_IN_HOUR);
+        if (!s.max.peak || kw > s.max.peak->kw) {
+            s.max.peak = Interval{QDateTime::fromSecsSinceEpoch(from_s), rec.endTime(), kwh, kw};
+        }
+    }
+
+    // the highest demand intervals of the month
+    auto const date  = rec.startTime().date();
+    auto const month = QDate{date.year(), date.month(), 1};
+    if (month != _month) {
+        flush_month();
+        _month = month;
+    }
+    if (_top <= 0) {
+        return;
+    }
+
+    auto const kw = to_kwh(wh) / (static_cast<double>(end_s - start_s) / SECS_IN_HOUR);
+    if (_heap.size() < static_cast<size_t>(_top)) {
+        _heap.push({rec.startTime(), rec.endTime(), rec.kWh(), kw});
+    }
+    else if (kw > _heap.top().kw) {
+        _heap.pop();
+        _heap.push({rec.startTime(), rec.endTime(), rec.kWh(), kw});
+    }
+}
+
+void Peaks::add(Record const &rec, std::optional<double> const &price, double margin)
+{
+    add(rec);
+
+    if (price && rec.isPeak()) {
+        _peak_cost += cost(*price + margin, to_wh(rec.kWh()));
+    }
+}
+
+void Peaks::finish()
+{
+    flush_month();
+}
+
+auto Peaks::windows() const -> QVector<Window>
+{
+    QVector<Window> result{};
+    result.reserve(static_cast<qsizetype>(_sliders.size()));
+    for (auto const &s : _sliders) {
+        result.append(s.max);
+    }
+    return result;
+}
+
+void Peaks::flush_month()
+{
+    if (_heap.empty()) {
+        return;
+    }
+
+    Month m{};
+    m.month = _month;
+    m.top.reserve(static_cast<qsizetype>(_heap.size()));
+    while (!_heap.empty()) {
+        m.top.append(_heap.top());
+        _heap.pop();
+    }
+
+    // the heap returns the lowest demand first
+    std::reverse(m.top.begin(), m.top.end());
+    _months.append(std::move(m));
+}
+
+} // namespace El
@@ -0,0 +1,143 @@
+#pragma once
+
+#ifndef EL_PEAKS_H_INCLUDED
+#  define EL_PEAKS_H_INCLUDED
+
+#include "money.h"
+
+#include <QDate>
+#include <QDateTime>
+#include <QList>
+#include <QVector>
+
+#include <deque>
+#include <optional>
+#include <queue>
+#include <vector>
+
+namespace El {
+
+class Record;
+
+/// Peak demand analysis for demand-charge tariffs
+///
+/// Records are added in time order and everything is calculated in one pass with constant work
+/// per record:
+///
+/// - the highest average demand (kW) over any window of the given lengths, for example 15
+///   minutes, 1 hour and 1 day; the energy of every window is a running sum over the records
+///   in a queue, records that only partly overlap the window are counted proportionally
+/// - the intervals with the highest demand in every month, kept in a bounded min-heap
+/// - the consumption and cost of peak-time records of the 4-zone tariff
+///
+/// A record that starts before the end of the previous record restarts the windows.
+class Peaks {
+public:
+
+    /// One consumption interval or window
+    struct Interval {
+        QDateTime start;      ///< Start time
+        QDateTime end;        ///< End time (the end time of the last record)
+        double    kwh = 0.0;  ///< Consumption kWh
+        double    kw  = 0.0;  ///< Average demand kW
+    };
+
+    /// The highest demand over windows of one length
+    struct Window {
+        int                     minutes = 0; ///< Length of the window in minutes
+        std::optional<Interval> peak;        ///< The window with the highest demand
+    };
+
+    /// Intervals with the highest demand in one month
+    struct Month {
+        QDate             month; ///< The first day of the month
+        QVector<Interval> top;   ///< Intervals ordered by demand, highest first
+    };
+
+    /// Ctor
+    /// @param[in] window_minutes Lengths of the windows in minutes
+    /// @param[in] top Number of intervals per month
+    Peaks(QList<int> const &window_minutes, int top);
+
+    /// Adds the consumption of the record
+    /// @param[in] rec Consumption record
+    void add(Record const &rec);
+
+    /// Adds the consumption and cost of the record
+    /// @param[in] rec Consumption record
+    /// @param[in] price Price EUR/kWh or an empty value if there is no price for the record
+    /// @param[in] margin Margin EUR/kWh
+    void add(Record const &rec, std::optional<double> const &price, double margin);
+
+    /// Finishes the last month; call after the last record
+    void finish();
+
+    /// Returns the highest demand for every window length
+    auto windows() const -> QVector<Window>;
+
+    /// Returns the intervals with the highest demand for every month
+    auto months() const noexcept -> auto const & { return _months; }
+
+    /// Peak-time consumption Wh
+    auto peak_wh() const noexcept { return _peak_wh; }
+
+    /// Peak-time cost with the margin but without VAT
+    auto peak_cost() const noexcept { return _peak_cost; }
+
+    /// Peak-time consumption kWh
+    auto peak_kwh() const noexcept { return to_kwh(_peak_wh); }
+
+    /// Number of peak-time records
+    auto peak_records() const noexcept { return _peak_records; }
+
+private:
+
+    /// Part of a record within a window
+    struct Slice {
+        qint64 start_s = 0; ///< Start time in seconds since the Epoch
+        qint64 end_s   = 0; ///< End time (exclusive) in seconds since the Epoch
+        Wh     wh      = 0; ///< Consumption Wh
+    };
+
+    /// Sliding window of one length
+    struct Slider {
+        qint64            length_s = 0; ///< Length of the window in seconds
+        std::deque<Slice> slices;       ///< Records within the window
+        Wh                wh = 0;       ///< Sum of `slices`
+        Window            max;          ///< The highest demand so far
+    };
+
+    /// Orders intervals so that the one with the lowest demand is on the top of the heap
+    struct Lower {
+        auto operator()(Interval const &a, Interval const &b) const -> bool { return a.kw > b.kw; }
+    };
+
+    /// Number of intervals per month
+    int _top;
+
+    /// Sliding windows
+    std::vector<Slider> _sliders;
+
+    /// End time of the previous record in seconds since the Epoch
+    qint64 _last_end_s = 0;
+
+    /// Month of the previous record
+    QDate _month;
+
+    /// Intervals with the highest demand in the current month
+    std::priority_queue<Interval, std::vector<Interval>, Lower> _heap;
+
+    /// Finished months
+    QVector<Month> _months;
+
+    Wh    _peak_wh      = 0;
+    Money _peak_cost    = 0;
+    int   _peak_records = 0;
+
+    /// Moves intervals of the current month to `_months`
+    void flush_month();
+};
+
+} // namespace El
+
+#endif // EL_PEAKS_H_INCLUDED
@@ -0,0 +1,105 @@
+#include "prefetch.h"
+#include "common.h"
+#include "options.h"
+#include "prices.h"
+
+#include <QTimeZone>
+#include <QTimer>
+
+#include <fmt/base.h>
+
+#include <algorithm>
+
+namespace El {
+
+Prefetch::Prefetch(Options const &options, QObject *parent)
+    : QObject(parent)
+    , _options(options)
+    , _timer(new QTimer{this})
+{
+    _timer->setSingleShot(true);
+    _timer->setTimerType(Qt::VeryCoarseTimer);
+    connect(_timer, &QTimer::timeout, this, &Prefetch::run);
+}
+
+Prefetch::~Prefetch() = default;
+
+void Prefetch::start()
+{
+    run();
+}
+
+void Prefetch::run()
+{
+    // prices for tomorrow are expected after they have been published today
+    auto const now       = QDateTime::currentDateTime();
+    auto const published = next_publication(now).date() != now.date();
+    auto const today     = QDate::currentDate();
+
+    _start    = QDateTime{today.addDays(-_options.prefetch_days), QTime{0, 0}};
+    _end      = QDateTime{today.addDays(published ? 2 : 1), QTime{0, 0}}.addSecs(-INTERVAL_S);
+    _complete = true;
+    _queue    = _options.regions;
+
+    if (_options.verbose) {
+        fmt::print("{}: uuendan hindasid perioodile {} ... {}\n", now, _start, _end);
+    }
+
+    next_region();
+}
+
+void Prefetch::next_region()
+{
+    if (_queue.isEmpty()) {
+        schedule();
+        return;
+    }
+
+    _region = _queue.takeFirst();
+    _prices = std::make_unique<Prices>(_options);
+
+    // queued, so that the prices can be released when the signal arrives
+    connect(_prices.get(), &Prices::loaded, this, &Prefetch::region_loaded, Qt::QueuedConnection);
+    _prices->load(_region, _start, _end);
+}
+
+void Prefetch::region_loaded(bool ok)
+{
+    // only published prices count, so that missing prices for tomorrow are retried
+    auto const covered = ok && _prices->covers(_start, _end);
+    if (!covered && _options.verbose) {
+        fmt::print("Hinnapiirkonnas {} puuduvad veel mõned hinnad\n", _region);
+    }
+    _complete = _complete && covered;
+
+    _prices.reset();
+    next_region();
+}
+
+void Prefetch::schedule()
+{
+    auto const now = QDateTime::currentDateTime();
+    auto       next = next_publication(now);
+    if (!_complete) {
+        next = std::min(next, now.addSecs(RETRY_INTERVAL_S));
+    }
+
+    if (_options.verbose) {
+        fmt::print("Järgmine hindade uuendamine {}\n", next);
+    }
+
+    _timer->start(static_cast<int>(now.msecsTo(next)));
+}
+
+auto Prefetch::next_publication(QDateTime const &now) -> QDateTime
+{
+    QTimeZone const tz{PUBLISH_TZ};
+
+    QDateTime next{now.toTimeZone(tz).date(), QTime{PUBLISH_HOUR, PUBLISH_MINUTE}, tz};
+    if (next <= now) {
+        next = next.addDays(1);
+    }
+    return next.toLocalTime();
+}
+
+} // namespace El
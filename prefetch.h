@@ -0,0 +1,97 @@
+#pragma once
+
+#ifndef EL_PREFETCH_H_INCLUDED
+#  define EL_PREFETCH_H_INCLUDED
+
+#include <QDateTime>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include <memory>
+
+QT_FORWARD_DECLARE_CLASS(QTimer)
+
+namespace El {
+
+class Prices;
+struct Options;
+
+/// Daemon that keeps the price cache up to date
+///
+/// Fetches day-ahead prices for all the configured regions right after they are published and
+/// backfills missing prices for the configured number of days before today. Sleeps until the
+/// next publication time; if prices are not yet published or fetching fails, retries after
+/// `RETRY_INTERVAL_S`. Prices are kept in memory only while one region is being updated.
+class Prefetch : public QObject {
+    Q_OBJECT
+
+public:
+
+    /// Day-ahead prices are published at about 12:45 CET; this is the time to fetch them
+    static constexpr int PUBLISH_HOUR   = 13;
+    static constexpr int PUBLISH_MINUTE = 0;
+
+    /// Time zone of the publication time
+    static constexpr char const *PUBLISH_TZ = "Europe/Oslo";
+
+    /// Delay before fetching again if prices are missing
+    static constexpr int RETRY_INTERVAL_S = 15 * 60;
+
+    /// Ctor
+    /// @param[in] options Engine options
+    /// @param[in] parent Optional parent
+    Prefetch(Options const &options, QObject *parent = nullptr);
+
+    /// Dtor
+    ~Prefetch() override;
+
+    /// Starts updating prices; runs until the application quits
+    void start();
+
+private:
+
+    /// Engine options
+    Options const &_options;
+
+    /// Timer that wakes up the daemon
+    QTimer *_timer = nullptr;
+
+    /// Regions waiting to be updated during this run
+    QStringList _queue;
+
+    /// Region being updated
+    QString _region;
+
+    /// Prices of the region being updated
+    std::unique_ptr<Prices> _prices;
+
+    /// Time period of the prices being updated
+    QDateTime _start;
+    QDateTime _end;
+
+    /// Flag indicating that all the prices expected by now are in the cache
+    bool _complete = true;
+
+    /// Starts updating prices for all the regions
+    void run();
+
+    /// Starts updating prices for the next region in the queue
+    void next_region();
+
+    /// Called when prices for the region are loaded
+    /// @param[in] ok true if succeeded, otherwise false
+    void region_loaded(bool ok);
+
+    /// Schedules the next run
+    void schedule();
+
+    /// Returns the next publication time of day-ahead prices
+    /// @param[in] now Current time
+    /// @return Publication time in local time
+    static auto next_publication(QDateTime const &now) -> QDateTime;
+};
+
+} // namespace El
+
+#endif
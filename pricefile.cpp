@@ -0,0 +1,138 @@
+#include "pricefile.h"
+
+#include "common.h"
+#include "json.h"
+#include "profile.h"
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QString>
+#include <QVector>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+
+namespace El {
+
+// -----------------------------------------------------------------------------
+
+auto PriceFile::load(QString const &path, QString const &region) -> PriceBlocks
+{
+    using namespace Qt::Literals::StringLiterals;
+
+    Profile::Scope const profile{"PriceFile::load"};
+
+    QFileInfo const info{path};
+    if (!info.isDir()) {
+        return load_file(path, region);
+    }
+
+    // load all the price files from the directory
+    QDir const dir{path};
+    auto const files = dir.entryList({u"*.json"_s, u"*.csv"_s}, QDir::Files | QDir::Readable, QDir::Name);
+    if (files.isEmpty()) {
+        throw Exception{"No price files in the directory '{}'", path};
+    }
+
+    PriceBlocks result{};
+    for (auto const &f : files) {
+        result.append(load_file(dir.filePath(f), region));
+    }
+    return result;
+}
+
+auto PriceFile::load_file(QString const &filename, QString const &region) -> PriceBlocks
+{
+    using namespace Qt::Literals::StringLiterals;
+
+    if (QFileInfo{filename}.suffix().compare(u"csv"_s, Qt::CaseInsensitive) == 0) {
+        return load_csv(filename);
+    }
+    return load_json(filename, region);
+}
+
+auto PriceFile::load_json(QString const &filename, QString const &region) -> PriceBlocks
+{
+    QFile file{filename};
+    if (!file.open(QFile::ReadOnly)) {
+        throw Exception{"Failed to open '{}': {}", filename, file.errorString()};
+    }
+
+    // map the file into memory instead of copying it when possible
+    auto const size = file.size();
+    auto const *data = file.map(0, size);
+    if (data == nullptr) {
+        return Json::from_json(file.readAll(), region).prices();
+    }
+
+    auto const json = QByteArray::fromRawData(reinterpret_cast<char const *>(data), size);
+    return Json::from_json(json, region).prices();
+}
+
+auto PriceFile::load_csv(QString const &filename) -> PriceBlocks
+{
+    using namespace Qt::Literals::StringLiterals;
+
+    QFile file{filename};
+    if (!file.open(QFile::ReadOnly | QFile::Text)) {
+        throw Exception{"Failed to open '{}': {}", filename, file.errorString()};
+    }
+
+    // read price records line by line
+    QVector<Price> prices{};
+    int lineno = 0;
+    while (!file.atEnd()) {
+        ++lineno;
+
+        auto const line = file.readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+
+        auto const fields = line.split(';');
+        if (fields.size() < 2) {
+            throw Exception{"Invalid number of fields on line #{} in '{}'", lineno, filename};
+        }
+
+        // timestamp as seconds since the EPOCH or ISO 8601 date/time
+        bool ok = false;
+        auto const ts = fields.at(0).trimmed();
+        auto time = QDateTime::fromSecsSinceEpoch(ts.toLongLong(&ok));
+        if (!ok) {
+            time = QDateTime::fromString(QString::fromUtf8(ts), Qt::ISODate);
+        }
+        if (!time.isValid()) {
+            // the first line may be a header
+            if (lineno == 1) {
+                continue;
+            }
+            throw Exception{"Invalid timestamp '{}' on line #{} in '{}'", ts, lineno, filename};
+        }
+
+        // price with either decimal point or comma
+        auto value = fields.at(1).trimmed();
+        auto const price = value.replace(',', '.').toDouble(&ok);
+        if (!ok) {
+            throw Exception{"Invalid price '{}' on line #{} in '{}'", fields.at(1), lineno, filename};
+        }
+
+        prices.append({time, price});
+    }
+
+    // price files are expected to be ordered by time, but do not rely on it
+    if (!std::is_sorted(prices.cbegin(), prices.cend(), [](Price const &a, Price const &b) { return a.time < b.time; })) {
+        std::stable_sort(prices.begin(), prices.end(), [](Price const &a, Price const &b) { return a.time < b.time; });
+    }
+
+    PriceBuilder builder{};
+    for (auto const &price : prices) {
+        builder.add(price);
+    }
+    return builder.finish();
+}
+
+} // namespace El
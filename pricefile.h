@@ -0,0 +1,55 @@
+#pragma once
+
+#ifndef EL_PRICEFILE_H_INCLUDED
+#  define EL_PRICEFILE_H_INCLUDED
+
+#include "common.h"
+
+#include <QtGlobal>
+
+QT_FORWARD_DECLARE_CLASS(QString)
+
+namespace El {
+
+/// Helper class for loading Nord Pool prices from local files
+///
+/// Supported formats are the JSON document returned by the Elering `/api/nps/price` request
+/// and CSV files with `timestamp;price` lines, where `timestamp` is either seconds since the
+/// EPOCH or an ISO 8601 date/time and `price` is EUR/MWh without taxes. A directory is loaded
+/// by loading all the `*.json` and `*.csv` files in it.
+class PriceFile {
+public:
+
+    /// Loads prices from a file or directory
+    /// @param[in] path Name of the file or directory
+    /// @param[in] region Price region used for JSON files
+    /// @return Price blocks
+    /// @throws Exception on errors
+    static auto load(QString const &path, QString const &region) -> PriceBlocks;
+
+private:
+
+    /// Loads prices from a JSON file
+    /// @param[in] filename Name of the file
+    /// @param[in] region Price region
+    /// @return Price blocks
+    /// @throws Exception on errors
+    static auto load_json(QString const &filename, QString const &region) -> PriceBlocks;
+
+    /// Loads prices from a CSV file
+    /// @param[in] filename Name of the file
+    /// @return Price blocks
+    /// @throws Exception on errors
+    static auto load_csv(QString const &filename) -> PriceBlocks;
+
+    /// Loads prices from a file using the file name suffix to detect the format
+    /// @param[in] filename Name of the file
+    /// @param[in] region Price region used for JSON files
+    /// @return Price blocks
+    /// @throws Exception on errors
+    static auto load_file(QString const &filename, QString const &region) -> PriceBlocks;
+};
+
+} // namespace El
+
+#endif
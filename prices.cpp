@@ -1,71 +1,290 @@
 #include "prices.h"
-#include "app.h"
-#include "args.h"
 #include "cache.h"
 #include "common.h"
 #include "nordpool.h"
+#include "options.h"
+#include "pricefile.h"
+#include "pricetable.h"
+#include "profile.h"
 
 #include <QDateTime>
+#include <QLockFile>
 
 #include <fmt/base.h>
 
 namespace El {
 
-Prices::Prices(App const &app)
-    : _app(app)
-    , _cache(new Cache{app})
+Prices::Prices(Options const &options, QObject *parent)
+    : QObject(parent)
+    , _options(options)
 {}
 
 Prices::~Prices() = default;
 
-auto Prices::load(QString const &region, QDateTime const &start, QDateTime const &end) -> bool
+void Prices::load(QString const &region, QDateTime const &start, QDateTime const &end)
 {
-    // try cached prices first
-    try {
-        _prices = _cache->get_prices(region, start, end);
+    _busy = true;
+
+    // check for already loaded prices
+    if (covers(start, end)) {
+        finish(true);
+        return;
     }
-    catch (Exception const &ex) {
-        fmt::print("WARNING: hindade pärimine vahemälust ebaõnnestus: {}\n", ex.what());
+
+    // use prices from the local file if given
+    if (!_options.price_file_name.isEmpty()) {
+        finish(load_file(_options.price_file_name, region, start, end));
+        return;
     }
 
-    // check the result
-    if (!_prices.empty() && !_prices.has_holes() && start >= _prices.start_time() && end <= _prices.end_time()) {
-        if (Args::instance().verbose()) {
-            fmt::print("Kasutan vahemälusse salvestatud hindasid\n");
+    // try cached prices first; prices for today and later may still change
+    if (load_cached(region, start, end)) {
+        auto const provisional = provisional_period(end);
+        if (provisional) {
+            revalidate(region, *provisional);
+            return;
         }
-        return true;
+        finish(true);
+        return;
+    }
 
+    // only one process at a time fetches missing prices; others wait and then find them in the cache
+    try {
+        _fetch_lock = cache()->lock_fetch(region);
+    }
+    catch (Exception const &ex) {
+        // another process is still fetching; continue with the prices that it has stored so far
+        // and leave the records without a price, like when revalidation fails
+        fmt::print("WARNING: {}\n", ex.what());
+        if (!load_cached(region, start, end)) {
+            for (auto const &m : _prices.get_missing_blocks(start, end)) {
+                fmt::print("WARNING: hinnad puuduvad perioodil {} ... {}\n", m.start, m.end);
+            }
+        }
+        finish(true);
+        return;
+    }
+    if (_fetch_lock && load_cached(region, start, end)) {
+        finish(true);
+        return;
     }
 
     // request missing prices from Nord Pool
     auto const missing_blocks = _prices.get_missing_blocks(start, end);
 
-    NordPool np{_app};
+    // prices are merged and stored in the cache as soon as each request finishes, so that an
+    // interrupted run continues from where it stopped
+    nordpool()->get_prices(region, missing_blocks, [this, region](NordPool::Response &&response) {
+        received(region, response.period, std::move(response.prices));
+    });
+}
+
+auto Prices::provisional_period(QDateTime const &end) -> std::optional<TimePair>
+{
+    auto const today = QDateTime{QDate::currentDate(), QTime{0, 0}};
+    if (end < today) {
+        return {};
+    }
+
+    // day-ahead prices for tomorrow are published during the day; the period is the same for all
+    // the runs during a day, so that validators of the previous response can be used
+    auto const last = today.addDays(2).addSecs(-INTERVAL_S);
+    return TimePair{today, last};
+}
+
+void Prices::revalidate(QString const &region, TimePair const &period)
+{
+    _validator = {};
+    try {
+        _validator = cache()->get_validator(region, period);
+    }
+    catch (Exception const &ex) {
+        fmt::print("WARNING: hindade valideerimise info pärimine vahemälust ebaõnnestus: {}\n", ex.what());
+    }
 
-    for (auto const &period : missing_blocks) {
-        PriceBlocks p;
+    // most runs do not need the network at all
+    if (QDateTime::currentSecsSinceEpoch() - _validator.checked_s < REVALIDATE_INTERVAL_S) {
+        finish(true);
+        return;
+    }
+
+    _revalidating = true;
+    nordpool()->revalidate(region, period, _validator, [this, region](NordPool::Response &&response) {
+        revalidated(region, std::move(response));
+    });
+}
+
+void Prices::revalidated(QString const &region, NordPool::Response &&response)
+{
+    auto const &period = response.period;
+
+    if (!response.modified) {
+        if (_options.verbose) {
+            fmt::print("Hinnad perioodile {} ... {} ei ole muutunud\n", period.start, period.end);
+        }
         try {
-            p = np.get_prices(region, period.start, period.end);
+            _validator.checked_s = QDateTime::currentSecsSinceEpoch();
+            cache()->store_validator(region, period, _validator);
         }
         catch (Exception const &ex) {
-            fmt::print(stderr, "ERROR: Nord Pool hindade küsimine ebaõnnestus: {}\n", ex.what());
-            return false;
+            fmt::print("WARNING: hindade valideerimise info salvestamine vahemälusse ebaõnnestus: {}\n", ex.what());
         }
+        return;
+    }
+
+    // only published prices are stored; prices that are still missing are requested again later
+    auto observed = response.prices.observed();
+
+    // update cache; the time of the check is stored even without validators
+    try {
+        cache()->replace_prices(region, period, observed);
+        response.validator.checked_s = QDateTime::currentSecsSinceEpoch();
+        cache()->store_validator(region, period, response.validator);
+    }
+    catch (Exception const &ex) {
+        fmt::print("WARNING: Nord Pool hindade salvestamine vahemälusse ebaõnnestus: {}\n", ex.what());
+    }
+
+    // replace prices in memory
+    auto prices = _prices.slice(_prices.start_time(), period.start.addSecs(-1));
+    prices.append(_prices.slice(period.end.addSecs(1), _prices.end_time()));
+    prices.append(std::move(observed));
+    _prices = std::move(prices);
+}
+
+auto Prices::cache() -> Cache *
+{
+    if (!_cache) {
+        _cache = std::make_unique<Cache>(_options);
+    }
+    return _cache.get();
+}
+
+auto Prices::nordpool() -> NordPool *
+{
+    if (_nordpool == nullptr) {
+        _nordpool = new NordPool{_options, this};
+        connect(_nordpool, &NordPool::done, this, [this](QString const &error) {
+            // cached prices are still usable if revalidation fails
+            if (!error.isEmpty() && _revalidating) {
+                fmt::print("WARNING: Nord Pool hindade uuendamine ebaõnnestus: {}\n", error);
+                finish(true);
+                return;
+            }
+            if (!error.isEmpty()) {
+                fmt::print(stderr, "ERROR: Nord Pool hindade küsimine ebaõnnestus: {}\n", error);
+            }
+            finish(error.isEmpty());
+        });
+    }
+    return _nordpool;
+}
+
+auto Prices::covers(QDateTime const &start, QDateTime const &end) const -> bool
+{
+    return !_prices.empty() && _prices.get_missing_blocks(start, end).isEmpty();
+}
+
+void Prices::received(QString const &region, TimePair const &period, PriceBlocks &&p)
+{
+    // coalesced requests may return prices that we already have
+    auto const missing = _prices.get_missing_blocks(period.start, period.end);
+    PriceBlocks new_prices{};
+    for (auto const &m : missing) {
+        new_prices.append(p.slice(m.start, m.end));
+    }
+
+    // update cache
+    try {
+        cache()->store_prices(region, new_prices);
+    }
+    catch (Exception const &ex) {
+        fmt::print("WARNING: Nord Pool hindade salvestamine vahemälusse ebaõnnestus: {}\n", ex.what());
+    }
+
+    _prices.append(std::move(new_prices));
+}
+
+void Prices::finish(bool ok)
+{
+    _fetch_lock.reset();
+    _revalidating = false;
+    _busy         = false;
+
+    // threads holding the previous snapshot keep using it
+    _snapshot.reset();
+
+    emit loaded(ok);
+}
+
+auto Prices::load_file(QString const &path, QString const &region, QDateTime const &start, QDateTime const &end)
+    -> bool
+{
+    try {
+        _prices = PriceFile::load(path, region);
+    }
+    catch (Exception const &ex) {
+        fmt::print(stderr, "ERROR: hindade laadimine failist {} ebaõnnestus: {}\n", path, ex.what());
+        return false;
+    }
+
+    if (_prices.empty()) {
+        fmt::print(stderr, "ERROR: hinnafail {} ei sisalda ühtegi hinda\n", path);
+        return false;
+    }
+
+    if (_prices.has_holes() || start < _prices.start_time() || end > _prices.end_time()) {
+        fmt::print("WARNING: hinnafail {} ei sisalda kõiki hindasid perioodile {} ... {}\n", path, start, end);
+    }
 
-        // update cache
+    // store prices that are not yet in the cache
+    if (_options.import_prices) {
         try {
-            _cache->store_prices(region, p);
+            auto const cached  = cache()->get_prices(region, _prices.start_time(), _prices.end_time());
+            auto const missing = cached.get_missing_blocks(_prices.start_time(), _prices.end_time());
+
+            PriceBlocks p{};
+            for (auto const &period : missing) {
+                p.append(_prices.slice(period.start, period.end));
+            }
+            cache()->store_prices(region, p);
+
+            if (_options.verbose) {
+                fmt::print("Salvestasin failist {} vahemällu {} hinnaplokki\n", path, p.size());
+            }
         }
         catch (Exception const &ex) {
-            fmt::print("WARNING: Nord Pool hindade salvestamine vahemälusse ebaõnnestus: {}\n", ex.what());
+            fmt::print(stderr, "ERROR: hindade salvestamine vahemällu ebaõnnestus: {}\n", ex.what());
+            return false;
         }
-
-        _prices.append(std::move(p));
     }
 
     return true;
 }
 
+auto Prices::load_cached(QString const &region, QDateTime const &start, QDateTime const &end) -> bool
+{
+    try {
+        _prices = cache()->get_prices(region, start, end);
+    }
+    catch (Exception const &ex) {
+        fmt::print("WARNING: hindade pärimine vahemälust ebaõnnestus: {}\n", ex.what());
+        return false;
+    }
+
+    // check the result
+    if (covers(start, end)) {
+        Profile::count(Profile::Counter::CacheHits);
+        if (_options.verbose) {
+            fmt::print("Kasutan vahemälusse salvestatud hindasid\n");
+        }
+        return true;
+    }
+
+    Profile::count(Profile::Counter::CacheMisses);
+    return false;
+}
+
 auto Prices::get_price(QDateTime const &time) const -> std::optional<double>
 {
     auto const value = _prices.get_price(time);
@@ -76,4 +295,18 @@ auto Prices::get_price(QDateTime const &time) const -> std::optional<double>
     return *value / KWH_IN_MWH;
 }
 
+auto Prices::get_price(QDateTime const &start, QDateTime const &end) const -> std::optional<double>
+{
+    return snapshot()->get_price(start, end);
+}
+
+auto Prices::snapshot() const -> std::shared_ptr<PriceTable const>
+{
+    if (!_snapshot) {
+        Profile::Scope const profile{"Prices::snapshot"};
+        _snapshot = std::make_shared<PriceTable const>(_prices);
+    }
+    return _snapshot;
+}
+
 } // namespace El
@@ -4,53 +4,163 @@
 #  define EL_PRICES_H_INCLUDED
 
 #include "common.h"
+#include "nordpool.h"
 
-#include <QtGlobal>
+#include <QObject>
+#include <QString>
 
 #include <memory>
 #include <optional>
 
 QT_FORWARD_DECLARE_CLASS(QDateTime)
-QT_FORWARD_DECLARE_CLASS(QString)
+QT_FORWARD_DECLARE_CLASS(QLockFile)
 
 namespace El {
 
-class App;
 class Cache;
+class PriceTable;
+struct Options;
 
 /// Hourly Nord Pool prices
-class Prices {
+class Prices : public QObject {
+    Q_OBJECT
+
 public:
 
+    /// Cached prices that may still change are revalidated at most this often
+    static constexpr int REVALIDATE_INTERVAL_S = 15 * 60;
+
     /// Ctor
-    /// @param[in] app Application instance
-    Prices(App const &app);
+    /// @param[in] options Engine options
+    /// @param[in] parent Optional parent
+    Prices(Options const &options, QObject *parent = nullptr);
 
     /// Dtor
-    ~Prices();
+    ~Prices() override;
+
+    /// Returns true if prices are being loaded
+    auto busy() const noexcept { return _busy; }
 
-    /// Loads hourly prices for the given time period
+    /// Starts loading prices for the given time period
+    ///
+    /// Prices from the cache or from a local file are loaded immediately, missing prices are
+    /// requested from Nord Pool in the background. The `loaded()` signal is emitted when done.
     /// @param[in] region Price region
     /// @param[in] start Start time
     /// @param[in] end End time
-    /// @return true when succeeded, otherwise false
-    auto load(QString const &region, QDateTime const &start, QDateTime const &end) -> bool;
+    void load(QString const &region, QDateTime const &start, QDateTime const &end);
+
+    /// Returns true if there are prices for the whole time period
+    ///
+    /// Only prices received from Nord Pool count; repeated prices stored by older versions do not.
+    /// @param[in] start Start time
+    /// @param[in] end End time
+    auto covers(QDateTime const &start, QDateTime const &end) const -> bool;
 
     /// Get the price in Euros for one kWh for the given time
     /// @param[in] time The date/time
     /// @return The price or an empty value
     auto get_price(QDateTime const &time) const -> std::optional<double>;
 
+    /// Get the average price in Euros for one kWh for the given time period
+    /// @param[in] start Start time of the period
+    /// @param[in] end End time of the period (inclusive)
+    /// @return The price or an empty value if any of the prices is missing
+    auto get_price(QDateTime const &start, QDateTime const &end) const -> std::optional<double>;
+
+    /// Returns the loaded prices (EUR/MWh) without taxes
+    auto blocks() const noexcept -> auto const & { return _prices; }
+
+    /// Returns an immutable snapshot of the loaded prices
+    ///
+    /// The snapshot is reference counted and never changes, so it can be handed to any number of
+    /// worker threads that look up prices without locking, also while this object loads more
+    /// prices. Snapshots are created when needed and reused until prices are loaded again.
+    auto snapshot() const -> std::shared_ptr<PriceTable const>;
+
+signals:
+
+    /// Emitted when loading prices has finished
+    /// @param[in] ok true when succeeded, otherwise false
+    void loaded(bool ok);
+
 private:
 
-    /// Application instance
-    App const &_app;
+    /// Engine options
+    Options const &_options;
 
-    /// Prices cache
+    /// Prices cache (created when needed)
     std::unique_ptr<Cache> _cache;
 
+    /// Nord Pool client (created when needed)
+    NordPool *_nordpool = nullptr;
+
+    /// Lock held while missing prices are requested from Nord Pool
+    std::unique_ptr<QLockFile> _fetch_lock;
+
+    /// Flag indicating that prices are being loaded
+    bool _busy = false;
+
+    /// Flag indicating that cached prices are being revalidated
+    bool _revalidating = false;
+
+    /// Validators of the cached prices being revalidated
+    Validator _validator;
+
     /// Price blocks
     PriceBlocks _prices;
+
+    /// Snapshot of the price blocks (created when needed)
+    mutable std::shared_ptr<PriceTable const> _snapshot;
+
+    /// Loads prices from a local file or directory and optionally stores them in the cache
+    /// @param[in] path Name of the file or directory
+    /// @param[in] region Price region
+    /// @param[in] start Start time
+    /// @param[in] end End time
+    /// @return true when succeeded, otherwise false
+    auto load_file(QString const &path, QString const &region, QDateTime const &start, QDateTime const &end) -> bool;
+
+    /// Loads prices from the cache
+    /// @param[in] region Price region
+    /// @param[in] start Start time
+    /// @param[in] end End time
+    /// @return true if the cache contained all the prices, otherwise false
+    auto load_cached(QString const &region, QDateTime const &start, QDateTime const &end) -> bool;
+
+    /// Merges prices received from Nord Pool and stores new ones in the cache
+    /// @param[in] region Price region
+    /// @param[in] period Requested time period
+    /// @param[in] p Received prices
+    void received(QString const &region, TimePair const &period, PriceBlocks &&p);
+
+    /// Returns the period of prices that may still change
+    /// @param[in] end End time of requested prices
+    /// @return Period starting from today or an empty value if all the prices are final
+    static auto provisional_period(QDateTime const &end) -> std::optional<TimePair>;
+
+    /// Starts revalidating cached prices for the period unless they were checked recently
+    /// @param[in] region Price region
+    /// @param[in] period Time period
+    void revalidate(QString const &region, TimePair const &period);
+
+    /// Replaces prices with revalidated prices if they have changed
+    /// @param[in] region Price region
+    /// @param[in] response Response to the conditional request
+    void revalidated(QString const &region, NordPool::Response &&response);
+
+    /// Returns the prices cache (created when needed)
+    ///
+    /// Opening the cache creates the cache directory and loads the SQLite driver, which runs
+    /// with prices from a file do not need.
+    auto cache() -> Cache *;
+
+    /// Returns the Nord Pool client (created when needed)
+    auto nordpool() -> NordPool *;
+
+    /// Finishes loading prices
+    /// @param[in] ok true when succeeded, otherwise false
+    void finish(bool ok);
 };
 
 } // namespace El
@@ -0,0 +1,83 @@
+#include "pricetable.h"
+#include "common.h"
+
+#include <QDateTime>
+
+#include <cmath>
+#include <limits>
+
+namespace El {
+
+PriceTable::PriceTable(PriceBlocks const &blocks)
+{
+    if (blocks.empty()) {
+        return;
+    }
+
+    _start_s        = blocks.start_time().toSecsSinceEpoch();
+    auto const last = blocks.end_time().toSecsSinceEpoch();
+    _prices.assign(static_cast<size_t>((last - _start_s) / INTERVAL_S) + 1, std::numeric_limits<double>::quiet_NaN());
+
+    auto const index = [this](QDateTime const &time) {
+        return static_cast<size_t>((time.toSecsSinceEpoch() - _start_s) / INTERVAL_S);
+    };
+
+    for (auto const &block : blocks.blocks()) {
+        auto const &prices = block.prices;
+        for (auto i = 0; i < prices.size(); ++i) {
+            // repeated prices are not real prices and the intervals are left without a price
+            if (!prices.at(i).observed) {
+                continue;
+            }
+
+            // a price is valid until the next price in the same block or the end of the block
+            auto const from = index(prices.at(i).time);
+            auto const to   = i + 1 < prices.size() ? index(prices.at(i + 1).time) : index(block.end_time) + 1;
+            for (auto j = from; j < to && j < _prices.size(); ++j) {
+                _prices[j] = prices.at(i).price / KWH_IN_MWH;
+            }
+        }
+    }
+}
+
+auto PriceTable::get_price(QDateTime const &time) const -> std::optional<double>
+{
+    auto const s = time.toSecsSinceEpoch();
+    if (_prices.empty() || s < _start_s) {
+        return {};
+    }
+
+    auto const i = static_cast<size_t>((s - _start_s) / INTERVAL_S);
+    if (i >= _prices.size() || std::isnan(_prices[i])) {
+        return {};
+    }
+
+    return _prices[i];
+}
+
+auto PriceTable::get_price(QDateTime const &start, QDateTime const &end) const -> std::optional<double>
+{
+    auto const s = start.toSecsSinceEpoch();
+    auto const e = end.toSecsSinceEpoch();
+    if (_prices.empty() || s < _start_s || e < s) {
+        return {};
+    }
+
+    auto const first = static_cast<size_t>((s - _start_s) / INTERVAL_S);
+    auto const last  = static_cast<size_t>((e - _start_s) / INTERVAL_S);
+    if (last >= _prices.size()) {
+        return {};
+    }
+
+    double sum = 0.0;
+    for (auto i = first; i <= last; ++i) {
+        if (std::isnan(_prices[i])) {
+            return {};
+        }
+        sum += _prices[i];
+    }
+
+    return sum / static_cast<double>(last - first + 1);
+}
+
+} // namespace El
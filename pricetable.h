@@ -0,0 +1,58 @@
+#pragma once
+
+#ifndef EL_PRICETABLE_H_INCLUDED
+#  define EL_PRICETABLE_H_INCLUDED
+
+#include <QtGlobal>
+
+#include <optional>
+#include <vector>
+
+QT_FORWARD_DECLARE_CLASS(QDateTime)
+
+namespace El {
+
+class PriceBlocks;
+
+/// Read-only prices with constant time lookups
+///
+/// Built once from loaded price blocks and never modified after that, so that any number of
+/// threads can look up prices at the same time without locking. Lookups return the same prices
+/// as `Prices::get_price()` for the interval start times of consumption records. Prices of any
+/// native resolution are spread over the price intervals (`INTERVAL_S`) that they cover.
+class PriceTable {
+public:
+
+    /// Ctor
+    /// @param[in] blocks Prices (EUR/MWh) without taxes
+    explicit PriceTable(PriceBlocks const &blocks);
+
+    /// Returns true if there are no prices
+    auto empty() const noexcept { return _prices.empty(); }
+
+    /// Get the price in Euros for one kWh for the given time
+    /// @param[in] time The date/time
+    /// @return The price or an empty value
+    auto get_price(QDateTime const &time) const -> std::optional<double>;
+
+    /// Get the average price in Euros for one kWh for the given time period
+    ///
+    /// Used for consumption records that are longer than price intervals, like hourly records
+    /// with 15-minute prices. The consumption is expected to be even within the period.
+    /// @param[in] start Start time of the period
+    /// @param[in] end End time of the period (inclusive)
+    /// @return The price or an empty value if any of the prices is missing
+    auto get_price(QDateTime const &start, QDateTime const &end) const -> std::optional<double>;
+
+private:
+
+    /// Start time of the first interval in seconds since the Epoch
+    qint64 _start_s = 0;
+
+    /// Prices EUR/kWh by interval; NaN if there is no price
+    std::vector<double> _prices;
+};
+
+} // namespace El
+
+#endif
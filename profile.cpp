@@ -0,0 +1,254 @@
+#include "profile.h"
+#include "common.h" // IWYU pragma: keep Needed for formatting Qt types
+
+#include <QFile>
+#include <QVector>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <sys/resource.h>
+
+namespace {
+
+/// Time when the process started; initialized before main()
+auto const origin = std::chrono::steady_clock::now();
+
+/// Names of counters in the summary and in the trace
+constexpr std::array<char const *, static_cast<std::size_t>(El::Profile::Counter::Count)> COUNTER_NAMES = {
+    "rows_parsed",
+    "rows_rejected",
+    "cache_hits",
+    "cache_misses",
+    "requests",
+    "bytes_downloaded",
+    "bytes_decoded",
+};
+
+/// One recorded phase
+struct Event {
+    char const *name;     ///< Name of the phase
+    qint64      start_us; ///< Start time
+    qint64      end_us;   ///< End time
+    int         tid;      ///< Thread number
+    int         id;       ///< Id of an asynchronous phase; 0 for phases that do not overlap
+    QString     detail;   ///< Optional details
+};
+
+std::mutex      events_mutex;
+QVector<Event>  events;
+std::atomic_int next_tid{1};
+std::atomic_int next_id{1};
+
+/// Returns a small number for the current thread; the main thread is usually 1
+auto thread_number() -> int
+{
+    thread_local int const tid = next_tid.fetch_add(1, std::memory_order_relaxed);
+    return tid;
+}
+
+/// Appends the string as a JSON string
+void append_string(fmt::memory_buffer &out, std::string_view value)
+{
+    out.push_back('"');
+    for (auto const c : value) {
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back(c);
+        }
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            fmt::format_to(std::back_inserter(out), "\\u{:04x}", static_cast<int>(c));
+        }
+        else {
+            out.push_back(c);
+        }
+    }
+    out.push_back('"');
+}
+
+} // namespace
+
+namespace El {
+
+void Profile::enable()
+{
+    _enabled.store(true, std::memory_order_relaxed);
+}
+
+auto Profile::now_us() noexcept -> qint64
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+auto Profile::peak_rss() noexcept -> qint64
+{
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return usage.ru_maxrss; // bytes
+#else
+    constexpr qint64 KIB = 1024;
+    return usage.ru_maxrss * KIB;
+#endif
+}
+
+void Profile::add(char const *name, qint64 start, QString const &detail, bool async)
+{
+    if (start < 0) {
+        return;
+    }
+
+    Event event{name, start, now_us(), thread_number(), async ? next_id.fetch_add(1) : 0, detail};
+
+    std::lock_guard const lock{events_mutex};
+    events.append(std::move(event));
+}
+
+void Profile::print_summary(std::FILE *file)
+{
+    // totals by phase in the order of the first occurrence
+    struct Total {
+        int    order = 0;
+        int    count = 0;
+        qint64 total = 0;
+        qint64 max   = 0;
+    };
+    std::map<std::string_view, Total> totals{};
+    {
+        std::lock_guard const lock{events_mutex};
+        for (auto const &e : events) {
+            auto &t = totals.try_emplace(e.name, Total{static_cast<int>(totals.size())}).first->second;
+            t.count += 1;
+            t.total += e.end_us - e.start_us;
+            t.max = std::max(t.max, e.end_us - e.start_us);
+        }
+    }
+    std::vector<std::pair<std::string_view, Total>> sorted{totals.cbegin(), totals.cend()};
+    std::sort(sorted.begin(), sorted.end(), [](auto const &a, auto const &b) { return a.second.order < b.second.order; });
+
+    constexpr double MS_IN_US = 1e-3;
+
+    fmt::memory_buffer out{};
+    auto               it = std::back_inserter(out);
+    fmt::format_to(it, "{:<28} {:>6} {:>12} {:>12}\n", "faas", "kordi", "kokku ms", "max ms");
+    for (auto const &[name, t] : sorted) {
+        fmt::format_to(it,
+                       "{:<28} {:>6} {:>12.3f} {:>12.3f}\n",
+                       name,
+                       t.count,
+                       static_cast<double>(t.total) * MS_IN_US,
+                       static_cast<double>(t.max) * MS_IN_US);
+    }
+    fmt::format_to(it, "\n");
+    for (std::size_t i = 0; i < COUNTER_NAMES.size(); ++i) {
+        fmt::format_to(it, "{:<28} {:>12}\n", COUNTER_NAMES.at(i), _counters.at(i).load(std::memory_order_relaxed));
+    }
+    fmt::format_to(it, "{:<28} {:>12}\n", "peak_rss_bytes", peak_rss());
+
+    std::fwrite(out.data(), 1, out.size(), file);
+}
+
+auto Profile::write_trace(QString const &filename) -> bool
+{
+    fmt::memory_buffer out{};
+    auto               it  = std::back_inserter(out);
+    auto const         pid = 1;
+
+    fmt::format_to(it, R"({{"displayTimeUnit":"ms","traceEvents":[)");
+    bool first = true;
+    auto next  = [&out, &first]() {
+        if (!first) {
+            out.push_back(',');
+        }
+        out.push_back('\n');
+        first = false;
+    };
+
+    qint64 end_us = 0;
+    {
+        std::lock_guard const lock{events_mutex};
+        for (auto const &e : events) {
+            end_us = std::max(end_us, e.end_us);
+
+            auto const detail = e.detail.toUtf8();
+            auto       args   = [&out, &it, &detail]() {
+                fmt::format_to(it, R"(,"args":{{"detail":)");
+                append_string(out, std::string_view{detail.constData(), static_cast<std::size_t>(detail.size())});
+                out.push_back('}');
+            };
+
+            // overlapping phases are pairs of asynchronous begin and end events
+            if (e.id != 0) {
+                for (auto const *ph : {"b", "e"}) {
+                    next();
+                    fmt::format_to(it, R"({{"name":)");
+                    append_string(out, e.name);
+                    fmt::format_to(it,
+                                   R"(,"cat":"async","ph":"{}","id":{},"ts":{},"pid":{},"tid":{})",
+                                   ph,
+                                   e.id,
+                                   *ph == 'b' ? e.start_us : e.end_us,
+                                   pid,
+                                   e.tid);
+                    if (*ph == 'b' && !detail.isEmpty()) {
+                        args();
+                    }
+                    out.push_back('}');
+                }
+                continue;
+            }
+
+            next();
+            fmt::format_to(it, R"({{"name":)");
+            append_string(out, e.name);
+            fmt::format_to(it,
+                           R"(,"cat":"phase","ph":"X","ts":{},"dur":{},"pid":{},"tid":{})",
+                           e.start_us,
+                           e.end_us - e.start_us,
+                           pid,
+                           e.tid);
+            if (!detail.isEmpty()) {
+                args();
+            }
+            out.push_back('}');
+        }
+    }
+
+    // final values of counters
+    for (std::size_t i = 0; i < COUNTER_NAMES.size(); ++i) {
+        next();
+        fmt::format_to(it,
+                       R"({{"name":"{}","ph":"C","ts":{},"pid":{},"args":{{"value":{}}}}})",
+                       COUNTER_NAMES.at(i),
+                       end_us,
+                       pid,
+                       _counters.at(i).load(std::memory_order_relaxed));
+    }
+    next();
+    fmt::format_to(it,
+                   R"({{"name":"peak_rss_bytes","ph":"C","ts":{},"pid":{},"args":{{"value":{}}}}})",
+                   end_us,
+                   pid,
+                   peak_rss());
+    fmt::format_to(it, "\n]}}\n");
+
+    QFile file{filename};
+    if (!file.open(QFile::WriteOnly | QFile::Truncate) ||
+        file.write(out.data(), static_cast<qint64>(out.size())) != static_cast<qint64>(out.size())) {
+        fmt::print(stderr, "ERROR: profiili faili {} kirjutamine ebaõnnestus: {}\n", filename, file.errorString());
+        return false;
+    }
+    return true;
+}
+
+} // namespace El
@@ -0,0 +1,123 @@
+#pragma once
+
+#ifndef EL_PROFILE_H_INCLUDED
+#  define EL_PROFILE_H_INCLUDED
+
+#include <QString>
+
+#include <array>
+#include <atomic>
+#include <cstdio>
+
+namespace El {
+
+/// Phase timings and counters of the process
+///
+/// Recording is disabled until `enable()` is called. While disabled, every instrumentation point
+/// costs one relaxed atomic load and a branch; nothing is allocated or timed.
+///
+/// Phases are measured with the monotonic clock in microseconds since the start of the process.
+/// Phases that start and finish in the same function are measured with `Scope`; phases that
+/// finish in an event handler (network requests) use `start()` and `add()` and may overlap.
+class Profile {
+public:
+
+    /// Counters
+    enum class Counter {
+        RowsParsed,      ///< Valid consumption records
+        RowsRejected,    ///< Invalid consumption records
+        CacheHits,       ///< Price requests answered by the cache
+        CacheMisses,     ///< Price requests not fully answered by the cache
+        Requests,        ///< Nord Pool network requests
+        BytesDownloaded, ///< Bytes of Nord Pool responses as transferred, before decompression
+        BytesDecoded,    ///< Bytes of Nord Pool responses after decompression
+        Count
+    };
+
+    /// Measures the phase from the construction until the destruction
+    class Scope {
+    public:
+
+        /// Ctor
+        /// @param[in] name Name of the phase; must be a string literal
+        Scope(char const *name) noexcept
+            : _start(Profile::start())
+            , _name(name)
+        {}
+
+        /// Dtor; records the phase
+        ~Scope()
+        {
+            if (_start >= 0) {
+                Profile::add(_name, _start);
+            }
+        }
+
+        /// Deleted move and copy operations
+        Scope(Scope const &other)                     = delete;
+        Scope(Scope &&other)                          = delete;
+        auto operator=(Scope const &other) -> Scope & = delete;
+        auto operator=(Scope &&other) -> Scope &      = delete;
+
+    private:
+
+        qint64      _start;
+        char const *_name;
+    };
+
+    /// Starts recording
+    static void enable();
+
+    /// Returns true if recording
+    static auto enabled() noexcept -> bool { return _enabled.load(std::memory_order_relaxed); }
+
+    /// Returns the start time of a phase for `add()`
+    /// @return Microseconds since the start of the process or -1 if not recording
+    static auto start() noexcept -> qint64 { return enabled() ? now_us() : -1; }
+
+    /// Records a phase that ends now
+    /// @param[in] name Name of the phase; must be a string literal
+    /// @param[in] start Start time returned by `start()`
+    /// @param[in] detail Optional details shown in the trace
+    /// @param[in] async True if the phase may overlap other phases on the same thread
+    static void add(char const *name, qint64 start, QString const &detail = {}, bool async = false);
+
+    /// Adds to the counter
+    /// @param[in] counter The counter
+    /// @param[in] n Value to add
+    static void count(Counter counter, qint64 n = 1) noexcept
+    {
+        if (enabled()) {
+            _counters.at(static_cast<std::size_t>(counter)).fetch_add(n, std::memory_order_relaxed);
+        }
+    }
+
+    /// Writes a table with the total time of every phase, counters and the peak RSS
+    /// @param[in] file Output file
+    static void print_summary(std::FILE *file);
+
+    /// Writes phases and counters in the Chrome trace event format
+    ///
+    /// The file can be opened in `chrome://tracing` or https://ui.perfetto.dev.
+    /// @param[in] filename Name of the file
+    /// @return true if succeeded, otherwise false
+    static auto write_trace(QString const &filename) -> bool;
+
+private:
+
+    /// Flag indicating that phases and counters are recorded
+    static inline std::atomic<bool> _enabled{false};
+
+    /// Counter values
+    static inline std::array<std::atomic<qint64>, static_cast<std::size_t>(Counter::Count)> _counters{};
+
+    /// Returns microseconds since the start of the process
+    static auto now_us() noexcept -> qint64;
+
+    /// Returns the peak resident set size in bytes or 0 if not known
+    static auto peak_rss() noexcept -> qint64;
+};
+
+} // namespace El
+
+#endif
@@ -1,6 +1,6 @@
 #include "record.h"
 
-#include "args.h"
+#include "common.h"
 #include "header.h"
 
 #include <QByteArray>
@@ -44,7 +44,7 @@ auto Record::process(int lineno, QByteArray const &line, Header const &hdr) -> b
         }
     }
     else {
-        _end = _begin.addSecs(Args::instance().interval() - 1);
+        _end = _begin.addSecs(INTERVAL_S - 1);
     }
 
     // kWh
@@ -60,38 +60,61 @@ auto Record::process(int lineno, QByteArray const &line, Header const &hdr) -> b
         return false;
     }
 
-    if (hdr.idxConsumptionType() < 0) {
-        constexpr int NIGHT_START = 23;
-        constexpr int NIGHT_END   = 7;
-        QDateTime nightStart(_begin.date(), QTime(NIGHT_START, 0));
-        QDateTime nightEnd(_begin.date().addDays(1), QTime(NIGHT_END, 0));
-        if (_begin.time() < QTime(NIGHT_END, 0)) {
-            nightStart = nightStart.addDays(-1);
-            nightEnd   = nightEnd.addDays(-1);
+    // Exported kWh; an empty field is no export
+    _exported = 0.0;
+    for (auto const &channel : hdr.channels()) {
+        auto const &field = fields.at(channel.idx);
+        if (channel.type != Channel::Type::Export || field.isEmpty()) {
+            continue;
         }
-        if (_begin.isDaylightTime()) {
-            constexpr int NIGHT_START_DST = 0;
-            constexpr int NIGHT_END_DST = 8;
-            nightStart = QDateTime(_begin.date(), QTime(NIGHT_START_DST, 0));
-            nightEnd   = QDateTime(_begin.date(), QTime(NIGHT_END_DST, 0));
-            if (_begin.time() >= QTime(NIGHT_END_DST, 0)) {
-                nightStart = nightStart.addDays(1);
-                nightEnd   = nightEnd.addDays(1);
-            }
+        auto value = locale.toDouble(field, &ok);
+        if (!ok) {
+            value = field.toDouble(&ok);
         }
-
-        constexpr int DOW_SAT = 6;
-        constexpr int DOW_SUN = 7;
-        if (_begin.date().dayOfWeek() == DOW_SAT || _begin.date().dayOfWeek() == DOW_SUN ||
-            (_begin >= nightStart && _end < nightEnd)) {
-            _night = true;
+        if (!ok) {
+            fmt::print("WARNING: Invalid export value on line #{}\n", lineno);
+            return false;
         }
+        _exported += value;
+    }
+
+    if (hdr.idxConsumptionType() < 0) {
+        _night = isNightTime(_begin, _end);
     }
     else {
-        _night = QString::fromUtf8(fields.at(hdr.idxConsumptionType())).contains(u"öö"_s, Qt::CaseInsensitive);
+        auto const type = QString::fromUtf8(fields.at(hdr.idxConsumptionType()));
+        _night          = type.contains(u"öö"_s, Qt::CaseInsensitive);
+        _peak           = type.contains(u"tipp"_s, Qt::CaseInsensitive);
     }
 
     return true;
 }
 
+auto Record::isNightTime(QDateTime const &begin, QDateTime const &end) -> bool
+{
+    constexpr int NIGHT_START = 23;
+    constexpr int NIGHT_END   = 7;
+    QDateTime nightStart(begin.date(), QTime(NIGHT_START, 0));
+    QDateTime nightEnd(begin.date().addDays(1), QTime(NIGHT_END, 0));
+    if (begin.time() < QTime(NIGHT_END, 0)) {
+        nightStart = nightStart.addDays(-1);
+        nightEnd   = nightEnd.addDays(-1);
+    }
+    if (begin.isDaylightTime()) {
+        constexpr int NIGHT_START_DST = 0;
+        constexpr int NIGHT_END_DST = 8;
+        nightStart = QDateTime(begin.date(), QTime(NIGHT_START_DST, 0));
+        nightEnd   = QDateTime(begin.date(), QTime(NIGHT_END_DST, 0));
+        if (begin.time() >= QTime(NIGHT_END_DST, 0)) {
+            nightStart = nightStart.addDays(1);
+            nightEnd   = nightEnd.addDays(1);
+        }
+    }
+
+    constexpr int DOW_SAT = 6;
+    constexpr int DOW_SUN = 7;
+    return begin.date().dayOfWeek() == DOW_SAT || begin.date().dayOfWeek() == DOW_SUN ||
+           (begin >= nightStart && end < nightEnd);
+}
+
 } // namespace El
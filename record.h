@@ -5,6 +5,8 @@
 
 #include <QDateTime>
 
+#include <utility>
+
 QT_FORWARD_DECLARE_CLASS(QByteArray)
 
 namespace El {
@@ -15,7 +17,28 @@ class Header;
 class Record {
 public:
 
+    /// Default ctor creates an invalid record
+    Record() = default;
+
     Record(int lineno, QByteArray const &line, Header const &hdr);
+
+    /// Ctor for a record that is already parsed
+    /// @param[in] begin Start time
+    /// @param[in] end End time
+    /// @param[in] kWh Amount consumed kWh
+    /// @param[in] night true if this is a night-time record
+    /// @param[in] peak true if this is a peak-time record of the 4-zone tariff
+    /// @param[in] exported Amount exported to the grid kWh
+    Record(QDateTime begin, QDateTime end, double kWh, bool night, bool peak = false, double exported = 0.0)
+        : _valid(true)
+        , _begin(std::move(begin))
+        , _end(std::move(end))
+        , _kWh(kWh)
+        , _exported(exported)
+        , _night(night)
+        , _peak(peak)
+    {}
+
     Record(Record const &other) = default;
     Record(Record &&other)      = default;
 
@@ -29,6 +52,12 @@ public:
     /// Returns true if this is night-time record
     auto isNight() const noexcept { return _night; }
 
+    /// Returns true if this is a peak-time record ("Tipp päev" or "Tipp öö")
+    ///
+    /// Only files with the consumption type column of the 4-zone tariff have peak-time records.
+    /// Peak-time records are also day or night-time records of the 2-zone tariff.
+    auto isPeak() const noexcept { return _peak; }
+
     /// Returns the start time of the record
     auto startTime() const noexcept -> auto const & { return _begin; }
 
@@ -38,13 +67,27 @@ public:
     /// Returns the amount consumed in this time period in kWh
     auto kWh() const noexcept -> auto { return _kWh; }
 
+    /// Returns the amount exported to the grid in this time period in kWh
+    ///
+    /// The sum of all the export channels of the file; 0 if the file has no export channels.
+    auto exportedKWh() const noexcept -> auto { return _exported; }
+
+    /// Returns true if the time period is in the night-time tariff
+    ///
+    /// Used for files without the consumption type column; weekends are night-time.
+    /// @param[in] begin Start time
+    /// @param[in] end End time
+    static auto isNightTime(QDateTime const &begin, QDateTime const &end) -> bool;
+
 private:
 
     bool      _valid = false;
     QDateTime _begin;
     QDateTime _end;
-    double    _kWh   = 0.0;
-    bool      _night = false;
+    double    _kWh      = 0.0;
+    double    _exported = 0.0;
+    bool      _night    = false;
+    bool      _peak     = false;
 
     /// Processes the input line
     /// @param[in] lineno Line number
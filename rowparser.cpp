@@ -0,0 +1,260 @@
+#include "rowparser.h"
+#include "common.h"
+#include "header.h"
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QLocale>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace {
+
+/// Returns the value of two decimal digits; sets `bad` if they are not digits
+constexpr auto digits2(char const *p, unsigned &bad) -> int
+{
+    auto const a = static_cast<unsigned>(p[0] - '0');
+    auto const b = static_cast<unsigned>(p[1] - '0');
+    bad |= static_cast<unsigned>(a > 9) | static_cast<unsigned>(b > 9);
+    return static_cast<int>(a * 10 + b);
+}
+
+/// Parses a local time in the format "dd.MM.yyyy hh:mm"
+/// @param[in] s The field
+/// @return The time; invalid if the field is not a valid time
+auto parse_time(QByteArrayView s) -> QDateTime
+{
+    constexpr qsizetype LENGTH = 16;
+    if (s.size() != LENGTH || s[2] != '.' || s[5] != '.' || s[10] != ' ' || s[13] != ':') {
+        return {};
+    }
+
+    auto const *p   = s.data();
+    unsigned    bad = 0;
+    auto const  day = digits2(p, bad);
+    auto const  mon = digits2(p + 3, bad);
+    auto const  yr  = digits2(p + 6, bad) * 100 + digits2(p + 8, bad);
+    auto const  hr  = digits2(p + 11, bad);
+    auto const  min = digits2(p + 14, bad);
+    if (bad != 0 || !QDate::isValid(yr, mon, day) || !QTime::isValid(hr, min, 0)) {
+        return {};
+    }
+
+    return QDateTime{QDate{yr, mon, day}, QTime{hr, min}};
+}
+
+/// Parses a decimal number with a comma or a dot as the decimal separator
+/// @param[in] s The field
+/// @param[out] ok Set to true if succeeded
+/// @return The number
+auto parse_number(QByteArrayView s, bool &ok) -> double
+{
+    // up to 15 significant digits are exact in a double, so that the quotient is correctly rounded
+    constexpr int MAX_DIGITS = 15;
+
+    constexpr std::array<double, MAX_DIGITS + 1> POW10 = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+
+    auto const *p   = s.data();
+    auto const *end = p + s.size();
+
+    auto const negative = p != end && *p == '-';
+    p += static_cast<int>(negative);
+
+    qint64 mantissa = 0;
+    int    digits   = 0;
+    int    decimals = 0;
+    bool   point    = false;
+    for (; p != end; ++p) {
+        auto const d = static_cast<unsigned>(*p - '0');
+        if (d <= 9) {
+            mantissa = mantissa * 10 + d;
+            ++digits;
+            decimals += static_cast<int>(point);
+        }
+        else if ((*p == ',' || *p == '.') && !point) {
+            point = true;
+        }
+        else {
+            break;
+        }
+    }
+
+    ok = p == end && digits > 0 && digits <= MAX_DIGITS;
+    if (!ok) {
+        return 0.0;
+    }
+
+    auto const value = static_cast<double>(mantissa) / POW10.at(decimals);
+    return negative ? -value : value;
+}
+
+/// Parses a number with `parse_number()` and falls back to the locale for group separators
+/// @param[in] s The field
+/// @param[out] ok Set to true if succeeded
+/// @return The number
+auto parse_value(QByteArrayView s, bool &ok) -> double
+{
+    auto result = parse_number(s, ok);
+    if (!ok) {
+        auto const value = s.toByteArray();
+        result           = QLocale{QLocale::Estonian, QLocale::Estonia}.toDouble(value, &ok);
+        if (!ok) {
+            result = value.toDouble(&ok);
+        }
+    }
+    return result;
+}
+
+/// Returns true if the consumption type is night ("Öö" in any case)
+auto is_night(QByteArrayView s) -> bool
+{
+    // 'ö' and 'Ö' are 0xC3 0xB6 and 0xC3 0x96 in UTF-8
+    auto const *p = reinterpret_cast<unsigned char const *>(s.data());
+    for (qsizetype i = 0; i + 3 < s.size(); ++i) {
+        if (p[i] == 0xC3 && (p[i + 1] | 0x20) == 0xB6 && p[i + 2] == 0xC3 && (p[i + 3] | 0x20) == 0xB6) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Returns true if the consumption type is peak time ("Tipp" in any case)
+auto is_peak(QByteArrayView s) -> bool
+{
+    constexpr char LOWER = 0x20;
+    for (qsizetype i = 0; i + 3 < s.size(); ++i) {
+        if ((s[i] | LOWER) == 't' && (s[i + 1] | LOWER) == 'i' && (s[i + 2] | LOWER) == 'p' && (s[i + 3] | LOWER) == 'p') {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+namespace El {
+
+RowParser::RowParser(Header const &hdr)
+{
+    if (!hdr.isValid()) {
+        return;
+    }
+
+    _columns.num_fields  = hdr.numFields();
+    _columns.start       = hdr.idxStartTime();
+    _columns.end         = hdr.idxEndTime();
+    _columns.consumption = hdr.idxConsumption();
+    _columns.type        = hdr.idxConsumptionType();
+    _columns.last        = std::max({_columns.start, _columns.end, _columns.consumption, _columns.type});
+    for (auto const &channel : hdr.channels()) {
+        if (channel.type != Channel::Type::Export) {
+            continue;
+        }
+        if (_columns.num_exports >= MAX_EXPORTS) {
+            return;
+        }
+        _columns.exports.at(static_cast<size_t>(_columns.num_exports++)) = channel.idx;
+        _columns.last = std::max(_columns.last, channel.idx);
+    }
+    if (_columns.last >= MAX_COLUMNS) {
+        return;
+    }
+
+    auto const has_end  = _columns.end >= 0;
+    auto const has_type = _columns.type >= 0;
+    if (has_end) {
+        _parse = has_type ? &RowParser::parse<true, true> : &RowParser::parse<true, false>;
+    }
+    else {
+        _parse = has_type ? &RowParser::parse<false, true> : &RowParser::parse<false, false>;
+    }
+}
+
+template <bool HAS_END, bool HAS_TYPE>
+auto RowParser::parse(Columns const &columns, int lineno, QByteArray const &line) -> Record
+{
+    constexpr int SECS_IN_MIN = 60;
+
+    // split the line up to the last needed column
+    std::array<QByteArrayView, MAX_COLUMNS> fields{};
+    auto const *p    = line.constData();
+    auto const *end  = p + line.size();
+    qsizetype   n    = 0;
+    bool        more = true;
+    while (more && n <= columns.last) {
+        auto const *sep = static_cast<char const *>(std::memchr(p, ';', end - p));
+        more            = sep != nullptr;
+        fields[n++]     = QByteArrayView{p, (more ? sep : end) - p};
+        p               = more ? sep + 1 : end;
+    }
+
+    // the remaining fields are only counted
+    if (more) {
+        n += std::count(p, end, ';') + 1;
+    }
+    if (n < columns.num_fields) {
+        fmt::print("WARNING: Invalid number of fields on line #{}\n", lineno);
+        return {};
+    }
+
+    // Start time
+    auto begin = parse_time(fields[columns.start]);
+    if (!begin.isValid()) {
+        fmt::print("WARNING: Invalid start time on line #{}\n", lineno);
+        return {};
+    }
+
+    // End time
+    QDateTime finish{};
+    if constexpr (HAS_END) {
+        finish = parse_time(fields[columns.end]).addSecs(-SECS_IN_MIN);
+        if (!finish.isValid()) {
+            fmt::print("WARNING: Invalid end time on line #{}\n", lineno);
+            return {};
+        }
+    }
+    else {
+        finish = begin.addSecs(INTERVAL_S - 1);
+    }
+
+    // kWh; values with group separators are parsed with the locale
+    bool       ok  = false;
+    auto const kwh = parse_value(fields[columns.consumption], ok);
+    if (!ok) {
+        fmt::print("WARNING: Invalid consumption value on line #{}\n", lineno);
+        return {};
+    }
+
+    // exported kWh of all the export channels; an empty field is no export
+    double exported = 0.0;
+    for (qsizetype i = 0; i < columns.num_exports; ++i) {
+        auto const field = fields[columns.exports[static_cast<size_t>(i)]];
+        if (field.isEmpty()) {
+            continue;
+        }
+        exported += parse_value(field, ok);
+        if (!ok) {
+            fmt::print("WARNING: Invalid export value on line #{}\n", lineno);
+            return {};
+        }
+    }
+
+    bool night = false;
+    bool peak  = false;
+    if constexpr (HAS_TYPE) {
+        night = is_night(fields[columns.type]);
+        peak  = is_peak(fields[columns.type]);
+    }
+    else {
+        night = Record::isNightTime(begin, finish);
+    }
+
+    return Record{std::move(begin), std::move(finish), kwh, night, peak, exported};
+}
+
+} // namespace El
@@ -0,0 +1,79 @@
+#pragma once
+
+#ifndef EL_ROWPARSER_H_INCLUDED
+#  define EL_ROWPARSER_H_INCLUDED
+
+#include "record.h"
+
+#include <QtTypes>
+
+#include <array>
+
+QT_FORWARD_DECLARE_CLASS(QByteArray)
+
+namespace El {
+
+class Header;
+
+/// Parser for the rows of one CSV layout
+///
+/// The layouts recognized by `Header` differ by the optional end time and consumption type
+/// columns and by the order of the columns. The layout is resolved once per file into a parse
+/// function that is specialized at compile time for the optional columns, so that parsing a row
+/// does not check the layout again, splits the line only up to the last needed column and does
+/// not allocate. Produces the same records as `Record(lineno, line, hdr)`;
+/// `elekter_bench --check` compares the two.
+class RowParser {
+public:
+
+    /// Maximum index of a needed column; files with more leading columns use `Record` directly
+    static constexpr qsizetype MAX_COLUMNS = 16;
+
+    /// Maximum number of export channels; files with more export columns use `Record` directly
+    static constexpr qsizetype MAX_EXPORTS = 4;
+
+    /// Default ctor creates an invalid parser
+    RowParser() = default;
+
+    /// Ctor
+    /// @param[in] hdr The header information
+    explicit RowParser(Header const &hdr);
+
+    /// Returns true if the layout is supported
+    auto isValid() const noexcept { return _parse != nullptr; }
+
+    /// Parses one row
+    /// @param[in] lineno Line number
+    /// @param[in] line Input line
+    /// @return The record; invalid if the row has errors
+    auto parse(int lineno, QByteArray const &line) const -> Record { return _parse(_columns, lineno, line); }
+
+private:
+
+    /// Column indices of the layout
+    struct Columns {
+        qsizetype num_fields  = 0;  ///< Expected number of fields
+        qsizetype start       = -1; ///< Start time
+        qsizetype end         = -1; ///< End time (-1 if not used)
+        qsizetype consumption = -1; ///< Consumption
+        qsizetype type        = -1; ///< Consumption type (-1 if not used)
+        qsizetype last        = -1; ///< The last needed column
+
+        std::array<qsizetype, MAX_EXPORTS> exports{};    ///< Export channels
+        qsizetype                          num_exports{}; ///< Number of export channels
+    };
+
+    /// Parse function of a layout
+    using Parse = Record (*)(Columns const &columns, int lineno, QByteArray const &line);
+
+    Columns _columns;
+    Parse   _parse = nullptr;
+
+    /// Parses one row of a layout with or without the end time and consumption type columns
+    template <bool HAS_END, bool HAS_TYPE>
+    static auto parse(Columns const &columns, int lineno, QByteArray const &line) -> Record;
+};
+
+} // namespace El
+
+#endif // EL_ROWPARSER_H_INCLUDED
@@ -0,0 +1,325 @@
+#include "server.h"
+#include "common.h"
+#include "consumption.h"
+#include "engine.h"
+#include "options.h"
+#include "prices.h"
+#include "pricetable.h"
+
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QtConcurrent>
+
+#include <fmt/base.h>
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+/// Appends the string as a JSON string; the values used here need no escaping
+void append_string(fmt::memory_buffer &out, QString const &value)
+{
+    fmt::format_to(std::back_inserter(out), "\"{}\"", value);
+}
+
+} // namespace
+
+namespace El {
+
+Server::Server(Options const &options, QObject *parent)
+    : QObject(parent)
+    , _options(options)
+    , _server(new QLocalServer{this})
+    , _watcher(new QFileSystemWatcher{this})
+    , _reload_timer(new QTimer{this})
+{
+    _reload_timer->setSingleShot(true);
+    _reload_timer->setInterval(RELOAD_DELAY_MS);
+    connect(_reload_timer, &QTimer::timeout, this, &Server::reload);
+    connect(_watcher, &QFileSystemWatcher::fileChanged, _reload_timer, qOverload<>(&QTimer::start));
+    connect(_server, &QLocalServer::newConnection, this, &Server::new_connection);
+}
+
+Server::~Server()
+{
+    // the worker thread uses consumption records
+    _parsing.waitForFinished();
+}
+
+auto Server::start() -> bool
+{
+    using namespace Qt::Literals::StringLiterals;
+
+    auto name = _options.socket_name;
+    if (name.isEmpty()) {
+        auto dir = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+        if (dir.isEmpty()) {
+            dir = QStandardPaths::writableLocation(QStandardPaths::TempLocation);
+        }
+        name = dir + u"/elekter.sock"_s;
+    }
+
+    // a socket file left behind by a crashed server prevents listening
+    QLocalServer::removeServer(name);
+    _server->setSocketOptions(QLocalServer::UserAccessOption);
+    if (!_server->listen(name)) {
+        fmt::print(stderr, "ERROR: kohaliku sokli {} avamine ebaõnnestus: {}\n", name, _server->errorString());
+        return false;
+    }
+    if (_options.verbose) {
+        fmt::print("Ootan päringuid soklis {}\n", _server->fullServerName());
+    }
+
+    if (_options.prices) {
+        _prices = std::make_unique<Prices>(_options);
+        connect(_prices.get(), &Prices::loaded, this, &Server::prices_loaded);
+    }
+
+    _watcher->addPath(_options.file_name);
+    reload();
+    return true;
+}
+
+void Server::reload()
+{
+    // files that are replaced instead of modified are no longer watched
+    if (!_watcher->files().contains(_options.file_name) && QFileInfo::exists(_options.file_name)) {
+        _watcher->addPath(_options.file_name);
+    }
+
+    if (_next) {
+        _reload_pending = true;
+        return;
+    }
+    _reload_pending = false;
+
+    // records up to now unless the time is given on the command line
+    auto const end = _options.fixed_time ? _options.time : QDateTime::currentDateTime();
+
+    _next    = std::make_shared<Consumption>();
+    _parsing = QtConcurrent::run([consumption = _next, filename = _options.file_name, end]() {
+        return consumption->load(filename, end);
+    });
+    _parsing.then(this, [this](bool ok) { parsed(ok); });
+}
+
+void Server::parsed(bool ok)
+{
+    if (!ok) {
+        fmt::print(stderr, "WARNING: CSV faili laadimine ebaõnnestus, kasutan eelmisi andmeid\n");
+        _next.reset();
+        if (_reload_pending) {
+            reload();
+        }
+        return;
+    }
+
+    if (_prices) {
+        _prices->load(_options.region(), _next->first_record_time(), _next->last_record_time());
+        return;
+    }
+
+    build_index();
+}
+
+void Server::prices_loaded(bool ok)
+{
+    if (!ok) {
+        fmt::print(stderr, "WARNING: kõiki hindasid ei õnnestunud laadida\n");
+    }
+    build_index();
+}
+
+void Server::build_index()
+{
+    auto const &records = _next->records();
+    auto const  table   = _prices ? _prices->snapshot() : nullptr;
+
+    QVector<qint64>  times{};
+    QVector<Summary> totals{};
+    times.reserve(records.size());
+    totals.reserve(records.size() + 1);
+
+    Summary running{};
+    totals.append(running);
+    for (auto const &rec : records) {
+        times.append(rec.startTime().toSecsSinceEpoch());
+        Engine::add_record(running, rec, table.get(), _options);
+        totals.append(running);
+    }
+
+    _start  = records.first().startTime();
+    _end    = records.last().endTime();
+    _times  = std::move(times);
+    _totals = std::move(totals);
+    _ready  = true;
+
+    if (_options.verbose) {
+        fmt::print("Laadisin {} kirjet perioodile {} ... {}\n", records.size(), _start, _end);
+    }
+
+    _next.reset();
+    if (_reload_pending) {
+        reload();
+    }
+}
+
+void Server::new_connection()
+{
+    while (auto *socket = _server->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { read_requests(socket); });
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+    }
+}
+
+void Server::read_requests(QLocalSocket *socket)
+{
+    fmt::memory_buffer out{};
+
+    while (socket->canReadLine()) {
+        answer(socket->readLine(MAX_REQUEST_SIZE).trimmed(), out);
+        out.push_back('\n');
+    }
+
+    // a request without a line end that does not fit into the buffer
+    if (socket->bytesAvailable() > MAX_REQUEST_SIZE) {
+        socket->disconnectFromServer();
+        return;
+    }
+
+    if (out.size() > 0) {
+        socket->write(out.data(), static_cast<qint64>(out.size()));
+    }
+}
+
+void Server::answer(QByteArray const &request, fmt::memory_buffer &out) const
+{
+    auto error = [&out](char const *msg) { fmt::format_to(std::back_inserter(out), R"({{"error":"{}"}})", msg); };
+
+    auto const parts = request.simplified().split(' ');
+    auto const &cmd  = parts.at(0);
+
+    if (!_ready) {
+        error("andmed ei ole veel laaditud");
+        return;
+    }
+
+    if (cmd == "summary" && parts.size() == 1) {
+        append_totals(out, _start, _end);
+        return;
+    }
+
+    if (cmd == "range" && parts.size() == 3) {
+        auto const start = parse_time(parts.at(1));
+        auto const end   = parse_time(parts.at(2));
+        if (!start.isValid() || !end.isValid()) {
+            error("vigane aeg");
+            return;
+        }
+        append_totals(out, start, end);
+        return;
+    }
+
+    if (cmd == "rollup" && (parts.size() == 2 || parts.size() == 4)) {
+        auto const &unit = parts.at(1);
+        if (unit != "day" && unit != "month" && unit != "year") {
+            error("tundmatu periood");
+            return;
+        }
+
+        auto start = parts.size() == 4 ? parse_time(parts.at(2)) : _start;
+        auto end   = parts.size() == 4 ? parse_time(parts.at(3)) : _end;
+        if (!start.isValid() || !end.isValid()) {
+            error("vigane aeg");
+            return;
+        }
+
+        // there are no records outside the loaded period
+        start = std::max(start, _start);
+        end   = std::min(end, _end);
+
+        // align the first period with the start of the day, month or year
+        auto date = start.date();
+        if (unit != "day") {
+            date = QDate{date.year(), unit == "month" ? date.month() : 1, 1};
+        }
+
+        auto const size    = out.size();
+        int        periods = 0;
+        out.push_back('[');
+        for (QDateTime t{date, QTime{0, 0}}; t < end;) {
+            if (++periods > MAX_ROLLUP_PERIODS) {
+                out.resize(size);
+                error("liiga palju perioode");
+                return;
+            }
+            auto const next = unit == "day" ? t.addDays(1) : unit == "month" ? t.addMonths(1) : t.addYears(1);
+            if (t.date() != date) {
+                out.push_back(',');
+            }
+            append_totals(out, t, next);
+            t = next;
+        }
+        out.push_back(']');
+        return;
+    }
+
+    error("tundmatu päring");
+}
+
+auto Server::totals(QDateTime const &start, QDateTime const &end) const -> Summary
+{
+    auto const first = std::lower_bound(_times.cbegin(), _times.cend(), start.toSecsSinceEpoch());
+    auto const last  = std::lower_bound(first, _times.cend(), end.toSecsSinceEpoch());
+
+    return _totals.at(std::distance(_times.cbegin(), last)) - _totals.at(std::distance(_times.cbegin(), first));
+}
+
+void Server::append_totals(fmt::memory_buffer &out, QDateTime const &start, QDateTime const &end) const
+{
+    auto const s  = end > start ? totals(start, end) : Summary{};
+    auto       it = std::back_inserter(out);
+
+    fmt::format_to(it, R"({{"start":)");
+    append_string(out, start.toString(Qt::ISODate));
+    fmt::format_to(it, R"(,"end":)");
+    append_string(out, end.toString(Qt::ISODate));
+    fmt::format_to(it,
+                   R"(,"records":{},"night_kwh":{},"day_kwh":{},"total_kwh":{})",
+                   s.records,
+                   s.night_kwh(),
+                   s.day_kwh(),
+                   s.total_kwh());
+    fmt::format_to(it, R"(,"export_kwh":{},"net_kwh":{})", s.export_kwh(), s.net_kwh());
+    if (_prices) {
+        auto const total_eur  = to_eur(with_vat(s.total_cost(), _options.km));
+        auto const export_eur = to_eur(s.export_revenue);
+        fmt::format_to(it,
+                       R"(,"night_eur":{},"day_eur":{},"total_eur":{},"export_eur":{},"net_eur":{},"missing_prices":{})",
+                       to_eur(with_vat(s.night_cost, _options.km)),
+                       to_eur(with_vat(s.day_cost, _options.km)),
+                       total_eur,
+                       export_eur,
+                       total_eur - export_eur,
+                       s.missing);
+    }
+    out.push_back('}');
+}
+
+auto Server::parse_time(QByteArray const &value) -> QDateTime
+{
+    using namespace Qt::Literals::StringLiterals;
+
+    auto const s = QString::fromLatin1(value);
+    if (s.size() == 10) {
+        return QDateTime{QDate::fromString(s, Qt::ISODate), QTime{0, 0}};
+    }
+    return QDateTime::fromString(s, u"yyyy-MM-ddThh:mm"_s);
+}
+
+} // namespace El
@@ -0,0 +1,157 @@
+#pragma once
+
+#ifndef EL_SERVER_H_INCLUDED
+#  define EL_SERVER_H_INCLUDED
+
+#include "summary.h"
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QFuture>
+#include <QObject>
+#include <QVector>
+
+#include <fmt/format.h>
+
+#include <memory>
+
+QT_FORWARD_DECLARE_CLASS(QFileSystemWatcher)
+QT_FORWARD_DECLARE_CLASS(QLocalServer)
+QT_FORWARD_DECLARE_CLASS(QLocalSocket)
+QT_FORWARD_DECLARE_CLASS(QTimer)
+
+namespace El {
+
+class Consumption;
+class Prices;
+struct Options;
+
+/// Server that keeps consumption records and prices in memory and answers queries
+///
+/// Listens on a local socket. Every request is one line and every response is one line of JSON:
+///
+/// - `summary` — totals for all the records
+/// - `range <start> <end>` — totals for records starting in [start, end)
+/// - `rollup day|month|year [<start> <end>]` — totals for every day, month or year; the time
+///   period is limited to the loaded records and to `MAX_ROLLUP_PERIODS` periods
+///
+/// Times are `yyyy-MM-dd` or `yyyy-MM-ddThh:mm`. Totals are the same as in the summary of the
+/// command line tool; costs are with the margin and VAT, export revenues are without them.
+/// Running totals are computed when the data is loaded, so that every query needs only two
+/// binary searches per period.
+///
+/// The CSV file is loaded again when it changes. Queries are answered with the previous data
+/// until the new records and prices are ready.
+class Server : public QObject {
+    Q_OBJECT
+
+public:
+
+    /// Delay before loading a changed file; editors and downloads write files in several steps
+    static constexpr int RELOAD_DELAY_MS = 500;
+
+    /// Maximum length of one request
+    static constexpr int MAX_REQUEST_SIZE = 4096;
+
+    /// Maximum number of periods in one rollup response; requests are answered synchronously
+    static constexpr int MAX_ROLLUP_PERIODS = 10000;
+
+    /// Ctor
+    /// @param[in] options Engine options
+    /// @param[in] parent Optional parent
+    Server(Options const &options, QObject *parent = nullptr);
+
+    /// Dtor
+    ~Server() override;
+
+    /// Starts listening and loading data
+    /// @return true if succeeded, otherwise false
+    auto start() -> bool;
+
+private:
+
+    /// Engine options
+    Options const &_options;
+
+    /// Local socket server
+    QLocalServer *_server = nullptr;
+
+    /// Watcher for the CSV file
+    QFileSystemWatcher *_watcher = nullptr;
+
+    /// Timer that delays loading changed files
+    QTimer *_reload_timer = nullptr;
+
+    /// Nord Pool prices (if requested)
+    std::unique_ptr<Prices> _prices;
+
+    /// Consumption records being loaded
+    std::shared_ptr<Consumption> _next;
+
+    /// Parsing the CSV file in a worker thread
+    QFuture<bool> _parsing;
+
+    /// Flag indicating that the file changed while it was being loaded
+    bool _reload_pending = false;
+
+    /// Flag indicating that data is loaded
+    bool _ready = false;
+
+    /// Start time of the first record
+    QDateTime _start;
+
+    /// End time of the last record
+    QDateTime _end;
+
+    /// Start times of records in seconds since the Epoch
+    QVector<qint64> _times;
+
+    /// Running totals; `_totals[i]` is the total of records before the record `i`
+    QVector<Summary> _totals;
+
+    /// Starts loading the CSV file unless it is already being loaded
+    void reload();
+
+    /// Called when the CSV file is parsed
+    /// @param[in] ok true if succeeded, otherwise false
+    void parsed(bool ok);
+
+    /// Called when prices for the records are loaded
+    /// @param[in] ok true if succeeded, otherwise false
+    void prices_loaded(bool ok);
+
+    /// Replaces running totals with totals of the loaded records
+    void build_index();
+
+    /// Accepts new connections
+    void new_connection();
+
+    /// Reads and answers complete requests
+    /// @param[in] socket The connection
+    void read_requests(QLocalSocket *socket);
+
+    /// Answers one request
+    /// @param[in] request The request line
+    /// @param[out] out Output buffer for the response
+    void answer(QByteArray const &request, fmt::memory_buffer &out) const;
+
+    /// Returns totals for records starting in the time period
+    /// @param[in] start Start time
+    /// @param[in] end End time (excluded)
+    auto totals(QDateTime const &start, QDateTime const &end) const -> Summary;
+
+    /// Appends totals for the time period as a JSON object
+    /// @param[out] out Output buffer
+    /// @param[in] start Start time
+    /// @param[in] end End time (excluded)
+    void append_totals(fmt::memory_buffer &out, QDateTime const &start, QDateTime const &end) const;
+
+    /// Parses the time in a request
+    /// @param[in] value `yyyy-MM-dd` or `yyyy-MM-ddThh:mm`
+    /// @return The time (invalid on errors)
+    static auto parse_time(QByteArray const &value) -> QDateTime;
+};
+
+} // namespace El
+
+#endif
@@ -0,0 +1,66 @@
+#include "summary.h"
+#include "record.h"
+
+namespace El {
+
+void Summary::add(Record const &rec)
+{
+    ++records;
+    export_wh += to_wh(rec.exportedKWh());
+    if (rec.isNight()) {
+        night_wh += to_wh(rec.kWh());
+    }
+    else {
+        day_wh += to_wh(rec.kWh());
+    }
+}
+
+void Summary::add(Record const &rec, std::optional<double> const &price, double margin)
+{
+    add(rec);
+
+    if (!price) {
+        ++missing;
+        return;
+    }
+
+    // rounded once per record, so that the totals do not depend on the order of the records
+    auto const c = cost(*price + margin, to_wh(rec.kWh()));
+    if (rec.isNight()) {
+        night_cost += c;
+    }
+    else {
+        day_cost += c;
+    }
+    export_revenue += cost(*price, to_wh(rec.exportedKWh()));
+}
+
+auto Summary::operator+(Summary const &rhs) const -> Summary
+{
+    return Summary{
+        night_wh + rhs.night_wh,
+        day_wh + rhs.day_wh,
+        night_cost + rhs.night_cost,
+        day_cost + rhs.day_cost,
+        export_wh + rhs.export_wh,
+        export_revenue + rhs.export_revenue,
+        records + rhs.records,
+        missing + rhs.missing,
+    };
+}
+
+auto Summary::operator-(Summary const &rhs) const -> Summary
+{
+    return Summary{
+        night_wh - rhs.night_wh,
+        day_wh - rhs.day_wh,
+        night_cost - rhs.night_cost,
+        day_cost - rhs.day_cost,
+        export_wh - rhs.export_wh,
+        export_revenue - rhs.export_revenue,
+        records - rhs.records,
+        missing - rhs.missing,
+    };
+}
+
+} // namespace El
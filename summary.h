@@ -0,0 +1,82 @@
+#pragma once
+
+#ifndef EL_SUMMARY_H_INCLUDED
+#  define EL_SUMMARY_H_INCLUDED
+
+#include "money.h"
+
+#include <optional>
+
+namespace El {
+
+class Record;
+
+/// Consumption and cost totals
+///
+/// Totals are exact integers (see `money.h`), so adding the same records in any order or in any
+/// grouping gives bit-identical totals. Costs include the margin but not VAT; use `with_vat()`
+/// to get the cost with VAT.
+///
+/// Energy exported to the grid is sold at the Nord Pool price without the margin and VAT. The
+/// net cost is the cost with VAT minus the export revenue.
+struct Summary {
+    Wh    night_wh       = 0; ///< Night consumption Wh
+    Wh    day_wh         = 0; ///< Day consumption Wh
+    Money night_cost     = 0; ///< Night cost
+    Money day_cost       = 0; ///< Day cost
+    Wh    export_wh      = 0; ///< Energy exported to the grid Wh
+    Money export_revenue = 0; ///< Revenue of the exported energy
+    int   records        = 0; ///< Number of records
+    int   missing        = 0; ///< Number of records without a price
+
+    /// Adds the consumption of the record
+    /// @param[in] rec Consumption record
+    void add(Record const &rec);
+
+    /// Adds the consumption and cost of the record
+    /// @param[in] rec Consumption record
+    /// @param[in] price Price EUR/kWh or an empty value if there is no price for the record
+    /// @param[in] margin Margin EUR/kWh
+    void add(Record const &rec, std::optional<double> const &price, double margin);
+
+    /// Total consumption Wh
+    auto total_wh() const noexcept { return night_wh + day_wh; }
+
+    /// Total cost
+    auto total_cost() const noexcept { return night_cost + day_cost; }
+
+    /// Night consumption kWh
+    auto night_kwh() const noexcept { return to_kwh(night_wh); }
+
+    /// Day consumption kWh
+    auto day_kwh() const noexcept { return to_kwh(day_wh); }
+
+    /// Total consumption kWh
+    auto total_kwh() const noexcept { return to_kwh(total_wh()); }
+
+    /// Exported energy kWh
+    auto export_kwh() const noexcept { return to_kwh(export_wh); }
+
+    /// Net consumption Wh, i.e. consumption minus export
+    auto net_wh() const noexcept { return total_wh() - export_wh; }
+
+    /// Net consumption kWh
+    auto net_kwh() const noexcept { return to_kwh(net_wh()); }
+
+    /// Returns true if there is energy exported to the grid
+    auto has_export() const noexcept { return export_wh != 0; }
+
+    /// Returns the sum of two totals
+    /// @param[in] rhs Totals to add
+    /// @return Totals of both
+    auto operator+(Summary const &rhs) const -> Summary;
+
+    /// Returns the difference of two running totals
+    /// @param[in] rhs Running total at the start of the period
+    /// @return Totals for the period
+    auto operator-(Summary const &rhs) const -> Summary;
+};
+
+} // namespace El
+
+#endif
@@ -0,0 +1,240 @@
+#include "watch.h"
+#include "common.h"
+#include "engine.h"
+#include "options.h"
+#include "output.h"
+#include "prices.h"
+#include "pricetable.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QTimer>
+
+#include <fmt/base.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace El {
+
+Watch::Watch(Options const &options, QObject *parent)
+    : QObject(parent)
+    , _options(options)
+    , _watcher(new QFileSystemWatcher{this})
+    , _timer(new QTimer{this})
+    , _retry(new QTimer{this})
+{
+    _timer->setSingleShot(true);
+    _timer->setInterval(UPDATE_DELAY_MS);
+    connect(_timer, &QTimer::timeout, this, &Watch::update);
+    _retry->setSingleShot(true);
+    _retry->setInterval(PRICE_RETRY_MS);
+    connect(_retry, &QTimer::timeout, this, &Watch::update);
+    connect(_watcher, &QFileSystemWatcher::fileChanged, this, &Watch::changed);
+    connect(_watcher, &QFileSystemWatcher::directoryChanged, this, &Watch::changed);
+}
+
+Watch::~Watch() = default;
+
+auto Watch::start() -> bool
+{
+    QFileInfo const info{_options.file_name};
+    if (!info.exists()) {
+        fmt::print(stderr, "ERROR: faili või kausta {} ei ole olemas\n", _options.file_name);
+        return false;
+    }
+
+    _directory = info.isDir();
+    if (_directory) {
+        _watcher->addPath(_options.file_name);
+        scan();
+    }
+    else {
+        _files.insert(_options.file_name, {});
+        _changed.insert(_options.file_name);
+        _watcher->addPath(_options.file_name);
+    }
+
+    if (_options.prices) {
+        _prices = std::make_unique<Prices>(_options);
+        connect(_prices.get(), &Prices::loaded, this, &Watch::prices_loaded);
+    }
+
+    if (_options.verbose) {
+        fmt::print("Jälgin {} muudatusi\n", _options.file_name);
+    }
+
+    _noticed = QDateTime::currentDateTime();
+    update();
+    return true;
+}
+
+void Watch::scan()
+{
+    using namespace Qt::Literals::StringLiterals;
+
+    QDir const dir{_options.file_name};
+    for (auto const &name : dir.entryList({u"*.csv"_s, u"*.csv.gz"_s, u"*.csv.zst"_s, u"*.zip"_s}, QDir::Files | QDir::Readable, QDir::Name)) {
+        auto const filename = dir.filePath(name);
+        if (!_files.contains(filename)) {
+            _files.insert(filename, {});
+            _changed.insert(filename);
+            _watcher->addPath(filename);
+        }
+    }
+}
+
+void Watch::changed(QString const &path)
+{
+    if (_directory && path == _options.file_name) {
+        scan();
+    }
+    else {
+        _changed.insert(path);
+
+        // files that are replaced instead of modified are no longer watched
+        if (!_watcher->files().contains(path) && QFileInfo::exists(path)) {
+            _watcher->addPath(path);
+        }
+    }
+
+    if (!_changed.isEmpty()) {
+        if (_noticed.isNull()) {
+            _noticed = QDateTime::currentDateTime();
+        }
+        _timer->start();
+    }
+}
+
+void Watch::update()
+{
+    // changes noticed while prices are being loaded are read after that
+    if (_busy || (_changed.isEmpty() && _unpriced.isEmpty())) {
+        return;
+    }
+    if (_noticed.isNull()) {
+        _noticed = QDateTime::currentDateTime();
+    }
+
+    // records without a price go first, so that records read again from the files replace them
+    _retry->stop();
+    _pending = std::exchange(_unpriced, {}).values();
+
+    // records up to now unless the time is given on the command line
+    auto const end = _options.fixed_time ? _options.time : QDateTime::currentDateTime();
+
+    for (auto const &filename : std::exchange(_changed, {})) {
+        read(filename, end);
+    }
+
+    if (_pending.isEmpty()) {
+        _noticed = {};
+        return;
+    }
+
+    if (!_prices) {
+        apply();
+        return;
+    }
+
+    // prices only for the time period of the new records
+    auto const [first, last] = std::minmax_element(_pending.cbegin(), _pending.cend(), [](auto const &a, auto const &b) {
+        return a.startTime() < b.startTime();
+    });
+
+    _busy = true;
+    _prices->load(_options.region(), first->startTime(), last->startTime());
+}
+
+void Watch::read(QString const &filename, QDateTime const &end)
+{
+    auto &file = _files[filename];
+
+    // removed files are ignored; their records stay in the totals
+    QFile f{filename};
+    if (!f.open(QFile::ReadOnly)) {
+        return;
+    }
+    auto const size = f.size();
+    auto const head = f.read(HEAD_SIZE);
+    f.close();
+
+    // lines appended to the file are read from the previous position, otherwise the whole file
+    if (size < file.size || !head.startsWith(file.head)) {
+        file.pos = {};
+    }
+
+    Consumption consumption{};
+    if (!consumption.load(filename, end, file.pos)) {
+        fmt::print(stderr, "WARNING: CSV faili {} laadimine ebaõnnestus\n", filename);
+        file = {};
+        return;
+    }
+    file.size = size;
+    file.head = head;
+
+    if (_options.verbose && !consumption.records().isEmpty()) {
+        fmt::print("Lugesin failist {} {} uut kirjet\n", filename, consumption.records().size());
+    }
+
+    _pending.append(consumption.records());
+}
+
+void Watch::prices_loaded(bool ok)
+{
+    if (!ok) {
+        fmt::print(stderr, "WARNING: kõiki hindasid ei õnnestunud laadida\n");
+    }
+    apply();
+}
+
+void Watch::apply()
+{
+    auto const table = _prices ? _prices->snapshot() : nullptr;
+
+    // a record read again replaces the previous one
+    for (auto const &rec : _pending) {
+        Summary    s{};
+        auto const price = Engine::add_record(s, rec, table.get(), _options);
+        auto const key   = rec.startTime().toSecsSinceEpoch();
+        if (table && !price) {
+            _unpriced.insert(key, rec);
+        }
+        else {
+            _unpriced.remove(key);
+        }
+
+        auto it = _entries.find(key);
+        if (it != _entries.end()) {
+            _total = _total - it->summary;
+            *it    = Entry{rec.endTime(), s};
+        }
+        else {
+            _entries.insert(key, Entry{rec.endTime(), s});
+        }
+        _total = _total + s;
+    }
+
+    auto const count = _pending.size();
+    _pending.clear();
+    _busy = false;
+    if (!_unpriced.isEmpty()) {
+        _retry->start();
+    }
+
+    if (!_entries.isEmpty()) {
+        Output output{_options, _prices != nullptr};
+        output.summary(_total, QDateTime::fromSecsSinceEpoch(_entries.firstKey()), _entries.last().end);
+    }
+
+    if (_options.verbose) {
+        fmt::print("Uuendasin {} kirjet {} ms jooksul\n", count, _noticed.msecsTo(QDateTime::currentDateTime()));
+    }
+    _noticed = {};
+
+    update();
+}
+
+} // namespace El
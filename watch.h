@@ -0,0 +1,146 @@
+#pragma once
+
+#ifndef EL_WATCH_H_INCLUDED
+#  define EL_WATCH_H_INCLUDED
+
+#include "consumption.h"
+#include "summary.h"
+
+#include <QDateTime>
+#include <QHash>
+#include <QMap>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+#include <memory>
+
+QT_FORWARD_DECLARE_CLASS(QFileSystemWatcher)
+QT_FORWARD_DECLARE_CLASS(QTimer)
+
+namespace El {
+
+class Prices;
+struct Options;
+
+/// Watches the CSV file or a directory of CSV files and shows updated totals when they change
+///
+/// Only changed files are read. Lines appended to a file are read from where the previous read
+/// stopped; other changes read the file again. Prices are loaded only for the time period of the
+/// new records and the totals are updated with the new records only, so that an update takes
+/// about the same time with years of history as with one day.
+///
+/// Records are identified by their start time and a record read again replaces the previous one,
+/// so overlapping exports are counted once. Records are never removed from the totals, also when
+/// a file is removed. Records without a price are priced again with the next update and at least
+/// every `PRICE_RETRY_MS`, so that a failed price request does not leave permanent gaps.
+class Watch : public QObject {
+    Q_OBJECT
+
+public:
+
+    /// Delay before reading a changed file; downloads and editors write files in several steps
+    static constexpr int UPDATE_DELAY_MS = 200;
+
+    /// Number of bytes from the beginning of a file used for detecting rewritten files
+    static constexpr qint64 HEAD_SIZE = 1024;
+
+    /// Interval for loading missing prices again
+    static constexpr int PRICE_RETRY_MS = 5 * 60'000;
+
+    /// Ctor
+    /// @param[in] options Engine options
+    /// @param[in] parent Optional parent
+    Watch(Options const &options, QObject *parent = nullptr);
+
+    /// Dtor
+    ~Watch() override;
+
+    /// Reads all the files, shows totals and starts watching for changes
+    /// @return true if succeeded, otherwise false
+    auto start() -> bool;
+
+private:
+
+    /// State of one CSV file
+    struct File {
+        qint64                size = 0; ///< Size when the file was read
+        QByteArray            head;     ///< The beginning of the file when it was read
+        Consumption::Position pos;      ///< Position after the last complete line
+    };
+
+    /// Contribution of one record to the totals
+    struct Entry {
+        QDateTime end;     ///< End time of the record
+        Summary   summary; ///< Totals of the record alone
+    };
+
+    /// Engine options
+    Options const &_options;
+
+    /// File system watcher (inotify on Linux)
+    QFileSystemWatcher *_watcher = nullptr;
+
+    /// Timer that delays reading changed files
+    QTimer *_timer = nullptr;
+
+    /// Timer for loading missing prices again
+    QTimer *_retry = nullptr;
+
+    /// Nord Pool prices (if requested)
+    std::unique_ptr<Prices> _prices;
+
+    /// True if the input is a directory
+    bool _directory = false;
+
+    /// Known CSV files
+    QHash<QString, File> _files;
+
+    /// Files changed since the last update
+    QSet<QString> _changed;
+
+    /// New records waiting for prices
+    QVector<Record> _pending;
+
+    /// Records in the totals without a price by their start time in seconds since the Epoch
+    QMap<qint64, Record> _unpriced;
+
+    /// Flag indicating that prices for new records are being loaded
+    bool _busy = false;
+
+    /// Time when the first change of this update was noticed
+    QDateTime _noticed;
+
+    /// Contributions of records by their start time in seconds since the Epoch
+    QMap<qint64, Entry> _entries;
+
+    /// Totals of all the records
+    Summary _total;
+
+    /// Adds CSV files in the directory that are not yet known
+    void scan();
+
+    /// Called when a watched file or directory changes
+    /// @param[in] path The file or directory
+    void changed(QString const &path);
+
+    /// Reads changed files and starts loading prices for the new records and records without a price
+    void update();
+
+    /// Reads new records from the file
+    /// @param[in] filename Name of the file
+    /// @param[in] end Records ending after this time are ignored
+    void read(QString const &filename, QDateTime const &end);
+
+    /// Called when prices for the new records are loaded
+    /// @param[in] ok true if succeeded, otherwise false
+    void prices_loaded(bool ok);
+
+    /// Adds new records to the totals and shows the totals
+    void apply();
+};
+
+} // namespace El
+
+#endif